@@ -0,0 +1,69 @@
+#ifndef BME_SENSOR_H
+#define BME_SENSOR_H
+
+#include <Arduino.h>
+#include <Adafruit_BME280.h>
+
+// BME280 z odczytem wszystkich rejestrów danych (0xF7..0xFE) w jednej transakcji I2C
+// i wspólną kompensacją Boscha. Biblioteka czyta temperaturę, ciśnienie i wilgotność
+// osobno, a readHumidity()/readPressure() za każdym razem czytają jeszcze temperaturę.
+// Podklasa daje dostęp do chronionych współczynników kalibracji i rejestru ctrl_meas.
+
+// Presety setSampling(); tryb wymuszony (forced) mierzy tylko na żądanie - czujnik
+// między pomiarami śpi, co ogranicza samonagrzewanie
+enum BmePreset : uint8_t {
+    BME_PRESET_WEATHER = 0,     // Forced, x1/x1/x1, bez IIR - zalecenie Boscha do monitoringu
+    BME_PRESET_SMOOTH,          // Forced, x1/x1/x1, IIR x4 - mniej szumu, wolniejsza reakcja
+    BME_PRESET_PRECISE,         // Forced, T x2, P x4, H x2, IIR x2
+    BME_PRESET_CONTINUOUS,      // Normal, x1/x1/x1, standby 1 s - pomiar ciągły
+    BME_PRESET_COUNT
+};
+
+struct BmePresetInfo {
+    const char* name;
+    Adafruit_BME280::sensor_mode mode;
+    Adafruit_BME280::sensor_sampling temperature;
+    Adafruit_BME280::sensor_sampling pressure;
+    Adafruit_BME280::sensor_sampling humidity;
+    Adafruit_BME280::sensor_filter filter;
+    Adafruit_BME280::standby_duration standby;
+};
+
+extern const BmePresetInfo BME_PRESETS[BME_PRESET_COUNT];
+
+#define DEFAULT_BME_PRESET BME_PRESET_WEATHER
+
+int bmePresetFromString(const String& name);   // -1 gdy nieznany
+
+struct BmeReading {
+    float temperature;      // °C
+    float humidity;         // %RH
+    float pressure;         // hPa
+};
+
+class BurstBME280 : public Adafruit_BME280 {
+public:
+    void applyPreset(uint8_t preset);
+    uint8_t preset() const { return _preset; }
+    bool forced() const { return BME_PRESETS[_preset].mode == MODE_FORCED; }
+
+    // W trybie forced wyzwala następny pomiar i wraca od razu - wynik odczytuje
+    // kolejne readAll(). W trybie normal nic nie robi.
+    void startMeasurement();
+
+    // Jedna transakcja: 8 bajtów danych, kompensacja T, P i H z tego samego t_fine.
+    // false gdy odczyt I2C się nie udał, pomiar jeszcze nie istnieje albo czujnik się zresetował.
+    bool readAll(BmeReading& reading);
+
+    // Pomiar z oczekiwaniem na wynik - przy starcie i po zmianie presetu
+    bool readBlocking(BmeReading& reading);
+
+private:
+    float compensateTemperature(int32_t adcT);
+    float compensatePressure(int32_t adcP) const;
+    float compensateHumidity(int32_t adcH) const;
+
+    uint8_t _preset = DEFAULT_BME_PRESET;
+};
+
+#endif
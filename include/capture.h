@@ -0,0 +1,81 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Zapis surowych próbek VL53L0X do pierścienia w RAM - materiał do strojenia progów
+// gestów i do odtwarzania przebiegów na komputerze (silnik gestów i filtr są czystym C++).
+//
+// Format binarny (/capture?format=bin), little-endian, stały między wersjami firmware:
+//   nagłówek 16 B: "OKCP" | uint8 wersja (1) | uint8 rozmiar próbki (12) | uint8 etykieta | uint8 0
+//                  | uint32 liczba próbek | uint32 czas pierwszej próbki (ms od startu)
+//   próbka 12 B:   uint32 czas (ms od startu) | uint16 odległość (mm, surowa)
+//                  | uint8 RangeStatus | uint8 gest rozpoznany na tej próbce (GestureType)
+//                  | uint16 siła sygnału (MCPS, Q8.8) | uint16 światło otoczenia (MCPS, Q8.8)
+// CSV (/capture?format=csv) ma te same kolumny w jednostkach fizycznych.
+//
+// Etykieta opisuje całe nagranie treningowe dla tools/train_classifier.py: 0 = bez
+// etykiety, GestureType = każda obecność dłoni to ten gest, CAPTURE_LABEL_NEGATIVE =
+// obecności, które nie są gestem (garnki, para, przechodzenie obok).
+
+#define CAPTURE_BUFFER_SIZE 2048        // Próbki w pierścieniu (12 B każda, ~40 s przy 50 Hz)
+#define CAPTURE_POST_SAMPLES 100        // W trybie wyzwalanym: próbki zapisywane po geście
+#define CAPTURE_FORMAT_VERSION 1
+#define CAPTURE_LABEL_NONE 0
+#define CAPTURE_LABEL_NEGATIVE 0x80
+
+enum CaptureMode : uint8_t {
+    CAPTURE_OFF = 0,
+    CAPTURE_CONTINUOUS,     // Na żądanie: ostatnie CAPTURE_BUFFER_SIZE próbek
+    CAPTURE_TRIGGER,        // Wokół gestu: historia przed gestem + CAPTURE_POST_SAMPLES po, potem stop
+    CAPTURE_MODE_COUNT
+};
+
+struct __attribute__((packed)) CaptureSample {
+    uint32_t time;
+    uint16_t range;
+    uint8_t status;
+    uint8_t gesture;
+    uint16_t signalRate;
+    uint16_t ambientRate;
+};
+
+// Rozpoczyna nowy zapis (czyści pierścień)
+void captureStart(CaptureMode mode, uint8_t label = CAPTURE_LABEL_NONE);
+void captureStop();
+
+const char* captureModeName(CaptureMode mode);
+int captureModeFromString(const String& name);  // -1 gdy nieznany
+const char* captureLabelName(uint8_t label);
+int captureLabelFromString(const String& name); // -1 gdy nieznana
+
+// Wywoływane z processGesture() dla każdej próbki; sygnał i otoczenie w FixPoint1616
+void captureRecord(uint32_t time, uint16_t range, uint8_t status, uint8_t gesture,
+                   uint32_t signalRate, uint32_t ambientRate);
+
+// Stan zapisu dla /api/capture
+void fillCaptureStatus(JsonObject root);
+
+// Generator odpowiedzi /capture. Na czas pobierania wstrzymuje zapis,
+// więc plik powstaje wprost z pierścienia, bez kopii.
+class CaptureStream {
+public:
+    explicit CaptureStream(bool binary);
+    ~CaptureStream();
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+private:
+    bool nextChunk();
+
+    bool _binary;
+    uint8_t _label;
+    uint16_t _start;
+    uint16_t _count;
+    int32_t _item = -1;     // -1 = nagłówek
+    uint8_t _chunk[64];
+    size_t _chunkLength = 0;
+    size_t _chunkPos = 0;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <Adafruit_BME280.h>
+#include "bme_sensor.h"
 
 // GPIO Pins for relays
 #define RELAY_PIN1 5
@@ -16,6 +17,19 @@
 #define SDA_PIN 14
 #define SCL_PIN 15
 
+// VL53L0X GPIO1 (data ready) - wejście bez pull-up na WT32-ETH01, pull-up na płytce czujnika
+#define VL53L0X_INT_PIN 35
+#define RANGING_PERIOD 0                // Pomiar ciągły back-to-back (ms, 0 = bez przerw)
+#define RANGING_STALL_TIMEOUT 500       // Brak przerwania dłużej niż (ms) - odpytaj czujnik
+#define RANGING_FAULT_TIMEOUT 2000      // Brak próbki mimo odpytywania (ms) - błąd czujnika (reset, odłączenie)
+
+// Drugi VL53L0X (prawy) - XSHUT obu czujników do zmiany adresu przy starcie.
+// IO2 jest pinem bootstrap, ale stan wysoki (pull-up XSHUT) nie przeszkadza w normalnym starcie.
+#define VL53L0X_XSHUT_LEFT_PIN 4
+#define VL53L0X_XSHUT_RIGHT_PIN 2
+#define VL53L0X_RIGHT_INT_PIN 36        // Tylko wejście, jak IO35
+#define VL53L0X_RIGHT_ADDRESS 0x30
+
 // Auto-activation thresholds
 #define TEMP_RISE_THRESHOLD 1.0f    // Temperature rise threshold in °C per minute
 #define HUM_RISE_THRESHOLD 3.0f     // Humidity rise threshold in % per minute
@@ -25,9 +39,31 @@
 
 // Default values for auto-activation
 #define DEFAULT_TEMP_THRESHOLD 1.0f
-#define DEFAULT_HUM_THRESHOLD 3.0f
+#define DEFAULT_AH_THRESHOLD 0.5f      // Wzrost wilgotności bezwzględnej (g/m³/min)
 #define DEFAULT_CHECK_INTERVAL 10000
 
+// BME280: okap i opcjonalny czujnik odniesienia w pomieszczeniu (SDO do VCC)
+#define BME280_HOOD_ADDRESS 0x76
+#define BME280_ROOM_ADDRESS 0x77
+#define DEFAULT_DIFF_TEMP_THRESHOLD 1.5f        // Różnica okap - pokój ponad linię bazową (°C)
+#define DEFAULT_DIFF_AH_THRESHOLD 1.0f          // Jw. dla wilgotności bezwzględnej (g/m³)
+
+// Webhook settings
+#define WEBHOOK_TIMEOUT 5000         // Timeout połączenia i odpowiedzi (ms)
+#define WEBHOOK_DNS_TTL 300000       // Jak długo trzymać adres IP hosta webhooka (5 min)
+
+// Telemetry batching (paczki okresowych odczytów zamiast POST co 10 s)
+#define MAX_TELEMETRY_BATCH 120                 // Pojemność bufora próbek
+#define DEFAULT_TELEMETRY_SAMPLE_INTERVAL 2000  // Co ile ms zbierać próbkę
+#define DEFAULT_TELEMETRY_BATCH_SIZE 60         // Wyślij po tylu próbkach...
+#define DEFAULT_TELEMETRY_BATCH_AGE 120000      // ...albo gdy najstarsza ma tyle ms
+
+// Change-driven periodic reporting
+#define PERIODIC_CHECK_INTERVAL 1000            // Jak często sprawdzać zmiany (ms)
+#define DEFAULT_HEARTBEAT_INTERVAL 300000       // Raport bez zmian co 5 minut
+#define DEFAULT_TEMP_DEADBAND 0.3f              // Minimalna zmiana temperatury (°C)
+#define DEFAULT_HUM_DEADBAND 2.0f               // Minimalna zmiana wilgotności (%)
+
 // Log settings
 #define MAX_LOG_ENTRIES 50  // Maximum number of log entries to keep
 
@@ -44,17 +80,33 @@ extern std::vector<LogEntry> speedLogs;
 // Deklaracje globalnych zmiennych
 extern int currentSpeed;
 extern int defaultSpeed;
-extern String webhookUrl; // Deklaracja zmiennej webhookUrl jako extern
-extern Adafruit_BME280 bme; // Deklaracja zmiennej bme jako extern
+extern bool webhookKeepAlive;  // Utrzymywanie połączenia z serwerem webhooka między wywołaniami
+extern BurstBME280 bme; // Deklaracja zmiennej bme jako extern
+extern BurstBME280 bmeRoom;     // Czujnik odniesienia w pomieszczeniu
 
 extern float lastTemperature;
-extern float lastHumidity;
+extern float lastAbsHumidity;
+extern float lastDewPoint;
 extern unsigned long lastMonitoringTime;
 
 extern float tempRiseThreshold;
-extern float humRiseThreshold;
+extern float ahRiseThreshold;
 extern unsigned long monitoringInterval;
 extern bool autoActivationEnabled;
+extern float diffTempThreshold;
+extern float diffAhThreshold;
+
+// Telemetry batching settings
+extern bool telemetryBatchEnabled;
+extern unsigned long telemetrySampleInterval;
+extern int telemetryBatchSize;
+extern unsigned long telemetryBatchMaxAge;
+extern bool telemetryNdjson;
+
+// Change-driven periodic reporting settings
+extern unsigned long heartbeatInterval;
+extern float tempDeadband;
+extern float humDeadband;
 
 // Network settings
 extern bool dhcpEnabled;
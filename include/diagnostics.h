@@ -0,0 +1,63 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Arduino.h>
+
+#define DIAG_SNAPSHOT_INTERVAL 60000    // Odstęp migawek diagnostycznych (ms)
+#define DIAG_HISTORY_SIZE 30            // Migawki w pierścieniu (30 min)
+#define DIAG_MAX_TASKS 24               // Zadania FreeRTOS raportowane w /api/diag
+#define DIAG_CPU_CORES 2
+
+// Udział zadań w CPU: stockowy rdzeń Arduino-ESP32 ma wyłączone
+// CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS (FreeRTOS jest prekompilowany, flagi budowania
+// tego nie zmienią), więc próbkujemy bieżące zadanie każdego rdzenia w hooku ticka
+// (1 kHz). Wartości liczone są między kolejnymi migawkami, nie średnio od startu.
+
+// Migawka stanu pamięci i stosów - trendy widoczne w /api/diag
+struct DiagSnapshot {
+    uint32_t uptime;            // s
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;
+    uint32_t largestFreeBlock;
+    uint16_t loopStackFree;     // Najmniejszy zapas stosu (bajty)
+    uint16_t asyncStackFree;
+    uint8_t cpuLoad[DIAG_CPU_CORES];    // % czasu poza zadaniem IDLE od poprzedniej migawki
+};
+
+// Zapamiętuje przyczynę resetu i uchwyt zadania loop - wywoływane z setup()
+void setupDiagnostics();
+
+// Okresowe migawki - wywoływane z loop()
+void diagnosticsLoop();
+
+// Generator odpowiedzi /api/diag (JSON w kawałkach, bez dokumentu na stercie).
+// Migawka zadań i historii robiona w konstruktorze, jak w MetricsStream.
+class DiagStream {
+public:
+    DiagStream();
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+private:
+    struct TaskInfo {
+        char name[configMAX_TASK_NAME_LEN];
+        uint32_t priority;
+        uint32_t stackFree;
+        float cpuPercent;
+    };
+
+    bool nextPart();
+
+    DiagSnapshot _now;
+    TaskInfo _tasks[DIAG_MAX_TASKS];
+    uint8_t _taskCount = 0;
+    DiagSnapshot _history[DIAG_HISTORY_SIZE];
+    uint8_t _historyCount = 0;
+
+    uint8_t _section = 0;
+    uint8_t _item = 0;
+    char _part[192];
+    size_t _partLength = 0;
+    size_t _partPos = 0;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef DUAL_GESTURE_ENGINE_H
+#define DUAL_GESTURE_ENGINE_H
+
+#include "gesture_engine.h"
+
+// Gesty z dwóch czujników obok siebie. Lewy (główny) czujnik zasila pełny
+// GestureEngine; prawy służy tylko do rozpoznania kierunku ruchu poprzecznego.
+// Dłoń, która w ciągu swipeMaxMs przeszła pod oboma czujnikami, daje
+// GESTURE_SWIPE_LEFT/RIGHT zamiast gestu lewego czujnika - dlatego przy aktywnym
+// prawym czujniku tap/swipe lewego są wstrzymywane o lateralWaitMs.
+// Bez drugiego czujnika (setDual(false)) zachowuje się jak sam GestureEngine.
+// Czysty C++ - na komputerze można go zasilić dwoma nagranymi/wymyślonymi przebiegami.
+
+class DualGestureEngine {
+public:
+    explicit DualGestureEngine(const GestureConfig& config = GestureConfig());
+
+    void setConfig(const GestureConfig& config);
+    const GestureConfig& config() const { return _primary.config(); }
+    void setDual(bool dual);
+    bool dual() const { return _dual; }
+
+    // Próbka lewego (głównego) czujnika
+    GestureResult update(uint32_t now, int distance);
+    // Próbka prawego czujnika
+    GestureResult updateSecondary(uint32_t now, int distance);
+
+    void reset();
+
+    void setClock(uint32_t (*clock)()) { _primary.setClock(clock); }
+    const ClassifierStats& classifierStats() const { return _primary.classifierStats(); }
+
+    bool present() const { return _primary.present(); }
+    bool busy() const { return _primary.busy() || _held || _right.inWindow; }
+    bool sliderActive() const { return _primary.sliderActive(); }
+
+private:
+    struct Side {
+        bool inWindow = false;
+        bool seen = false;          // Obecność od ostatniej oceny ruchu poprzecznego
+        uint32_t enter = 0;
+        uint32_t leave = 0;
+    };
+
+    void track(Side& side, uint32_t now, int distance);
+    bool lateral(uint32_t now, GestureResult& result);
+    GestureResult releaseHeld(uint32_t now);
+
+    GestureEngine _primary;
+    bool _dual = false;
+    Side _left;
+    Side _right;
+
+    bool _held = false;             // Gest lewego czujnika czekający na lateralWaitMs
+    GestureResult _heldResult;
+    uint32_t _heldTime = 0;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef ENV_DETECTOR_H
+#define ENV_DETECTOR_H
+
+#include <stdint.h>
+
+// Wykrywanie gotowania z różnicy okap - pokój (drugi BME280 jako odniesienie).
+// Pogoda, słońce czy otwarte okno zmieniają oba czujniki, więc różnica pozwala
+// na dużo niższe progi niż tempo zmian z jednego czujnika. Stała różnica wynikająca
+// z montażu (lampy okapu, przeciąg) jest odejmowana jako wolna linia bazowa, liczona
+// tylko w spoczynku. Czysty C++ jak gesture_engine.
+
+struct DifferentialConfig {
+    float tempThreshold = 1.5f;         // °C ponad linię bazową
+    float ahThreshold = 1.0f;           // g/m³ ponad linię bazową
+    uint8_t confirmSamples = 3;         // Kolejne próbki ponad progiem (odporność na szpilki)
+    uint32_t baselineTauMs = 1800000;   // Stała czasowa linii bazowej (30 min)
+};
+
+class DifferentialDetector {
+public:
+    explicit DifferentialDetector(const DifferentialConfig& config = DifferentialConfig());
+
+    void setConfig(const DifferentialConfig& config) { _config = config; }
+    const DifferentialConfig& config() const { return _config; }
+    void reset();
+
+    // Jedna para odczytów. holdBaseline (np. wentylator pracuje) wstrzymuje naukę linii
+    // bazowej. Zwraca true w chwili wykrycia - kolejne próbki tego samego gotowania nie.
+    bool update(uint32_t now, float hoodTemp, float hoodAh, float roomTemp, float roomAh, bool holdBaseline);
+
+    bool active() const { return _active; }
+    bool ready() const { return _ready; }
+    float deltaTemperature() const { return _deltaTemp; }       // Różnica ponad linię bazową
+    float deltaAbsHumidity() const { return _deltaAh; }
+    float baselineTemperature() const { return _baselineTemp; }
+    float baselineAbsHumidity() const { return _baselineAh; }
+
+private:
+    DifferentialConfig _config;
+    bool _ready = false;
+    bool _active = false;
+    uint8_t _above = 0;
+    uint32_t _lastTime = 0;
+    float _baselineTemp = 0;
+    float _baselineAh = 0;
+    float _deltaTemp = 0;
+    float _deltaAh = 0;
+};
+
+#endif
@@ -2,20 +2,105 @@
 #define GESTURE_H
 
 #include <Adafruit_VL53L0X.h>
+#include "gesture_engine.h"
+#include "dual_gesture_engine.h"
+#include "range_filter.h"
+#include "gesture_calibration.h"
 
 // Deklaracja zewnętrzna sensora VL53L0X
 extern Adafruit_VL53L0X lox;
 
+// Drugi czujnik po prawej stronie lewego (lox) - kierunek ruchu poprzecznego.
+// Wykrywany przy starcie; bez niego wszystko działa na jednym czujniku.
+extern Adafruit_VL53L0X loxRight;
+extern bool dualSensors;
+extern int rightDistance;               // Po filtracji, -1 = brak celu
+
+// Profile czasu pomiaru VL53L0X (timing budget) z domyślnymi limitami jakości
+enum RangingProfile : uint8_t {
+    PROFILE_HIGH_SPEED = 0,     // 20 ms
+    PROFILE_BALANCED,           // 33 ms - domyślny biblioteki
+    PROFILE_HIGH_ACCURACY,      // 200 ms
+    RANGING_PROFILE_COUNT
+};
+
+struct RangingProfileInfo {
+    const char* name;
+    uint32_t budgetUs;
+    float signalRate;           // Minimalna siła sygnału (MCPS)
+    float sigma;                // Maksymalna niepewność pomiaru (mm)
+};
+
+extern const RangingProfileInfo RANGING_PROFILES[RANGING_PROFILE_COUNT];
+
+#define DEFAULT_RANGING_PROFILE PROFILE_BALANCED
+#define RANGING_NOISE_WINDOW 32         // Próbki do oceny szumu (odchylenie standardowe)
+
+// Próbkowanie adaptacyjne
+#define RANGING_IDLE_PERIOD 250         // Okres pomiaru bez nikogo w pobliżu (ms, 4 Hz)
+#define RANGING_APPROACH_MARGIN 200     // Odczyt do tylu mm ponad oknem gestów przełącza na pełną szybkość
+#define RANGING_IDLE_TIMEOUT 5000       // Powrót do wolnego tempa po tylu ms bez aktywności
+
+extern uint8_t rangingProfile;
+extern float signalRateLimit;
+extern float sigmaLimit;
+extern bool adaptiveSampling;
+
+int rangingProfileFromString(const String& name);  // -1 gdy nieznany
+
 // Funkcje związane z gestami
 void setupGesture();
 void processGesture();
 
+// Nowe ustawienia czujnika - stosowane w loop() przy następnym wywołaniu processGesture()
+void requestRangingConfig();
+
+// Osiągnięta częstotliwość próbkowania (Hz) i szum ostatnich RANGING_NOISE_WINDOW próbek.
+// Do pomiaru szumu przed czujnikiem powinien leżeć nieruchomy obiekt.
+float rangingSampleRate();
+bool rangingNoise(float& mean, float& stddev, uint8_t& samples);
+
+// Czy czujnik mierzy z pełną szybkością (zbliżenie albo próbkowanie adaptacyjne wyłączone)
+bool rangingBurst();
+
 // Deklaracje globalnych zmiennych związanych z gestami
-extern unsigned long gestureStartTime;
 extern bool gestureDetected;
 extern bool holdDetected;
-extern const int gestureThreshold;
-extern const int holdThreshold;
+
+// Progi silnika gestów (persystowane); zmiana stosowana w loop()
+extern GestureConfig gestureConfig;
+void requestGestureConfig();
+void saveGestureConfig();
+
+// Czas inferencji i pewność klasyfikatora gestów (gestureConfig.classifierEnabled)
+const ClassifierStats& gestureClassifierStats();
+
+#define GESTURE_MIN_WINDOW 40           // Najwęższe okno gestów (mm) - 4 pasma trybu proporcjonalnego
+
+// Kalibracja górnej granicy okna z odległości tła
+#define CALIBRATION_RECHECK_INTERVAL (6UL * 60 * 60 * 1000)    // Ponowne sprawdzenie tła co 6 h
+#define CALIBRATION_DRIFT_MM 40         // Przesunięcie tła, od którego okno jest przeliczane
+
+extern bool autoCalibration;            // Okresowe sprawdzanie tła i korekta okna
+extern int calibrationBaseline;         // Tło z ostatniej kalibracji (mm), -1 = brak celu
+extern uint16_t userMaxDistance;        // Górna granica okna od użytkownika - kalibracja tylko zawęża poniżej niej
+uint16_t calibratedMaxDistance(uint16_t userMax);   // userMax zawężone wynikiem ostatniej kalibracji
+
+// Kalibracja na żądanie (gesty wstrzymane na czas zbierania próbek); start w loop()
+void requestCalibration();
+bool calibrationActive();
+uint32_t calibrationElapsed();
+const CalibrationResult& lastCalibrationResult();
+
+// Filtr odczytów (bramki sygnału/otoczenia, mediana, Kalman; persystowany); zmiana stosowana w loop()
+extern RangeFilterConfig rangeFilterConfig;
+void requestRangeFilterConfig();
+void saveRangeFilterConfig();
+const RangeFilterStats& rangeFilterStats();
+
+// Gesty rozpoznane na surowych i na przefiltrowanych odczytach od startu -
+// różnica to fałszywe wyzwolenia usunięte przez filtr
+void rangeFilterGestureCounts(uint32_t& raw, uint32_t& filtered);
 
 // Add new variable for current distance
 extern int currentDistance;
@@ -0,0 +1,60 @@
+#ifndef GESTURE_CALIBRATION_H
+#define GESTURE_CALIBRATION_H
+
+#include <stdint.h>
+
+// Kalibracja okna gestów z tła: przez pewien czas zbiera rozkład odległości bez
+// gestów (płyta, pokrywka, krawędź blatu) i wybiera górną granicę okna z zapasem
+// poniżej najbliższego stałego obiektu. Czysty C++ jak gesture_engine.
+
+struct CalibrationConfig {
+    uint32_t durationMs = 30000;        // Czas zbierania próbek
+    uint16_t minSamples = 50;           // Mniej próbek = wynik niepewny
+    uint16_t marginMm = 60;             // Minimalny zapas między oknem a tłem
+    uint8_t marginPercent = 20;         // Zapas względny (szum rośnie z odległością)
+    uint16_t windowLimit = UINT16_MAX;  // Górna granica wyniku; UINT16_MAX = dalekie tło nie zawęża okna
+    uint16_t maxSpread = 80;            // Większy rozrzut mediana - p5 = tło niestabilne
+};
+
+struct CalibrationResult {
+    bool valid = false;                 // Dość próbek i okno mieści się nad minDistance
+    bool stable = false;                // Tło nieruchome (nikt nie gotował w trakcie)
+    int baseline = -1;                  // 5. percentyl odległości tła (mm), -1 = brak celu
+    int median = -1;                    // -1 = brak celu
+    uint16_t samples = 0;
+    uint16_t maxDistance = 0;           // Proponowana górna granica okna (mm), UINT16_MAX = bez ograniczenia
+};
+
+class GestureCalibrator {
+public:
+    explicit GestureCalibrator(const CalibrationConfig& config = CalibrationConfig());
+
+    void start(uint32_t now);
+    bool active() const { return _active; }
+
+    // Jedna próbka (mm, ujemna gdy brak celu). Zwraca true, gdy zbieranie się zakończyło
+    // i result() zawiera nowy wynik. Dolna granica okna jest stała - okno musi mieć nad nią
+    // co najmniej minWindow mm, inaczej wynik jest niepoprawny.
+    bool update(uint32_t now, int distance, uint16_t minDistance, uint16_t minWindow);
+
+    const CalibrationResult& result() const { return _result; }
+    uint32_t elapsed(uint32_t now) const { return _active ? now - _startTime : 0; }
+
+private:
+    static const uint16_t BIN_MM = 10;
+    static const uint16_t BIN_COUNT = 200;   // Do 2 m; dalej traktujemy jak brak celu
+
+    int percentile(uint8_t percent) const;
+    void finish(uint16_t minDistance, uint16_t minWindow);
+
+    CalibrationConfig _config;
+    CalibrationResult _result;
+    bool _active = false;
+    uint32_t _startTime = 0;
+
+    uint16_t _bins[BIN_COUNT];
+    uint16_t _far = 0;
+    uint16_t _total = 0;
+};
+
+#endif
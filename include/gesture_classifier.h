@@ -0,0 +1,66 @@
+#ifndef GESTURE_CLASSIFIER_H
+#define GESTURE_CLASSIFIER_H
+
+#include <stdint.h>
+
+// Klasyfikator kształtu obecności dłoni w oknie (od wejścia do wyjścia) - drzewo
+// decyzyjne na całkowitych cechach liczonych przyrostowo, bez sterty i buforów.
+// Model trenowany na komputerze z nagrań (tools/train_classifier.py) i wkompilowany
+// jako gesture_model.h. Definicje cech muszą zgadzać się z narzędziem.
+
+enum SegmentFeature : uint8_t {
+    FEATURE_DURATION = 0,   // Czas obecności (ms)
+    FEATURE_TRAVEL,         // Ostatnia - pierwsza odległość (mm, ujemna = zbliżenie)
+    FEATURE_SPAN,           // Maks. - min. odległość (mm)
+    FEATURE_PATH,           // Suma zmian odległości (mm)
+    FEATURE_REVERSALS,      // Zmiany kierunku ruchu większe niż SEGMENT_REVERSAL_MM
+    FEATURE_MIN_POSITION,   // Położenie minimum odległości w czasie obecności (0-100 %)
+    FEATURE_SAMPLES,        // Liczba próbek
+    SEGMENT_FEATURE_COUNT
+};
+
+#define SEGMENT_REVERSAL_MM 8           // Mniejsze zmiany kierunku to szum pomiaru
+
+struct SegmentFeatures {
+    int16_t values[SEGMENT_FEATURE_COUNT];
+};
+
+class SegmentFeatureExtractor {
+public:
+    void begin(uint32_t now, int distance);
+    void add(int distance);
+    // Cechy w chwili wyjścia dłoni z okna
+    void compute(uint32_t now, SegmentFeatures& features) const;
+
+private:
+    uint32_t _start = 0;
+    int16_t _first = 0;
+    int16_t _last = 0;
+    int16_t _min = 0;
+    int16_t _max = 0;
+    uint16_t _minIndex = 0;
+    int32_t _path = 0;
+    int16_t _reversals = 0;
+    int8_t _direction = 0;
+    uint16_t _samples = 0;
+};
+
+// Węzeł drzewa: values[feature] <= threshold -> left, inaczej right.
+// Liść (feature == TREE_LEAF): left = klasa (GestureType), right = pewność 0-255.
+#define TREE_LEAF 0xFF
+
+struct TreeNode {
+    uint8_t feature;
+    int16_t threshold;
+    uint8_t left;
+    uint8_t right;
+};
+
+struct Classification {
+    uint8_t type = 0;       // GestureType
+    uint8_t confidence = 0;
+};
+
+Classification classifySegment(const TreeNode* tree, const SegmentFeatures& features);
+
+#endif
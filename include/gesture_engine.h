@@ -0,0 +1,161 @@
+#ifndef GESTURE_ENGINE_H
+#define GESTURE_ENGINE_H
+
+#include <stdint.h>
+#include "gesture_classifier.h"
+
+// Silnik rozpoznawania gestów nad strumieniem próbek odległości.
+// Czysty C++ bez zależności od Arduino - można go uruchomić na komputerze
+// na nagranych przebiegach. Stała praca na próbkę: automat stanów sterowany
+// tabelą przejść, bez buforów i alokacji.
+
+enum GestureType : uint8_t {
+    GESTURE_NONE = 0,
+    GESTURE_TAP,            // Krótkie wsunięcie dłoni w okno
+    GESTURE_DOUBLE_TAP,     // Dwa takie w krótkim odstępie
+    GESTURE_APPROACH,       // Szybki ruch w stronę czujnika
+    GESTURE_RETREAT,        // Szybki ruch od czujnika
+    GESTURE_SLIDER,         // Tryb proporcjonalny: wysokość dłoni -> bieg 1-4
+    GESTURE_SWIPE_LEFT,     // Ruch poprzeczny od prawego do lewego czujnika (dwa czujniki)
+    GESTURE_SWIPE_RIGHT,    // Ruch poprzeczny od lewego do prawego czujnika
+    GESTURE_TYPE_COUNT
+};
+
+const char* gestureTypeName(GestureType type);
+
+struct GestureConfig {
+    uint16_t minDistance = 50;          // Okno gestów (mm)
+    uint16_t maxDistance = 200;
+    uint16_t tapMaxMs = 800;            // Najdłuższa obecność uznawana za tap
+    uint16_t doubleTapWindowMs = 400;   // Czas na drugi tap (0 = bez double-tap, tap bez opóźnienia)
+    uint16_t swipeMaxMs = 600;          // Najdłuższa obecność uznawana za swipe
+    uint16_t swipeMinTravel = 60;       // Minimalna zmiana odległości w swipe (mm)
+    uint16_t sliderHoldMs = 1500;       // Nieruchoma dłoń przez tyle ms włącza tryb proporcjonalny
+    uint16_t sliderStillMm = 25;        // Dopuszczalny ruch dłoni przy wchodzeniu w tryb
+    uint16_t sliderHysteresisMm = 8;    // Histereza granic biegów w trybie proporcjonalnym
+    bool classifierEnabled = false;     // Tap/swipe rozpoznaje model zamiast progów czasu i ruchu
+    uint8_t minConfidence = 160;        // Niższa pewność modelu = brak gestu (0-255)
+    uint16_t lateralGapMs = 300;        // Maks. odstęp wejścia dłoni pod oba czujniki w ruchu poprzecznym
+    uint16_t lateralMinGapMs = 40;      // Mniejszy odstęp = dłoń opuszczona pionowo nad oba czujniki
+    uint16_t lateralWaitMs = 150;       // Przy dwóch czujnikach gesty lewego czekają tyle na ewentualny ruch poprzeczny
+};
+
+struct ClassifierStats {
+    uint32_t inferences = 0;
+    uint32_t rejected = 0;              // Poniżej minConfidence
+    uint32_t lastUs = 0;
+    uint32_t maxUs = 0;
+    uint32_t totalUs = 0;
+    Classification last;
+};
+
+struct GestureResult {
+    GestureType type = GESTURE_NONE;
+    uint8_t level = 0;                  // Bieg dla GESTURE_SLIDER
+    uint16_t distance = 0;              // Odległość próbki, na której rozpoznano gest
+};
+
+class GestureEngine {
+public:
+    enum State : uint8_t {
+        STATE_IDLE = 0,
+        STATE_PRESENT,      // Dłoń w oknie, gest jeszcze nierozstrzygnięty
+        STATE_SLIDER,       // Tryb proporcjonalny
+        STATE_TAP_PENDING,  // Po tapie, czekamy na ewentualny drugi
+        STATE_COUNT
+    };
+
+    explicit GestureEngine(const GestureConfig& config = GestureConfig());
+
+    // Zmiana progów; resetuje stan
+    void setConfig(const GestureConfig& config);
+    const GestureConfig& config() const { return _config; }
+
+    // Jedna próbka: czas (ms) i odległość (mm, ujemna gdy pomiar niepoprawny)
+    GestureResult update(uint32_t now, int distance);
+
+    void reset();
+
+    // Źródło czasu w mikrosekundach do pomiaru czasu inferencji (nullptr = bez pomiaru)
+    void setClock(uint32_t (*clock)()) { _clock = clock; }
+    const ClassifierStats& classifierStats() const { return _classifierStats; }
+
+    State state() const { return _state; }
+    bool present() const { return _state == STATE_PRESENT || _state == STATE_SLIDER; }
+    bool busy() const { return _state != STATE_IDLE; }
+    bool sliderActive() const { return _state == STATE_SLIDER; }
+
+private:
+    enum Event : uint8_t {
+        EVENT_ENTER = 0,    // Poza oknem -> w oknie
+        EVENT_STAY,         // W oknie
+        EVENT_LEAVE,        // W oknie -> poza oknem
+        EVENT_AWAY          // Poza oknem
+    };
+
+    typedef bool (GestureEngine::*Guard)() const;
+    typedef void (GestureEngine::*Action)(GestureResult& result);
+
+    struct Transition {
+        State state;
+        Event event;
+        Guard guard;        // nullptr = zawsze
+        Action action;      // nullptr = bez akcji
+        State next;
+    };
+
+    static const Transition TRANSITIONS[];
+
+    // Warunki
+    bool isSwipe() const;
+    bool isTap() const;
+    bool isSecondTap() const;
+    bool hasPendingTap() const;
+    bool isSwipeAfterTap() const;
+    bool tapWindowOpen() const;
+    bool tapWindowExpired() const;
+    bool secondTapOverdue() const;
+    bool sliderReady() const;
+
+    // Akcje
+    void startPresence(GestureResult& result);
+    void startSecondPresence(GestureResult& result);
+    void emitSwipe(GestureResult& result);
+    void emitTap(GestureResult& result);
+    void emitDoubleTap(GestureResult& result);
+    void rememberTap(GestureResult& result);
+    void emitPendingTap(GestureResult& result);
+    void emitPendingTapAndStart(GestureResult& result);
+    void emitPendingTapThenSwipe(GestureResult& result);
+    void enterSlider(GestureResult& result);
+    void updateSlider(GestureResult& result);
+
+    void trackPresence();
+    void classifyPresence();
+    uint8_t levelFor(int distance) const;
+
+    GestureConfig _config;
+    State _state = STATE_IDLE;
+    bool _inWindow = false;
+
+    uint32_t _now = 0;
+    int _distance = -1;
+
+    uint32_t _enterTime = 0;
+    uint16_t _firstDistance = 0;
+    uint16_t _lastDistance = 0;
+    uint32_t _stillSince = 0;
+    uint16_t _stillMin = 0;
+    uint16_t _stillMax = 0;
+    uint32_t _tapTime = 0;
+    bool _secondTap = false;
+    uint8_t _level = 0;
+    GestureType _deferred = GESTURE_NONE;   // Drugi gest z tej samej próbki - wychodzi przy następnej
+
+    SegmentFeatureExtractor _segment;
+    Classification _classification;
+    ClassifierStats _classifierStats;
+    uint32_t (*_clock)() = nullptr;
+};
+
+#endif
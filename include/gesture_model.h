@@ -0,0 +1,25 @@
+#ifndef GESTURE_MODEL_H
+#define GESTURE_MODEL_H
+
+// Model klasyfikatora gestów. Plik generowany przez tools/train_classifier.py -
+// zmiany ręczne zostaną nadpisane przy następnym treningu.
+//
+// Model domyślny odtwarza progi reguł (swipe <= 600 ms i >= 60 mm, tap <= 800 ms).
+
+#include "gesture_classifier.h"
+
+#define GESTURE_MODEL_SAMPLES 0         // Przykłady treningowe (0 = model ręczny)
+
+constexpr TreeNode GESTURE_MODEL[] = {
+    { FEATURE_DURATION, 600, 1, 4 },
+    { FEATURE_TRAVEL, -60, 2, 3 },
+    { TREE_LEAF, 0, 3, 255 },           // approach
+    { FEATURE_TRAVEL, 59, 5, 6 },
+    { FEATURE_DURATION, 800, 7, 8 },
+    { TREE_LEAF, 0, 1, 255 },           // tap
+    { TREE_LEAF, 0, 4, 255 },           // retreat
+    { TREE_LEAF, 0, 1, 255 },           // tap
+    { TREE_LEAF, 0, 0, 255 },           // none
+};
+
+#endif
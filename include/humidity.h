@@ -0,0 +1,16 @@
+#ifndef HUMIDITY_H
+#define HUMIDITY_H
+
+// Wilgotność bezwzględna i punkt rosy z temperatury i wilgotności względnej (wzór Magnusa).
+// Wilgotność względna spada, gdy powietrze pod okapem się nagrzewa - para z gotowania
+// potrafi się w niej schować, w wilgotności bezwzględnej i punkcie rosy już nie.
+// Własne przybliżenia exp/ln na floatach zamiast expf/logf. Czysty C++ - można sprawdzić na komputerze.
+
+// g/m³; temperature w °C, humidity w %RH. Dodatnie pressure (hPa) uwzględnia
+// współczynnik wzmocnienia dla powietrza wilgotnego (WMO), ok. +0,4 % przy 1000 hPa
+float absoluteHumidity(float temperature, float humidity, float pressure = 0);
+
+// °C; humidity poniżej 0,1 %RH liczona jak 0,1 % - wynik zawsze skończony (JSON, MQTT)
+float dewPointTemperature(float temperature, float humidity);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+
+// Wspólna magistrala I2C: VL53L0X (jeden lub dwa) i BME280. Transakcje z różnych
+// zadań idą przez jeden mutex; odczyty środowiskowe (priorytet niski) ustępują
+// próbkom gestów - gdy próbka VL53L0X czeka na odczyt, odczyt BME280 jest odkładany
+// do następnego obiegu loop(). Pojedynczej transakcji nie da się przerwać, ale przy
+// 400 kHz odczyt BME280 zajmuje magistralę na ok. 0,3 ms.
+
+#define I2C_BUS_CLOCK 400000            // Fast mode - VL53L0X do 400 kHz, BME280 do 3,4 MHz
+#define I2C_BUS_STATS_WINDOW 10000      // Okno liczenia wykorzystania magistrali (ms)
+#define I2C_DEVICE_MAX_ERRORS 3         // Kolejne błędy, po których urządzenie jest uznawane za niedostępne
+#define I2C_RETRY_MIN 1000              // Pierwsza ponowna inicjalizacja po awarii (ms)
+#define I2C_RETRY_MAX 60000             // Górna granica odstępu prób (ms), odstęp rośnie dwukrotnie
+#define I2C_CLEAR_PULSES 9              // Impulsy SCL zwalniające SDA trzymane przez urządzenie
+
+enum I2cDevice : uint8_t {
+    I2C_DEV_VL53L0X = 0,
+    I2C_DEV_VL53L0X_RIGHT,
+    I2C_DEV_BME280,
+    I2C_DEV_BME280_ROOM,
+    I2C_DEV_COUNT
+};
+
+enum I2cPriority : uint8_t {
+    I2C_PRIORITY_LOW = 0,       // Odczyty środowiskowe - mogą poczekać
+    I2C_PRIORITY_HIGH,          // Próbki gestów
+};
+
+struct I2cDeviceStats {
+    uint32_t transactions;
+    uint32_t errors;
+    uint32_t deferred;          // Odłożone na rzecz wyższego priorytetu
+    uint64_t busyUs;
+    uint32_t maxUs;
+    uint32_t lastUs;
+};
+
+// Wire.begin() na SDA_PIN/SCL_PIN z zegarem I2C_BUS_CLOCK - wywoływane z setup() przed czujnikami.
+// Najpierw czyści magistralę - reset w środku transakcji mógł zostawić SDA w stanie niskim.
+void i2cBusBegin();
+
+// Do 9 impulsów SCL, aż urządzenie zwolni SDA, potem STOP i ponowny Wire.begin().
+// false gdy SDA nadal jest w stanie niskim.
+bool i2cBusClear();
+
+// Czy czeka praca o wyższym priorytecie (np. gotowa próbka VL53L0X). Sprawdzane
+// przy każdej transakcji o niskim priorytecie - funkcja musi być szybka.
+void i2cBusSetPendingCheck(bool (*pending)());
+
+// Stan urządzenia. I2C_DEVICE_MAX_ERRORS kolejnych nieudanych transakcji oznacza je jako
+// niedostępne i czyści magistralę; właściciel urządzenia ponawia inicjalizację, gdy
+// i2cDeviceRetryDue(), i zgłasza wynik przez i2cDeviceSetOnline().
+bool i2cDeviceOnline(uint8_t device);
+bool i2cDeviceRetryDue(uint8_t device);
+void i2cDeviceSetOnline(uint8_t device, bool online);   // false wydłuża odstęp następnej próby
+
+const char* i2cDeviceName(uint8_t device);
+I2cDeviceStats i2cDeviceStats(uint8_t device);
+float i2cBusUtilization();      // % czasu z zajętą magistralą w ostatnim oknie
+void fillI2cBusStatus(JsonObject root);
+
+// Transakcja na czas życia obiektu. Niski priorytet z wait = 0 nie czeka - gdy
+// magistrala jest zajęta albo czeka próbka gestu, acquired() zwraca false.
+class I2cTransaction {
+public:
+    explicit I2cTransaction(I2cDevice device, I2cPriority priority = I2C_PRIORITY_HIGH,
+                            TickType_t wait = portMAX_DELAY);
+    ~I2cTransaction();
+
+    bool acquired() const { return _acquired; }
+    void fail() { _failed = true; }
+
+private:
+    I2cDevice _device;
+    bool _acquired;
+    bool _failed = false;
+    uint32_t _start = 0;
+};
+
+#endif
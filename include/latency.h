@@ -0,0 +1,47 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define LATENCY_WINDOW 64               // Ostatnie pomiary na gest, z których liczone są percentyle
+
+// Rodzaje gestów mierzonych osobno
+enum LatencyGesture : uint8_t {
+    LATENCY_TAP = 0,        // ON/OFF
+    LATENCY_DOUBLE_TAP,     // Pełna moc
+    LATENCY_SWIPE,          // Bieg +/-1
+    LATENCY_SLIDER,         // Tryb proporcjonalny
+    LATENCY_GESTURE_COUNT
+};
+
+// Etapy ścieżki gest -> przekaźnik, mierzone od zgłoszenia gotowej próbki przez czujnik
+enum LatencyStage : uint8_t {
+    STAGE_SAMPLED = 0,      // Pomiar odległości odczytany
+    STAGE_CLASSIFIED,       // Gest rozpoznany
+    STAGE_RELAY,            // Stan przekaźników zapisany na GPIO
+    STAGE_WS_QUEUED,        // Ramka WebSocket w kolejce
+    LATENCY_STAGE_COUNT
+};
+
+// Początek pomiaru - wywoływane po rozpoznaniu gestu, z czasem gotowości
+// i zakończenia odczytu próbki, na której gest został rozpoznany (micros)
+void latencyBegin(LatencyGesture gesture, uint32_t sampleStart, uint32_t sampleDone);
+
+// Znacznik etapu - ignorowany, gdy pomiar nie trwa albo wywołanie pochodzi
+// z innego zadania (np. zmiana biegu z API w trakcie gestu)
+void latencyMark(LatencyStage stage);
+
+// Zapisuje zakończony pomiar do okna percentyli
+void latencyEnd();
+
+// Rozmiar dokumentu /api/latency: unit + gestures, w każdym geście total, window
+// i etapy z p50/p95/p99. Klucze są stałymi napisami, więc nie zajmują miejsca w dokumencie.
+#define LATENCY_REPORT_SIZE (JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(LATENCY_GESTURE_COUNT) + \
+                             LATENCY_GESTURE_COUNT * (JSON_OBJECT_SIZE(2 + LATENCY_STAGE_COUNT) + \
+                                                      LATENCY_STAGE_COUNT * JSON_OBJECT_SIZE(3)))
+
+// Wypełnia odpowiedź /api/latency (p50/p95/p99 w mikrosekundach)
+void fillLatencyReport(JsonObject root);
+
+#endif
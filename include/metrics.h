@@ -0,0 +1,84 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+
+// Liczniki Prometheus (okap_*_total)
+enum MetricCounter : uint8_t {
+    METRIC_GESTURES = 0,
+    METRIC_API_COMMANDS,
+    METRIC_AUTO_TRIGGERS,
+    METRIC_RELAY_SWITCHES,
+    METRIC_WEBHOOK_SUCCESS,
+    METRIC_WEBHOOK_FAILURE,
+    METRIC_COUNTER_COUNT
+};
+
+// Histogramy czasu (wartości w mikrosekundach, eksport w sekundach)
+enum MetricHistogram : uint8_t {
+    METRIC_WEBHOOK_LATENCY = 0,
+    METRIC_LOOP_TIME,
+    METRIC_I2C_READ_TIME,
+    METRIC_HISTOGRAM_COUNT
+};
+
+#define METRIC_BUCKETS 10
+
+struct Histogram {
+    const uint32_t* bounds;                     // Górne granice kubełków (us), rosnąco
+    std::atomic<uint32_t> buckets[METRIC_BUCKETS + 1];   // Ostatni = +Inf
+    uint64_t sum;
+    portMUX_TYPE sumLock;
+
+    void observe(uint32_t us) {
+        uint8_t i = 0;
+        while (i < METRIC_BUCKETS && us > bounds[i]) {
+            i++;
+        }
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        portENTER_CRITICAL_SAFE(&sumLock);
+        sum += us;
+        portEXIT_CRITICAL_SAFE(&sumLock);
+    }
+};
+
+extern std::atomic<uint32_t> metricCounters[METRIC_COUNTER_COUNT];
+extern Histogram metricHistograms[METRIC_HISTOGRAM_COUNT];
+
+// Punkty pomiarowe - kilka instrukcji, bez alokacji
+inline void metricIncrement(MetricCounter counter) {
+    metricCounters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void metricObserve(MetricHistogram histogram, uint32_t us) {
+    metricHistograms[histogram].observe(us);
+}
+
+// Generator odpowiedzi /metrics w formacie tekstowym Prometheus. Renderuje po jednej
+// linii do małego bufora, więc cała odpowiedź nigdy nie jest składana w pamięci.
+class MetricsStream {
+public:
+    explicit MetricsStream(uint32_t wsClients);
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+private:
+    bool nextLine();
+
+    uint32_t _counters[METRIC_COUNTER_COUNT];
+    uint32_t _buckets[METRIC_HISTOGRAM_COUNT][METRIC_BUCKETS + 1];
+    uint64_t _sums[METRIC_HISTOGRAM_COUNT];
+    uint32_t _freeHeap;
+    uint32_t _minFreeHeap;
+    uint32_t _wsClients;
+
+    uint8_t _section = 0;
+    uint8_t _item = 0;
+    uint8_t _row = 0;
+    char _line[192];
+    size_t _lineLength = 0;
+    size_t _linePos = 0;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MQTT_H
+#define MQTT_H
+
+#include <Arduino.h>
+
+// MQTT settings
+#define DEFAULT_MQTT_PORT 1883
+#define DEFAULT_MQTT_BASE_TOPIC "okap"
+#define MQTT_RECONNECT_MIN 1000         // Pierwsza próba ponownego połączenia (ms)
+#define MQTT_RECONNECT_MAX 60000        // Maksymalny odstęp prób (ms)
+#define MQTT_OFFLINE_QUEUE 16           // Wiadomości QoS1 buforowane bez połączenia
+#define MQTT_PAYLOAD_MAX 64
+
+extern bool mqttEnabled;
+extern String mqttHost;
+extern uint16_t mqttPort;
+extern String mqttUser;
+extern String mqttPassword;
+extern String mqttBaseTopic;
+
+// Ładuje ustawienia z preferences i rozpoczyna łączenie z brokerem
+void setupMqtt();
+
+// Ponowne łączenie z backoffem - wywoływane z loop()
+void mqttLoop();
+
+// Zastosowanie nowych ustawień (rozłącza i łączy ponownie)
+void restartMqtt();
+
+// Publikuje stan (retained), jeśli zmienił się od ostatniej publikacji
+void mqttPublishState();
+
+bool mqttConnected();
+
+#endif
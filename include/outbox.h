@@ -0,0 +1,73 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <Arduino.h>
+
+// Webhook outbox (store-and-forward w pamięci flash)
+#define OUTBOX_MAX_BYTES 32768          // Maksymalny rozmiar pliku outboxa na cel
+#define OUTBOX_RECORD_MAX 8192          // Maksymalny rozmiar jednego payloadu
+#define OUTBOX_MAGIC 0x4F4B5742UL       // "OKWB"
+#define OUTBOX_HEAD_SAVE_EVERY 8        // Potwierdzone rekordy między zapisami head (zużycie flash)
+
+// Nagłówek rekordu w pliku. CRC32 liczone z pól przed crc oraz z danych.
+struct __attribute__((packed)) OutboxRecordHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t length;
+    uint8_t contentType;
+    uint8_t reserved;
+    uint32_t crc;
+};
+
+// Kolejka zdarzeń w pliku LittleFS: dopisywanie na końcu, odczyt od "head".
+// Pozycja head jest zapisywana w osobnym pliku co OUTBOX_HEAD_SAVE_EVERY rekordów
+// i na końcu serii (flush()), więc po restarcie ponownie wysłanych może być co
+// najwyżej kilka ostatnio potwierdzonych rekordów (odbiorca odróżni je po numerze
+// sekwencji). Przy przekroczeniu limitu najstarsze rekordy są usuwane, a plik kompaktowany.
+class WebhookOutbox {
+public:
+    void begin(int index);
+
+    // false także dla payloadu > OUTBOX_RECORD_MAX - ten przypadek liczy rejectedOversize
+    bool append(uint32_t sequence, uint8_t contentType, const uint8_t* payload, size_t length);
+
+    // Odczytuje najstarszy poprawny rekord (uszkodzone są pomijane)
+    bool peek(OutboxRecordHeader& header, uint8_t* payload, size_t size);
+
+    // Usuwa rekord zwrócony przez peek()
+    void pop();
+
+    // Zapisuje head odłożony przez pop() - po przerwanej serii odtwarzania
+    void flush();
+
+    // Usuwa wszystkie rekordy razem z plikami (zmiana albo usunięcie celu)
+    void clear();
+
+    bool empty() const { return _head >= _size; }
+    uint32_t pendingBytes() const { return _size - _head; }
+    uint32_t count() const { return _count; }
+
+    uint32_t droppedOverflow = 0;
+    uint32_t corrupted = 0;
+    uint32_t rejectedOversize = 0;  // Payload większy niż OUTBOX_RECORD_MAX - nie trafia do pliku
+
+private:
+    void saveHead();
+    void compact();
+    void dropOldest(size_t needed);
+    bool readHeader(uint32_t offset, OutboxRecordHeader& header);
+
+    String _path;
+    String _headPath;
+    uint32_t _head = 0;
+    uint32_t _size = 0;
+    uint32_t _peekedEnd = 0;
+    uint32_t _count = 0;
+    uint8_t _unsavedPops = 0;
+};
+
+// Montuje system plików dla outboxów; false gdy niedostępny (outbox wyłączony)
+bool setupOutboxStorage();
+extern bool outboxAvailable;
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef RANGE_FILTER_H
+#define RANGE_FILTER_H
+
+#include <stdint.h>
+
+// Kondycjonowanie odczytów odległości przed silnikiem gestów: odrzucenie próbek
+// o słabym sygnale lub silnym świetle otoczenia (para, odblaski garnków),
+// mediana z 3 próbek i opcjonalny filtr Kalmana 1-D. Stała praca na próbkę,
+// opóźnienie co najwyżej jednej próbki (mediana). Czysty C++ jak gesture_engine.
+
+struct RangeFilterConfig {
+    bool medianEnabled = true;
+    bool kalmanEnabled = false;
+    float minSignalRate = 0.5f;     // Próbki ze słabszym sygnałem odrzucane (MCPS)
+    float maxAmbientRate = 4.0f;    // Próbki przy jaśniejszym otoczeniu odrzucane (MCPS)
+    float kalmanQ = 4.0f;           // Szum procesu (mm^2 na próbkę)
+    float kalmanR = 25.0f;          // Szum pomiaru (mm^2)
+    uint16_t kalmanResetMm = 60;    // Skok większy niż ten zaczyna estymację od nowa
+};
+
+struct RangeFilterStats {
+    uint32_t samples = 0;
+    uint32_t gatedSignal = 0;       // Odrzucone przez bramkę siły sygnału
+    uint32_t gatedAmbient = 0;      // Odrzucone przez bramkę światła otoczenia
+    uint32_t suppressed = 0;        // Pojedyncze skoki usunięte przez medianę
+};
+
+class RangeFilter {
+public:
+    explicit RangeFilter(const RangeFilterConfig& config = RangeFilterConfig());
+
+    void setConfig(const RangeFilterConfig& config);
+    const RangeFilterConfig& config() const { return _config; }
+
+    // Surowa odległość (mm, ujemna gdy pomiar niepoprawny) oraz siła sygnału
+    // i światło otoczenia (MCPS). Zwraca odległość po filtracji albo -1.
+    int update(int distance, float signalRate, float ambientRate);
+
+    void reset();
+
+    const RangeFilterStats& stats() const { return _stats; }
+
+private:
+    static const int16_t NO_TARGET = 0x7FFF;    // Brak celu w medianie traktujemy jak "daleko"
+    static const int16_t SPIKE_MM = 50;         // Odstępstwo liczone jako skok w statystykach
+
+    int16_t median(int16_t value);
+    int kalman(int distance);
+
+    RangeFilterConfig _config;
+    RangeFilterStats _stats;
+
+    int16_t _window[3];
+    uint8_t _filled = 0;
+
+    bool _estimating = false;
+    float _estimate = 0;
+    float _variance = 0;
+};
+
+#endif
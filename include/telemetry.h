@@ -0,0 +1,26 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// Pojedynczy odczyt zbierany do paczki telemetrii
+struct TelemetrySample {
+    time_t timestamp;
+    int speed;
+    float temperature;
+    float humidity;
+    float absHumidity;      // g/m³
+    float dewPoint;         // °C
+    unsigned long runningTime;
+};
+
+// Okresowe wysyłanie stanu na webhook (przy zmianie/heartbeat albo paczkami, jeśli włączone)
+void sendPeriodicWebhook();
+
+// Wysyła zebrane próbki od razu (np. przed zdarzeniem zmiany biegu)
+void flushTelemetryBatch();
+
+// Liczba próbek czekających na wysłanie
+size_t telemetryPendingCount();
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "metrics.h"
+
+// Trasy API z pomiarem etapów (nagłówek Server-Timing i histogramy w /api/timing)
+enum TimingRoute : uint8_t {
+    ROUTE_STATE = 0,
+    ROUTE_DEFAULT,
+    ROUTE_GESTURE,
+    ROUTE_AUTO_SETTINGS,
+    ROUTE_WEBHOOK,
+    TIMING_ROUTE_COUNT
+};
+
+enum TimingStage : uint8_t {
+    TIMING_PARSE = 0,       // Odczyt i deserializacja ciała
+    TIMING_VALIDATE,        // Sprawdzenie wartości
+    TIMING_APPLY,           // Zmiana stanu (przekaźniki, ustawienia)
+    TIMING_PERSIST,         // Zapis do NVS
+    TIMING_NOTIFY,          // WebSocket i MQTT
+    TIMING_STAGE_COUNT
+};
+
+// Pomiar jednego żądania. mark() przypisuje czas od poprzedniego znacznika
+// do podanego etapu; send() dodaje nagłówek Server-Timing i zapisuje histogramy.
+class RequestTiming {
+public:
+    explicit RequestTiming(TimingRoute route);
+
+    void mark(TimingStage stage);
+    void send(AsyncWebServerRequest* request, int code,
+              const String& contentType = String(), const String& content = String());
+
+private:
+    TimingRoute _route;
+    uint32_t _start;
+    uint32_t _last;
+    uint32_t _stages[TIMING_STAGE_COUNT];
+    uint8_t _marked = 0;
+};
+
+// Generator odpowiedzi /api/timing - histogram całości i każdego etapu na trasę.
+// Kopiuje liczniki w konstruktorze i renderuje po jednym histogramie do małego bufora.
+class TimingStream {
+public:
+    TimingStream();
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+private:
+    bool nextPart();
+
+    uint32_t _buckets[TIMING_ROUTE_COUNT][TIMING_STAGE_COUNT + 1][METRIC_BUCKETS + 1];
+    uint64_t _sums[TIMING_ROUTE_COUNT][TIMING_STAGE_COUNT + 1];
+
+    uint8_t _section = 0;
+    uint8_t _route = 0;
+    uint8_t _item = 0;
+    char _part[256];
+    size_t _partLength = 0;
+    size_t _partPos = 0;
+};
+
+#endif
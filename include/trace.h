@@ -0,0 +1,71 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+// Rejestrator zdarzeń begin/end do analizy opóźnień (eksport /trace w formacie
+// Chrome trace_event, do otwarcia w Perfetto). Wyłączenie przez build_flags
+// -DTRACE_ENABLED=0 usuwa cały kod śledzenia z firmware.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#define TRACE_BUFFER_SIZE 512           // Zdarzenia w pierścieniu (20 B każde)
+
+#if TRACE_ENABLED
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+struct TraceEvent {
+    uint32_t cycles;        // Licznik cykli rdzenia (CCOUNT)
+    uint32_t ticks;         // Tick FreeRTOS - pozwala rozwinąć przepełnienia CCOUNT
+    const char* name;       // Literał - tylko wskaźnik, bez kopiowania
+    TaskHandle_t task;
+    char phase;             // 'B' albo 'E'
+    uint8_t core;
+};
+
+void traceRecord(const char* name, char phase);
+
+// Zdarzenie B przy wejściu do zakresu, E przy wyjściu
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : _name(name) { traceRecord(name, 'B'); }
+    ~TraceScope() { traceRecord(_name, 'E'); }
+
+private:
+    const char* _name;
+};
+
+// Generator odpowiedzi /trace. Na czas pobierania wstrzymuje zapis,
+// więc JSON powstaje wprost z pierścienia, bez kopii.
+class TraceStream {
+public:
+    TraceStream();
+    ~TraceStream();
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+private:
+    bool nextLine();
+
+    uint16_t _start;
+    uint16_t _count;
+    uint16_t _item = 0;
+    uint8_t _section = 0;
+    char _line[160];
+    size_t _lineLength = 0;
+    size_t _linePos = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef WEBHOOK_H
+#define WEBHOOK_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <IPAddress.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "outbox.h"
+
+// Webhook targets
+#define MAX_WEBHOOK_TARGETS 4
+#define WEBHOOK_QUEUE_LENGTH 8          // Zdarzenia czekające na wysłanie (na cel)
+#define WEBHOOK_PAYLOAD_MAX 512         // Maksymalny rozmiar wyrenderowanego szablonu
+#define WEBHOOK_TEMPLATE_MAX_TOKENS 32
+#define WEBHOOK_TASK_STACK 6144
+#define WEBHOOK_RETRY_MIN 2000          // Pierwsze ponowienie po błędzie (ms)
+#define WEBHOOK_RETRY_MAX 60000         // Maksymalny odstęp ponowień (ms)
+#define OUTBOX_REPLAY_INTERVAL 200      // Odstęp między rekordami przy odtwarzaniu outboxa (ms)
+#define WEBHOOK_SEQUENCE_BLOCK 256      // Numery sekwencji rezerwowane w NVS blokami
+
+// Przyczyny zdarzeń - bit w masce filtra celu
+enum WebhookCause : uint8_t {
+    CAUSE_API = 0,
+    CAUSE_GESTURE,
+    CAUSE_AUTO,
+    CAUSE_PERIODIC,
+    CAUSE_MQTT,
+    CAUSE_COUNT
+};
+
+#define CAUSE_MASK_ALL ((1 << CAUSE_COUNT) - 1)
+
+const char* webhookCauseName(uint8_t cause);
+int webhookCauseFromString(const String& name);  // -1 gdy nieznana
+
+// Zdarzenie przekazywane do kolejek celów - stały rozmiar, bez Stringów
+struct WebhookEvent {
+    uint32_t sequence;
+    time_t timestamp;
+    uint32_t runningTime;
+    float temperature;
+    float humidity;
+    float absHumidity;
+    float dewPoint;
+    int8_t speed;
+    int8_t previousSpeed;
+    uint8_t cause;
+};
+
+// Statystyki czasu wysyłania webhooka (osobno dla połączeń nowych i ponownie użytych)
+struct WebhookLatencyStats {
+    uint32_t count = 0;
+    uint32_t totalMs = 0;
+    uint32_t maxMs = 0;
+    uint32_t lastMs = 0;
+
+    void add(uint32_t ms);
+    uint32_t averageMs() const { return count ? totalMs / count : 0; }
+};
+
+// Trwałe połączenie HTTP/1.1 do jednego celu webhooka.
+// Trzyma otwarte gniazdo TCP między wywołaniami (keep-alive) i zapamiętuje
+// adres IP hosta przez WEBHOOK_DNS_TTL, żeby nie robić zapytania DNS co 10 s.
+// Jeśli serwer zamknie połączenie, kolejne wysłanie łączy się ponownie.
+class WebhookConnection {
+public:
+    WebhookConnection();
+
+    void setUrl(const String& url);
+    const String& url() const { return _url; }
+
+    // Wysyła payload (domyślnie JSON) metodą POST, z numerem sekwencji w nagłówku X-Sequence-Id.
+    // Zwraca kod HTTP albo ujemny kod błędu HTTPClient.
+    int post(const uint8_t* payload, size_t length, const char* contentType = "application/json", uint32_t sequence = 0);
+    int post(const String& payload, const char* contentType = "application/json", uint32_t sequence = 0) {
+        return post((const uint8_t*)payload.c_str(), payload.length(), contentType, sequence);
+    }
+
+    // Zamyka gniazdo i zapomina adres z cache DNS
+    void reset();
+
+    WebhookLatencyStats reusedStats;
+    WebhookLatencyStats freshStats;
+    uint32_t dnsLookups = 0;
+    uint32_t reconnects = 0;
+
+private:
+    bool parseUrl();
+    bool resolve();
+    bool ensureConnected(bool& reused);
+    int postOnce(const uint8_t* payload, size_t length, const char* contentType, uint32_t sequence, bool& reused);
+
+    String _url;
+    String _host;
+    uint16_t _port = 80;
+    bool _secure = false;
+    bool _valid = false;
+
+    IPAddress _address;
+    unsigned long _resolvedAt = 0;
+    bool _resolved = false;
+
+    WiFiClient _plainClient;
+    WiFiClientSecure _secureClient;
+    HTTPClient _http;
+    SemaphoreHandle_t _lock;
+};
+
+// Szablon payloadu z polami {{speed}}, {{previousSpeed}}, {{cause}}, {{temperature}},
+// {{humidity}}, {{absHumidity}}, {{dewPoint}}, {{runningTime}}, {{timestamp}} i {{seq}}.
+// Parsowany raz przy zapisie do listy tokenów, renderowany do bufora wywołującego bez alokacji.
+class PayloadTemplate {
+public:
+    bool compile(const String& source);
+    size_t render(const WebhookEvent& event, char* out, size_t size) const;
+    const String& source() const { return _source; }
+
+private:
+    struct Token {
+        uint8_t field;      // 0 = tekst, inaczej numer pola
+        uint16_t offset;    // Fragment _source dla tekstu
+        uint16_t length;
+    };
+
+    String _source;
+    Token _tokens[WEBHOOK_TEMPLATE_MAX_TOKENS];
+    uint8_t _tokenCount = 0;
+};
+
+extern const char* DEFAULT_WEBHOOK_TEMPLATE;
+
+// Cel webhooka - własny filtr, szablon, połączenie i kolejka z osobnym zadaniem,
+// więc niedziałający serwer nie opóźnia pozostałych celów
+struct WebhookTarget {
+    String url;
+    uint8_t causeMask = CAUSE_MASK_ALL;
+    unsigned long minInterval = 0;      // Minimalny odstęp między zdarzeniami (ms)
+    PayloadTemplate payloadTemplate;
+
+    WebhookConnection connection;
+    WebhookOutbox outbox;               // Zdarzenia niedostarczone - odtwarzane po kolei
+    QueueHandle_t queue = nullptr;
+    TaskHandle_t task = nullptr;
+    SemaphoreHandle_t lock = nullptr;
+    unsigned long lastQueuedTime = 0;
+    bool queuedOnce = false;
+
+    uint32_t delivered = 0;
+    uint32_t failed = 0;
+    uint32_t dropped = 0;       // Utracone: pełna kolejka albo nie udało się zapisać w outboxie
+    uint32_t throttled = 0;     // Pominięte przez minInterval
+};
+
+extern WebhookTarget webhookTargets[MAX_WEBHOOK_TARGETS];
+extern int webhookTargetCount;
+
+// Ładuje cele z preferences (z migracją starego pojedynczego "webhook") i uruchamia zadania
+void setupWebhooks();
+
+// Sprawdza cel bez zmiany konfiguracji: URL pusty albo http(s)://host, szablon się kompiluje
+bool validateWebhookTarget(const String& url, const String& templateSource);
+
+// Zmienia konfigurację celu; zwraca false gdy szablon się nie kompiluje
+bool configureWebhookTarget(int index, const String& url, uint8_t causeMask,
+                            unsigned long minInterval, const String& templateSource);
+void setWebhookTargetCount(int count);
+void saveWebhookTargets();
+
+// Kolejny numer sekwencji zdarzenia (rosnący, także po restarcie)
+uint32_t nextWebhookSequence();
+
+// Rozsyła zdarzenie do kolejek wszystkich pasujących celów (nie blokuje)
+void dispatchWebhookEvent(const WebhookEvent& event);
+
+// Rozsyła gotową paczkę (np. telemetrii) do celów z filtrem PERIODIC
+void dispatchWebhookBatch(const String& payload, bool ndjson);
+
+#endif
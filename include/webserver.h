@@ -7,9 +7,14 @@
 // Zewnętrzne zmienne globalne
 extern int currentSpeed;
 extern int defaultSpeed;
-extern String webhookUrl;
 extern float temperature;
 extern float humidity;
+extern float pressure;
+extern float absHumidity;      // g/m³, z temperatury, wilgotności i ciśnienia okapu
+extern float dewPoint;         // °C
+extern float roomTemperature;   // BME280 odniesienia (BME280_ROOM_ADDRESS)
+extern float roomHumidity;
+extern float roomPressure;
 extern bool gestureControlEnabled;
 extern Preferences preferences;  // Add this line
 
@@ -17,15 +22,21 @@ extern Preferences preferences;  // Add this line
 void setupWebServer();
 void sendWebhookRequest(int speed);
 void notifyClients();
-void updateSensorData();
+bool startEnvSensor();      // Inicjalizacja BME280 i pierwszy odczyt - przy starcie i po awarii
+bool startRoomSensor();     // Jw. dla czujnika odniesienia; brak = wykrywanie z tempa zmian
+bool updateSensorData();    // false - magistrala I2C zajęta, ponowić później
 void logGestureEvent(int oldSpeed, int newSpeed, const String& details);
 
+class RequestTiming;
+
+// Zmiana biegu z zewnątrz (API, MQTT) - log, przekaźniki, webhook i powiadomienia.
+// Z timing zaznacza etapy apply i notify dla nagłówka Server-Timing.
+bool applySpeedCommand(int speed, const String& source, RequestTiming* timing = nullptr);
+
 // Keep the default argument in the declaration
 void addLog(const String& cause, int fromSpeed, int toSpeed, const String& details = "");
 
 // Remove the duplicate declaration and consolidate webhook functions
 void sendWebhookRequest(int speed, const String& cause = "", int previousSpeed = -1);
 
-void sendPeriodicWebhook();
-
 #endif
@@ -0,0 +1,129 @@
+#include "bme_sensor.h"
+
+const BmePresetInfo BME_PRESETS[BME_PRESET_COUNT] = {
+    { "weather", Adafruit_BME280::MODE_FORCED,
+      Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1,
+      Adafruit_BME280::FILTER_OFF, Adafruit_BME280::STANDBY_MS_1000 },
+    { "smooth", Adafruit_BME280::MODE_FORCED,
+      Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1,
+      Adafruit_BME280::FILTER_X4, Adafruit_BME280::STANDBY_MS_1000 },
+    { "precise", Adafruit_BME280::MODE_FORCED,
+      Adafruit_BME280::SAMPLING_X2, Adafruit_BME280::SAMPLING_X4, Adafruit_BME280::SAMPLING_X2,
+      Adafruit_BME280::FILTER_X2, Adafruit_BME280::STANDBY_MS_1000 },
+    { "continuous", Adafruit_BME280::MODE_NORMAL,
+      Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1,
+      Adafruit_BME280::FILTER_OFF, Adafruit_BME280::STANDBY_MS_1000 },
+};
+
+// Wartość rejestru danych, gdy pomiar danej wielkości jest wyłączony albo jeszcze nie wykonany
+#define BME_SKIPPED_20BIT 0x80000
+#define BME_SKIPPED_16BIT 0x8000
+
+int bmePresetFromString(const String& name) {
+    for (uint8_t i = 0; i < BME_PRESET_COUNT; i++) {
+        if (name == BME_PRESETS[i].name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void BurstBME280::applyPreset(uint8_t preset) {
+    if (preset >= BME_PRESET_COUNT) {
+        preset = DEFAULT_BME_PRESET;
+    }
+    _preset = preset;
+    const BmePresetInfo& info = BME_PRESETS[preset];
+    setSampling(info.mode, info.temperature, info.pressure, info.humidity, info.filter, info.standby);
+}
+
+void BurstBME280::startMeasurement() {
+    if (forced()) {
+        write8(BME280_REGISTER_CONTROL, _measReg.get());
+    }
+}
+
+bool BurstBME280::readAll(BmeReading& reading) {
+    if (!i2c_dev) {
+        return false;
+    }
+
+    uint8_t buffer[8] = { BME280_REGISTER_PRESSUREDATA };
+    if (!i2c_dev->write_then_read(buffer, 1, buffer, sizeof(buffer))) {
+        return false;
+    }
+
+    int32_t adcP = ((uint32_t)buffer[0] << 12) | ((uint32_t)buffer[1] << 4) | (buffer[2] >> 4);
+    int32_t adcT = ((uint32_t)buffer[3] << 12) | ((uint32_t)buffer[4] << 4) | (buffer[5] >> 4);
+    int32_t adcH = ((uint32_t)buffer[6] << 8) | buffer[7];
+    // Wszystkie presety mierzą T, P i H - pominięta wielkość oznacza, że czujnik po resecie
+    // (np. spadku napięcia) wrócił do ustawień domyślnych i wymaga ponownej inicjalizacji
+    if (adcT == BME_SKIPPED_20BIT || adcP == BME_SKIPPED_20BIT || adcH == BME_SKIPPED_16BIT) {
+        return false;
+    }
+
+    // Temperatura pierwsza - ustawia t_fine dla ciśnienia i wilgotności
+    reading.temperature = compensateTemperature(adcT);
+    reading.pressure = compensatePressure(adcP) / 100.0f;
+    reading.humidity = compensateHumidity(adcH);
+    return true;
+}
+
+bool BurstBME280::readBlocking(BmeReading& reading) {
+    if (forced()) {
+        takeForcedMeasurement();
+        return readAll(reading);
+    }
+    // Tryb normal: pierwszy wynik po czasie pomiaru od setSampling()
+    for (uint8_t attempt = 0; attempt < 10; attempt++) {
+        if (readAll(reading)) {
+            return true;
+        }
+        delay(10);
+    }
+    return false;
+}
+
+// Kompensacja według noty katalogowej BME280 (rozdz. 4.2.3), jak w bibliotece
+float BurstBME280::compensateTemperature(int32_t adcT) {
+    int32_t var1 = ((((adcT >> 3) - ((int32_t)_bme280_calib.dig_T1 << 1))) *
+                    ((int32_t)_bme280_calib.dig_T2)) >> 11;
+    int32_t var2 = (((((adcT >> 4) - ((int32_t)_bme280_calib.dig_T1)) *
+                      ((adcT >> 4) - ((int32_t)_bme280_calib.dig_T1))) >> 12) *
+                    ((int32_t)_bme280_calib.dig_T3)) >> 14;
+    t_fine = var1 + var2 + t_fine_adjust;
+    return ((t_fine * 5 + 128) >> 8) / 100.0f;
+}
+
+float BurstBME280::compensatePressure(int32_t adcP) const {
+    int64_t var1 = ((int64_t)t_fine) - 128000;
+    int64_t var2 = var1 * var1 * (int64_t)_bme280_calib.dig_P6;
+    var2 = var2 + ((var1 * (int64_t)_bme280_calib.dig_P5) << 17);
+    var2 = var2 + (((int64_t)_bme280_calib.dig_P4) << 35);
+    var1 = ((var1 * var1 * (int64_t)_bme280_calib.dig_P3) >> 8) +
+           ((var1 * (int64_t)_bme280_calib.dig_P2) << 12);
+    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)_bme280_calib.dig_P1) >> 33;
+    if (var1 == 0) {
+        return NAN;
+    }
+
+    int64_t p = 1048576 - adcP;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (((int64_t)_bme280_calib.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((int64_t)_bme280_calib.dig_P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)_bme280_calib.dig_P7) << 4);
+    return p / 256.0f;
+}
+
+float BurstBME280::compensateHumidity(int32_t adcH) const {
+    int32_t v = t_fine - ((int32_t)76800);
+    v = (((((adcH << 14) - (((int32_t)_bme280_calib.dig_H4) << 20) - (((int32_t)_bme280_calib.dig_H5) * v)) +
+           ((int32_t)16384)) >> 15) *
+         (((((((v * ((int32_t)_bme280_calib.dig_H6)) >> 10) *
+              (((v * ((int32_t)_bme280_calib.dig_H3)) >> 11) + ((int32_t)32768))) >> 10) +
+            ((int32_t)2097152)) * ((int32_t)_bme280_calib.dig_H2) + 8192) >> 14));
+    v = v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)_bme280_calib.dig_H1)) >> 4);
+    v = v < 0 ? 0 : v;
+    v = v > 419430400 ? 419430400 : v;
+    return (v >> 12) / 1024.0f;
+}
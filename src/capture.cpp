@@ -0,0 +1,214 @@
+#include "capture.h"
+#include "gesture_engine.h"
+#include <atomic>
+
+static CaptureSample samples[CAPTURE_BUFFER_SIZE];
+static uint16_t sampleHead = 0;
+static uint16_t sampleCount = 0;
+static portMUX_TYPE captureLock = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<uint8_t> captureReaders(0);   // Pobierania w toku (async_tcp)
+
+static volatile CaptureMode captureMode = CAPTURE_OFF;
+static int16_t postRemaining = -1;     // Tryb wyzwalany: -1 = czekamy na gest
+static bool triggered = false;
+static uint32_t droppedSamples = 0;    // Próbki pominięte w trakcie pobierania
+static uint8_t captureLabel = CAPTURE_LABEL_NONE;
+
+static const char* CAPTURE_MODE_NAMES[CAPTURE_MODE_COUNT] = { "off", "continuous", "trigger" };
+
+const char* captureModeName(CaptureMode mode) {
+    return mode < CAPTURE_MODE_COUNT ? CAPTURE_MODE_NAMES[mode] : "unknown";
+}
+
+int captureModeFromString(const String& name) {
+    for (uint8_t i = 0; i < CAPTURE_MODE_COUNT; i++) {
+        if (name == CAPTURE_MODE_NAMES[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* captureLabelName(uint8_t label) {
+    if (label == CAPTURE_LABEL_NEGATIVE) {
+        return "negative";
+    }
+    return label == CAPTURE_LABEL_NONE ? "" : gestureTypeName((GestureType)label);
+}
+
+int captureLabelFromString(const String& name) {
+    if (name.length() == 0) {
+        return CAPTURE_LABEL_NONE;
+    }
+    if (name == "negative") {
+        return CAPTURE_LABEL_NEGATIVE;
+    }
+    for (uint8_t i = GESTURE_TAP; i < GESTURE_TYPE_COUNT; i++) {
+        if (name == gestureTypeName((GestureType)i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void captureStart(CaptureMode mode, uint8_t label) {
+    portENTER_CRITICAL(&captureLock);
+    sampleHead = 0;
+    sampleCount = 0;
+    postRemaining = -1;
+    triggered = false;
+    droppedSamples = 0;
+    captureLabel = label;
+    captureMode = mode;
+    portEXIT_CRITICAL(&captureLock);
+}
+
+void captureStop() {
+    captureMode = CAPTURE_OFF;
+}
+
+// FixPoint1616 -> Q8.8 z nasyceniem
+static uint16_t toQ88(uint32_t value) {
+    value >>= 8;
+    return value > 0xFFFF ? 0xFFFF : value;
+}
+
+void captureRecord(uint32_t time, uint16_t range, uint8_t status, uint8_t gesture,
+                   uint32_t signalRate, uint32_t ambientRate) {
+    if (captureMode == CAPTURE_OFF) {
+        return;
+    }
+
+    // Sprawdzenie pod blokadą - inaczej pobieranie mogłoby wystartować między
+    // sprawdzeniem a zapisem i czytać nadpisywaną próbkę
+    portENTER_CRITICAL(&captureLock);
+    if (captureReaders) {
+        droppedSamples++;
+        portEXIT_CRITICAL(&captureLock);
+        return;
+    }
+    CaptureSample& sample = samples[sampleHead];
+    sample.time = time;
+    sample.range = range;
+    sample.status = status;
+    sample.gesture = gesture;
+    sample.signalRate = toQ88(signalRate);
+    sample.ambientRate = toQ88(ambientRate);
+    sampleHead = (sampleHead + 1) % CAPTURE_BUFFER_SIZE;
+    if (sampleCount < CAPTURE_BUFFER_SIZE) {
+        sampleCount++;
+    }
+
+    if (captureMode == CAPTURE_TRIGGER) {
+        if (postRemaining < 0 && gesture != 0) {
+            postRemaining = CAPTURE_POST_SAMPLES;
+            triggered = true;
+        } else if (postRemaining > 0 && --postRemaining == 0) {
+            captureMode = CAPTURE_OFF;
+        }
+    }
+    portEXIT_CRITICAL(&captureLock);
+}
+
+void fillCaptureStatus(JsonObject root) {
+    portENTER_CRITICAL(&captureLock);
+    CaptureMode mode = captureMode;
+    uint16_t count = sampleCount;
+    bool wasTriggered = triggered;
+    uint32_t dropped = droppedSamples;
+    uint32_t first = count ? samples[(sampleHead + CAPTURE_BUFFER_SIZE - count) % CAPTURE_BUFFER_SIZE].time : 0;
+    uint32_t last = count ? samples[(sampleHead + CAPTURE_BUFFER_SIZE - 1) % CAPTURE_BUFFER_SIZE].time : 0;
+    portEXIT_CRITICAL(&captureLock);
+
+    root["mode"] = captureModeName(mode);
+    root["label"] = captureLabelName(captureLabel);
+    root["samples"] = count;
+    root["capacity"] = CAPTURE_BUFFER_SIZE;
+    root["durationMs"] = last - first;
+    root["triggered"] = wasTriggered;
+    root["dropped"] = dropped;
+    root["formatVersion"] = CAPTURE_FORMAT_VERSION;
+}
+
+CaptureStream::CaptureStream(bool binary) : _binary(binary) {
+    // Po wstrzymaniu zapisu pierścień już się nie zmienia
+    portENTER_CRITICAL(&captureLock);
+    captureReaders++;
+    _count = sampleCount;
+    _start = (sampleHead + CAPTURE_BUFFER_SIZE - sampleCount) % CAPTURE_BUFFER_SIZE;
+    _label = captureLabel;
+    portEXIT_CRITICAL(&captureLock);
+}
+
+CaptureStream::~CaptureStream() {
+    captureReaders--;
+}
+
+static void putU16(uint8_t* out, uint16_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    putU16(out, value);
+    putU16(out + 2, value >> 16);
+}
+
+bool CaptureStream::nextChunk() {
+    if (_item >= (int32_t)_count) {
+        return false;
+    }
+
+    if (_item < 0) {
+        if (_binary) {
+            memcpy(_chunk, "OKCP", 4);
+            _chunk[4] = CAPTURE_FORMAT_VERSION;
+            _chunk[5] = sizeof(CaptureSample);
+            _chunk[6] = _label;
+            _chunk[7] = 0;
+            putU32(_chunk + 8, _count);
+            putU32(_chunk + 12, _count ? samples[_start].time : 0);
+            _chunkLength = 16;
+        } else {
+            _chunkLength = snprintf((char*)_chunk, sizeof(_chunk),
+                                    "time_ms,range_mm,status,gesture,signal_mcps,ambient_mcps\n");
+        }
+        _item = 0;
+        _chunkPos = 0;
+        return true;
+    }
+
+    const CaptureSample& sample = samples[(_start + _item) % CAPTURE_BUFFER_SIZE];
+    if (_binary) {
+        // Pole po polu - nie zależy od układu struktury w pamięci
+        putU32(_chunk, sample.time);
+        putU16(_chunk + 4, sample.range);
+        _chunk[6] = sample.status;
+        _chunk[7] = sample.gesture;
+        putU16(_chunk + 8, sample.signalRate);
+        putU16(_chunk + 10, sample.ambientRate);
+        _chunkLength = sizeof(CaptureSample);
+    } else {
+        int length = snprintf((char*)_chunk, sizeof(_chunk), "%lu,%u,%u,%u,%.3f,%.3f\n",
+                              (unsigned long)sample.time, sample.range, sample.status, sample.gesture,
+                              sample.signalRate / 256.0f, sample.ambientRate / 256.0f);
+        _chunkLength = (size_t)length < sizeof(_chunk) ? length : sizeof(_chunk) - 1;
+    }
+    _item++;
+    _chunkPos = 0;
+    return true;
+}
+
+size_t CaptureStream::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (_chunkPos >= _chunkLength && !nextChunk()) {
+            break;
+        }
+        size_t count = min(maxLen - written, _chunkLength - _chunkPos);
+        memcpy(buffer + written, _chunk + _chunkPos, count);
+        written += count;
+        _chunkPos += count;
+    }
+    return written;
+}
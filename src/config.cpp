@@ -3,19 +3,35 @@
 #include <Adafruit_BME280.h>
 
 // Definicja zmiennej bme
-Adafruit_BME280 bme;
+BurstBME280 bme;
+BurstBME280 bmeRoom;
 
 // Define the actual storage for speedLogs
 std::vector<LogEntry> speedLogs;
 
 float lastTemperature = 0.0f;
-float lastHumidity = 0.0f;
+float lastAbsHumidity = 0.0f;
+float lastDewPoint = 0.0f;
 unsigned long lastMonitoringTime = 0;
 
 float tempRiseThreshold = DEFAULT_TEMP_THRESHOLD;
-float humRiseThreshold = DEFAULT_HUM_THRESHOLD;
+float ahRiseThreshold = DEFAULT_AH_THRESHOLD;
 unsigned long monitoringInterval = DEFAULT_CHECK_INTERVAL;
 bool autoActivationEnabled = true;
+float diffTempThreshold = DEFAULT_DIFF_TEMP_THRESHOLD;
+float diffAhThreshold = DEFAULT_DIFF_AH_THRESHOLD;
+
+bool webhookKeepAlive = true;
+
+bool telemetryBatchEnabled = false;
+unsigned long telemetrySampleInterval = DEFAULT_TELEMETRY_SAMPLE_INTERVAL;
+int telemetryBatchSize = DEFAULT_TELEMETRY_BATCH_SIZE;
+unsigned long telemetryBatchMaxAge = DEFAULT_TELEMETRY_BATCH_AGE;
+bool telemetryNdjson = false;
+
+unsigned long heartbeatInterval = DEFAULT_HEARTBEAT_INTERVAL;
+float tempDeadband = DEFAULT_TEMP_DEADBAND;
+float humDeadband = DEFAULT_HUM_DEADBAND;
 
 // Network settings
 bool dhcpEnabled = true;
@@ -0,0 +1,292 @@
+#include <esp_freertos_hooks.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "diagnostics.h"
+
+static TaskHandle_t loopTaskHandle = nullptr;
+static TaskHandle_t asyncTaskHandle = nullptr;
+static esp_reset_reason_t resetReason = ESP_RST_UNKNOWN;
+
+static DiagSnapshot history[DIAG_HISTORY_SIZE];
+static uint8_t historyHead = 0;
+static uint8_t historyCount = 0;
+static portMUX_TYPE historyLock = portMUX_INITIALIZER_UNLOCKED;
+static unsigned long lastSnapshotTime = 0;
+
+// Próbki hooka ticka. Liczniki rosną od startu; przy migawce zapamiętujemy ich stan
+// i udział liczymy z przyrostu od poprzedniej migawki.
+struct CpuSlot {
+    TaskHandle_t task;
+    uint32_t samples;
+    uint32_t snapshotSamples;   // Stan licznika przy ostatniej migawce
+    uint16_t permille;          // Udział w oknie między dwiema ostatnimi migawkami (‰ rdzenia)
+};
+
+static CpuSlot cpuSlots[DIAG_MAX_TASKS];
+static uint8_t cpuSlotCount = 0;
+static uint32_t coreSamples[DIAG_CPU_CORES];
+static uint32_t coreIdleSamples[DIAG_CPU_CORES];
+static uint32_t coreSnapshotSamples[DIAG_CPU_CORES];
+static uint32_t coreSnapshotIdle[DIAG_CPU_CORES];
+static TaskHandle_t idleTasks[DIAG_CPU_CORES];
+static portMUX_TYPE cpuLock = portMUX_INITIALIZER_UNLOCKED;
+
+#if configUSE_TRACE_FACILITY
+// Bufor statyczny - /api/diag nie może sam pogarszać sytuacji na stercie.
+// Używany tylko w konstruktorze DiagStream w zadaniu async_tcp, więc nie wymaga blokady.
+static TaskStatus_t taskStatus[DIAG_MAX_TASKS];
+#endif
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON: return "POWERON";
+        case ESP_RST_EXT: return "EXT";
+        case ESP_RST_SW: return "SW";
+        case ESP_RST_PANIC: return "PANIC";
+        case ESP_RST_INT_WDT: return "INT_WDT";
+        case ESP_RST_TASK_WDT: return "TASK_WDT";
+        case ESP_RST_WDT: return "WDT";
+        case ESP_RST_DEEPSLEEP: return "DEEPSLEEP";
+        case ESP_RST_BROWNOUT: return "BROWNOUT";
+        case ESP_RST_SDIO: return "SDIO";
+        default: return "UNKNOWN";
+    }
+}
+
+static uint32_t uptimeSeconds() {
+    return esp_timer_get_time() / 1000000ULL;
+}
+
+// Zadanie AsyncTCP powstaje dopiero przy starcie serwera - szukamy go leniwie
+static TaskHandle_t asyncTask() {
+    if (!asyncTaskHandle) {
+        asyncTaskHandle = xTaskGetHandle("async_tcp");
+    }
+    return asyncTaskHandle;
+}
+
+static DiagSnapshot takeSnapshot() {
+    DiagSnapshot snapshot = {};
+    snapshot.uptime = uptimeSeconds();
+    snapshot.freeHeap = ESP.getFreeHeap();
+    snapshot.minFreeHeap = ESP.getMinFreeHeap();
+    snapshot.largestFreeBlock = ESP.getMaxAllocHeap();
+    snapshot.loopStackFree = loopTaskHandle ? uxTaskGetStackHighWaterMark(loopTaskHandle) : 0;
+    TaskHandle_t async = asyncTask();
+    snapshot.asyncStackFree = async ? uxTaskGetStackHighWaterMark(async) : 0;
+    return snapshot;
+}
+
+// Wywoływane z przerwania ticka na każdym rdzeniu - tylko kod i dane w IRAM/DRAM
+static void IRAM_ATTR sampleCpuTick() {
+    BaseType_t core = xPortGetCoreID();
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL_ISR(&cpuLock);
+    coreSamples[core]++;
+    if (task == idleTasks[core]) {
+        coreIdleSamples[core]++;
+    }
+    uint8_t i = 0;
+    while (i < cpuSlotCount && cpuSlots[i].task != task) {
+        i++;
+    }
+    if (i == cpuSlotCount && cpuSlotCount < DIAG_MAX_TASKS) {
+        cpuSlots[cpuSlotCount++] = { task, 0, 0, 0 };
+    }
+    if (i < cpuSlotCount) {
+        cpuSlots[i].samples++;
+    }
+    portEXIT_CRITICAL_ISR(&cpuLock);
+}
+
+// Zamyka okno pomiaru CPU: udział zadań i obciążenie rdzeni od poprzedniej migawki
+static void closeCpuWindow(DiagSnapshot& snapshot) {
+    portENTER_CRITICAL(&cpuLock);
+    uint32_t ticks = 0;
+    for (uint8_t core = 0; core < DIAG_CPU_CORES; core++) {
+        uint32_t samples = coreSamples[core] - coreSnapshotSamples[core];
+        uint32_t idle = coreIdleSamples[core] - coreSnapshotIdle[core];
+        snapshot.cpuLoad[core] = samples ? 100 - idle * 100 / samples : 0;
+        coreSnapshotSamples[core] = coreSamples[core];
+        coreSnapshotIdle[core] = coreIdleSamples[core];
+        ticks = max(ticks, samples);
+    }
+    // Udział względem jednego rdzenia - przy dwóch rdzeniach suma to 200%
+    for (uint8_t i = 0; i < cpuSlotCount; i++) {
+        CpuSlot& slot = cpuSlots[i];
+        uint32_t samples = slot.samples - slot.snapshotSamples;
+        slot.permille = ticks ? (uint64_t)samples * 1000 / ticks : 0;
+        slot.snapshotSamples = slot.samples;
+    }
+    portEXIT_CRITICAL(&cpuLock);
+}
+
+static float taskCpuPercent(TaskHandle_t task) {
+    float percent = 0;
+    portENTER_CRITICAL(&cpuLock);
+    for (uint8_t i = 0; i < cpuSlotCount; i++) {
+        if (cpuSlots[i].task == task) {
+            percent = cpuSlots[i].permille / 10.0f;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&cpuLock);
+    return percent;
+}
+
+void setupDiagnostics() {
+    loopTaskHandle = xTaskGetCurrentTaskHandle();
+    for (uint8_t core = 0; core < DIAG_CPU_CORES; core++) {
+        idleTasks[core] = xTaskGetIdleTaskHandleForCPU(core);
+        esp_register_freertos_tick_hook_for_cpu(sampleCpuTick, core);
+    }
+    resetReason = esp_reset_reason();
+    Serial.printf("Przyczyna resetu: %s\n", resetReasonName(resetReason));
+}
+
+void diagnosticsLoop() {
+    if (historyCount > 0 && millis() - lastSnapshotTime < DIAG_SNAPSHOT_INTERVAL) {
+        return;
+    }
+    lastSnapshotTime = millis();
+
+    DiagSnapshot snapshot = takeSnapshot();
+    closeCpuWindow(snapshot);
+    portENTER_CRITICAL(&historyLock);
+    history[historyHead] = snapshot;
+    historyHead = (historyHead + 1) % DIAG_HISTORY_SIZE;
+    if (historyCount < DIAG_HISTORY_SIZE) {
+        historyCount++;
+    }
+    portEXIT_CRITICAL(&historyLock);
+}
+
+enum DiagSection : uint8_t {
+    SECTION_HEAD = 0,       // uptime, resetReason, heap, początek "tasks"
+    SECTION_TASKS,
+    SECTION_MIDDLE,         // koniec "tasks", okno CPU, początek "history"
+    SECTION_HISTORY,
+    SECTION_END,
+    SECTION_DONE
+};
+
+DiagStream::DiagStream() {
+    _now = takeSnapshot();
+
+#if configUSE_TRACE_FACILITY
+    UBaseType_t count = uxTaskGetSystemState(taskStatus, DIAG_MAX_TASKS, nullptr);
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t& status = taskStatus[i];
+        TaskInfo& task = _tasks[_taskCount++];
+        strlcpy(task.name, status.pcTaskName, sizeof(task.name));
+        task.priority = status.uxCurrentPriority;
+        task.stackFree = status.usStackHighWaterMark;
+        task.cpuPercent = taskCpuPercent(status.xHandle);
+    }
+#else
+    // Bez trace facility raportujemy tylko zadania, których uchwyty znamy
+    const TaskHandle_t handles[] = { loopTaskHandle, asyncTask() };
+    for (TaskHandle_t handle : handles) {
+        if (!handle) {
+            continue;
+        }
+        TaskInfo& task = _tasks[_taskCount++];
+        strlcpy(task.name, pcTaskGetTaskName(handle), sizeof(task.name));
+        task.priority = uxTaskPriorityGet(handle);
+        task.stackFree = uxTaskGetStackHighWaterMark(handle);
+        task.cpuPercent = taskCpuPercent(handle);
+    }
+#endif
+
+    // Od najstarszej migawki
+    portENTER_CRITICAL(&historyLock);
+    for (uint8_t i = 0; i < historyCount; i++) {
+        _history[i] = history[(historyHead + DIAG_HISTORY_SIZE - historyCount + i) % DIAG_HISTORY_SIZE];
+    }
+    _historyCount = historyCount;
+    portEXIT_CRITICAL(&historyLock);
+}
+
+bool DiagStream::nextPart() {
+    int length = -1;
+
+    while (length < 0) {
+        switch (_section) {
+            case SECTION_HEAD:
+                length = snprintf(_part, sizeof(_part),
+                                  "{\"uptime\":%u,\"resetReason\":\"%s\",\"heap\":{\"free\":%u,\"minFree\":%u,"
+                                  "\"largestBlock\":%u,\"size\":%u},\"tasks\":[",
+                                  _now.uptime, resetReasonName(resetReason), _now.freeHeap,
+                                  _now.minFreeHeap, _now.largestFreeBlock, ESP.getHeapSize());
+                _section++;
+                break;
+
+            case SECTION_TASKS: {
+                if (_item >= _taskCount) {
+                    _section++;
+                    _item = 0;
+                    break;
+                }
+                const TaskInfo& task = _tasks[_item];
+                length = snprintf(_part, sizeof(_part),
+                                  "%s{\"name\":\"%s\",\"priority\":%u,\"stackFree\":%u,\"cpuPercent\":%.1f}",
+                                  _item ? "," : "", task.name, task.priority, task.stackFree, task.cpuPercent);
+                _item++;
+                break;
+            }
+
+            case SECTION_MIDDLE:
+                // cpuPercent zadań dotyczy okna między dwiema ostatnimi migawkami
+                length = snprintf(_part, sizeof(_part), "],\"cpuWindowSec\":%u,\"history\":[",
+                                  (unsigned)(DIAG_SNAPSHOT_INTERVAL / 1000));
+                _section++;
+                break;
+
+            case SECTION_HISTORY: {
+                if (_item >= _historyCount) {
+                    _section++;
+                    _item = 0;
+                    break;
+                }
+                const DiagSnapshot& snapshot = _history[_item];
+                length = snprintf(_part, sizeof(_part),
+                                  "%s{\"uptime\":%u,\"free\":%u,\"minFree\":%u,\"largestBlock\":%u,"
+                                  "\"loopStack\":%u,\"asyncStack\":%u,\"cpuLoad\":[%u,%u]}",
+                                  _item ? "," : "", snapshot.uptime, snapshot.freeHeap, snapshot.minFreeHeap,
+                                  snapshot.largestFreeBlock, snapshot.loopStackFree, snapshot.asyncStackFree,
+                                  snapshot.cpuLoad[0], snapshot.cpuLoad[1]);
+                _item++;
+                break;
+            }
+
+            case SECTION_END:
+                length = snprintf(_part, sizeof(_part), "]}");
+                _section++;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    _partLength = (size_t)length < sizeof(_part) ? length : sizeof(_part) - 1;
+    _partPos = 0;
+    return true;
+}
+
+size_t DiagStream::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (_partPos >= _partLength && !nextPart()) {
+            break;
+        }
+        size_t count = min(maxLen - written, _partLength - _partPos);
+        memcpy(buffer + written, _part + _partPos, count);
+        written += count;
+        _partPos += count;
+    }
+    return written;
+}
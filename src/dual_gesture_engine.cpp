@@ -0,0 +1,125 @@
+#include "dual_gesture_engine.h"
+#include <initializer_list>
+
+DualGestureEngine::DualGestureEngine(const GestureConfig& config) : _primary(config) {
+}
+
+void DualGestureEngine::setConfig(const GestureConfig& config) {
+    _primary.setConfig(config);
+    reset();
+}
+
+void DualGestureEngine::setDual(bool dual) {
+    _dual = dual;
+    reset();
+}
+
+void DualGestureEngine::reset() {
+    _primary.reset();
+    _left = Side();
+    _right = Side();
+    _held = false;
+}
+
+static bool isSegmentGesture(GestureType type) {
+    return type == GESTURE_TAP || type == GESTURE_DOUBLE_TAP ||
+           type == GESTURE_APPROACH || type == GESTURE_RETREAT;
+}
+
+GestureResult DualGestureEngine::update(uint32_t now, int distance) {
+    GestureResult gesture = _primary.update(now, distance);
+    if (!_dual) {
+        return gesture;
+    }
+
+    track(_left, now, distance);
+    GestureResult swipe;
+    if (lateral(now, swipe)) {
+        return swipe;
+    }
+
+    GestureResult released = releaseHeld(now);
+    if (isSegmentGesture(gesture.type)) {
+        // Swipe tuż po tapie przychodzi próbkę po nim - wstrzymany tap nie może przepaść
+        if (_held && released.type == GESTURE_NONE) {
+            released = _heldResult;
+        }
+        _held = true;
+        _heldResult = gesture;
+        _heldTime = now;
+        return released;
+    }
+    return released.type != GESTURE_NONE ? released : gesture;
+}
+
+GestureResult DualGestureEngine::updateSecondary(uint32_t now, int distance) {
+    if (!_dual) {
+        return GestureResult();
+    }
+
+    track(_right, now, distance);
+    GestureResult swipe;
+    if (lateral(now, swipe)) {
+        return swipe;
+    }
+    return releaseHeld(now);
+}
+
+void DualGestureEngine::track(Side& side, uint32_t now, int distance) {
+    const GestureConfig& config = _primary.config();
+    bool inWindow = distance >= config.minDistance && distance <= config.maxDistance;
+    if (inWindow && !side.inWindow) {
+        side.enter = now;
+        side.seen = true;
+    } else if (!inWindow && side.inWindow) {
+        side.leave = now;
+    }
+    side.inWindow = inWindow;
+}
+
+// Ocena po wyjściu dłoni spod obu czujników: obie obecności krótkie, wejścia
+// przesunięte w czasie w tę samą stronę co wyjścia
+bool DualGestureEngine::lateral(uint32_t now, GestureResult& result) {
+    const GestureConfig& config = _primary.config();
+    uint32_t expiry = config.swipeMaxMs + config.lateralGapMs;
+    for (Side* side : { &_left, &_right }) {
+        if (side->seen && !side->inWindow && now - side->leave > expiry) {
+            side->seen = false;
+        }
+    }
+    if (!_left.seen || !_right.seen || _left.inWindow || _right.inWindow) {
+        return false;
+    }
+    _left.seen = false;
+    _right.seen = false;
+
+    bool quick = _left.leave - _left.enter <= config.swipeMaxMs &&
+                 _right.leave - _right.enter <= config.swipeMaxMs;
+    int32_t enterGap = (int32_t)(_right.enter - _left.enter);
+    int32_t leaveGap = (int32_t)(_right.leave - _left.leave);
+    int32_t gap = enterGap < 0 ? -enterGap : enterGap;
+    if (!quick || gap < config.lateralMinGapMs || gap > config.lateralGapMs ||
+        (enterGap > 0) != (leaveGap > 0)) {
+        return false;
+    }
+
+    // Lewy czujnik mógł w tym czasie uznać przejście za tap - odrzucamy go
+    _primary.reset();
+    _held = false;
+    result.type = enterGap > 0 ? GESTURE_SWIPE_RIGHT : GESTURE_SWIPE_LEFT;
+    return true;
+}
+
+// Wstrzymany gest lewego czujnika wychodzi po lateralWaitMs, chyba że dłoń jest jeszcze
+// pod prawym czujnikiem na tyle krótko, że może to być ruch poprzeczny
+GestureResult DualGestureEngine::releaseHeld(uint32_t now) {
+    const GestureConfig& config = _primary.config();
+    if (!_held || now - _heldTime < config.lateralWaitMs) {
+        return GestureResult();
+    }
+    if (_right.inWindow && now - _right.enter <= config.swipeMaxMs) {
+        return GestureResult();
+    }
+    _held = false;
+    return _heldResult;
+}
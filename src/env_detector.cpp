@@ -0,0 +1,58 @@
+#include "env_detector.h"
+
+DifferentialDetector::DifferentialDetector(const DifferentialConfig& config) : _config(config) {
+}
+
+void DifferentialDetector::reset() {
+    _ready = false;
+    _active = false;
+    _above = 0;
+    _deltaTemp = 0;
+    _deltaAh = 0;
+}
+
+bool DifferentialDetector::update(uint32_t now, float hoodTemp, float hoodAh, float roomTemp, float roomAh,
+                                  bool holdBaseline) {
+    float diffTemp = hoodTemp - roomTemp;
+    float diffAh = hoodAh - roomAh;
+    if (!_ready) {
+        _ready = true;
+        _lastTime = now;
+        _baselineTemp = diffTemp;
+        _baselineAh = diffAh;
+    }
+
+    _deltaTemp = diffTemp - _baselineTemp;
+    _deltaAh = diffAh - _baselineAh;
+    bool above = _deltaTemp >= _config.tempThreshold || _deltaAh >= _config.ahThreshold;
+    // Histereza: koniec gotowania dopiero poniżej połowy obu progów
+    bool quiet = _deltaTemp < _config.tempThreshold / 2 && _deltaAh < _config.ahThreshold / 2;
+
+    // Linia bazowa uczy się tylko w spoczynku, inaczej wolne gotowanie (duszenie)
+    // zostałoby wchłonięte
+    uint32_t elapsed = now - _lastTime;
+    _lastTime = now;
+    if (!holdBaseline && !_active && quiet && _config.baselineTauMs > 0) {
+        float alpha = (float)elapsed / _config.baselineTauMs;
+        if (alpha > 1.0f) {
+            alpha = 1.0f;
+        }
+        _baselineTemp += alpha * (diffTemp - _baselineTemp);
+        _baselineAh += alpha * (diffAh - _baselineAh);
+    }
+
+    if (_active) {
+        if (quiet) {
+            _active = false;
+            _above = 0;
+        }
+        return false;
+    }
+
+    _above = above ? _above + 1 : 0;
+    if (_above >= _config.confirmSamples) {
+        _active = true;
+        return true;
+    }
+    return false;
+}
@@ -1,91 +1,777 @@
+#include <Wire.h>
 #include "gesture.h"
 #include "config.h"
 #include "relays.h"
 #include "webserver.h"
+#include "metrics.h"
+#include "trace.h"
+#include "latency.h"
+#include "capture.h"
+#include "i2c_bus.h"
 // Definicja sensora VL53L0X
 Adafruit_VL53L0X lox;
 
+// Drugi (prawy) czujnik - opcjonalny, przenoszony pod VL53L0X_RIGHT_ADDRESS przy starcie
+Adafruit_VL53L0X loxRight;
+bool dualSensors = false;
+int rightDistance = -1;
+static bool rightExpected = false;          // Prawy czujnik był obecny - po awarii próbujemy go przywrócić
+static RangeFilter rightFilter;
+
 // Zmienne związane z gestami
-unsigned long gestureStartTime = 0;
-bool gestureDetected = false;
-bool holdDetected = false;
-const int gestureThreshold = 200;  // Czas (ms) na wykrycie machnięcia ręką
-const int holdThreshold = 1000;    // Czas (ms) na wykrycie przytrzymania ręki
+bool gestureDetected = false;      // Dłoń w oknie gestów
+bool holdDetected = false;         // Tryb proporcjonalny aktywny
+
+GestureConfig gestureConfig;
+static DualGestureEngine gestureEngine;
+static volatile bool gestureConfigPending = false;
+
+static void loadGestureConfig();
+static void loadRangeFilterConfig();
+
+// Filtr odczytów przed silnikiem gestów. Drugi silnik dostaje surowe odczyty -
+// liczniki obu pokazują, ile gestów filtr odrzucił jako fałszywe.
+RangeFilterConfig rangeFilterConfig;
+static RangeFilter rangeFilter;
+static GestureEngine rawGestureEngine;
+static uint32_t rawGestureCount = 0;
+static uint32_t filteredGestureCount = 0;
+static volatile bool rangeFilterPending = false;
+
+bool autoCalibration = true;
+int calibrationBaseline = -1;
+uint16_t userMaxDistance = GestureConfig().maxDistance;
+static uint16_t calibrationLimit = UINT16_MAX;  // Granica okna z ostatniej kalibracji, UINT16_MAX = brak
+static GestureCalibrator calibrator;
+static bool calibrated = false;             // Okno pochodzi z kalibracji (jest z czym porównać tło)
+static bool calibrationManual = false;
+static volatile bool calibrationRequested = false;
+static unsigned long nextCalibration = 0;
 
 // Add global variable
 int currentDistance = 0;
 
-void setupGesture() {
-    if (!lox.begin()) {
-        Serial.println("Błąd inicjalizacji VL53L0X! Sprawdź połączenia.");
-        while (1);
+const RangingProfileInfo RANGING_PROFILES[RANGING_PROFILE_COUNT] = {
+    { "highSpeed", 20000, 0.25f, 32.0f },
+    { "balanced", 33000, 0.25f, 18.0f },
+    { "highAccuracy", 200000, 0.25f, 18.0f },
+};
+
+uint8_t rangingProfile = DEFAULT_RANGING_PROFILE;
+float signalRateLimit = RANGING_PROFILES[DEFAULT_RANGING_PROFILE].signalRate;
+float sigmaLimit = RANGING_PROFILES[DEFAULT_RANGING_PROFILE].sigma;
+
+bool adaptiveSampling = true;
+
+static volatile bool rangingConfigPending = false;
+
+// Próbkowanie adaptacyjne: wolno bez nikogo w pobliżu, pełna szybkość przy zbliżeniu
+static bool burstMode = false;
+static unsigned long lastActivityTime = 0;
+
+// Częstotliwość próbkowania liczona w oknach jednosekundowych
+static uint32_t rateSamples = 0;
+static unsigned long rateWindowStart = 0;
+static float sampleRate = 0;
+
+// Ostatnie poprawne odległości do oceny szumu
+static uint16_t noiseWindow[RANGING_NOISE_WINDOW];
+static uint8_t noiseHead = 0;
+static uint8_t noiseCount = 0;
+static portMUX_TYPE noiseLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Pomiar gotowy - ustawiane w przerwaniu GPIO1 czujnika (data ready, stan niski)
+static volatile bool rangeReady = false;
+static volatile unsigned long rangeReadyTime = 0;
+static unsigned long lastRangeTime = 0;
+
+static void IRAM_ATTR onRangeReady() {
+    rangeReadyTime = micros();
+    rangeReady = true;
+}
+
+// Przy dwóch czujnikach pomiary pojedyncze na zmianę: lewy, prawy, lewy... Czujniki nie
+// świecą jednocześnie (brak przesłuchu), a następny pomiar startuje zaraz po odczycie
+// poprzedniego, więc loop() nadal nie czeka.
+enum RangingSensorId : uint8_t { SENSOR_LEFT = 0, SENSOR_RIGHT, SENSOR_NONE };
+
+static volatile bool rightReady = false;
+static volatile unsigned long rightReadyTime = 0;
+static uint8_t activeSensor = SENSOR_LEFT;
+static unsigned long pairStartTime = 0;
+
+static void IRAM_ATTR onRightRangeReady() {
+    rightReadyTime = micros();
+    rightReady = true;
+}
+
+// Gotowa próbka ma pierwszeństwo przed odczytem BME280 (i2cBusSetPendingCheck)
+static bool gestureSamplePending() {
+    return gestureControlEnabled && i2cDeviceOnline(I2C_DEV_VL53L0X) &&
+           (rangeReady || (dualSensors && rightReady));
+}
+
+int rangingProfileFromString(const String& name) {
+    for (uint8_t i = 0; i < RANGING_PROFILE_COUNT; i++) {
+        if (name == RANGING_PROFILES[i].name) {
+            return i;
+        }
     }
-    Serial.println("VL53L0X zainicjalizowany!");
+    return -1;
 }
 
-void processGesture() {
-    static unsigned long presenceStartTime = 0;
-    static unsigned long lastStepTime = 0;
-    static int lastValidDistance = 0;
-
-    VL53L0X_RangingMeasurementData_t measure;
-    lox.rangingTest(&measure, false);
-
-    if (measure.RangeStatus != 4) {
-        currentDistance = measure.RangeMilliMeter;
-
-        // Only process gestures when distance is within valid range (50-200mm)
-        if (currentDistance >= 50 && currentDistance <= 200) {
-            if (presenceStartTime == 0) {
-                presenceStartTime = millis();
-                lastStepTime = millis();
-            }
-
-            // Hold gesture detection
-            if (millis() - presenceStartTime > 3000) {
-                if (millis() - lastStepTime >= 3000) {
-                    Serial.println("Wykryto przytrzymanie ręki - zwiększanie biegu!");
-                    int newSpeed = (currentSpeed + 1) % 5;
-                    String details = "Hand hold - changing speed (distance: " + String(currentDistance) + "mm)";
-                    int oldSpeed = currentSpeed;
-                    logGestureEvent(currentSpeed, newSpeed, details);
-                    currentSpeed = newSpeed;
-                    setFanSpeed(currentSpeed);
-                    lastStepTime = millis();
-                    sendWebhookRequest(currentSpeed, "GESTURE", oldSpeed);
-                    notifyClients();
-                }
-            }
-        } else {
-            // Hand moved away - check if it was a quick gesture
-            if (presenceStartTime > 0 && millis() - presenceStartTime <= 3000) {
-                Serial.println("Wykryto kliknięcie - ON/OFF!");
-                int oldSpeed = currentSpeed;
-                currentSpeed = (currentSpeed == 0) ? defaultSpeed : 0;
-                String details = "Hand gesture - " + 
-                       String(currentSpeed == 0 ? "turning off" : "turning on") +
-                       " (distance: " + String(currentDistance) + "mm)";
-                
-                if (currentSpeed == 0) {
-                    logGestureEvent(defaultSpeed, 0, details);
-                } else {
-                    logGestureEvent(0, defaultSpeed, details);
-                }
-                
-                setFanSpeed(currentSpeed);
-                sendWebhookRequest(currentSpeed, "GESTURE", oldSpeed);
-                notifyClients();
-            }
-            
-            // Reset when hand is away
-            presenceStartTime = 0;
-            holdDetected = false;
-        }
-
-        lastValidDistance = currentDistance;
+static void resetRangingStats() {
+    rateSamples = 0;
+    rateWindowStart = millis();
+    sampleRate = 0;
+    portENTER_CRITICAL(&noiseLock);
+    noiseHead = 0;
+    noiseCount = 0;
+    portEXIT_CRITICAL(&noiseLock);
+}
+
+static uint32_t rangingPeriod() {
+    return (burstMode || !adaptiveSampling) ? RANGING_PERIOD : RANGING_IDLE_PERIOD;
+}
+
+// Flaga gotowości kasowana przed startem pomiaru - zostaje tylko zgłoszenie tego pomiaru
+static void startPair() {
+    rangeReady = false;
+    lox.startRange();
+    activeSensor = SENSOR_LEFT;
+    pairStartTime = millis();
+}
+
+static void restartRanging() {
+    I2cTransaction bus(I2C_DEV_VL53L0X);
+    if (dualSensors) {
+        lox.clearInterruptMask(false);
+        loxRight.clearInterruptMask(false);
+        rangeReady = false;
+        rightReady = false;
+        startPair();
     } else {
+        lox.stopRangeContinuous();
+        lox.clearInterruptMask(false);
+        rangeReady = false;
+        lox.startRangeContinuous(rangingPeriod());
+    }
+    lastRangeTime = millis();
+}
+
+static void configureSensor(Adafruit_VL53L0X& sensor, const RangingProfileInfo& profile) {
+    sensor.setMeasurementTimingBudgetMicroSeconds(profile.budgetUs);
+    sensor.setLimitCheckEnable(VL53L0X_CHECKENABLE_SIGMA_FINAL_RANGE, 1);
+    sensor.setLimitCheckValue(VL53L0X_CHECKENABLE_SIGMA_FINAL_RANGE, (FixPoint1616_t)(sigmaLimit * 65536));
+    sensor.setLimitCheckEnable(VL53L0X_CHECKENABLE_SIGNAL_RATE_FINAL_RANGE, 1);
+    sensor.setLimitCheckValue(VL53L0X_CHECKENABLE_SIGNAL_RATE_FINAL_RANGE, (FixPoint1616_t)(signalRateLimit * 65536));
+}
+
+// Timing budget i limity sigma/siły sygnału; zmiana wymaga zatrzymania pomiaru ciągłego
+static void applyRangingConfig() {
+    const RangingProfileInfo& profile = RANGING_PROFILES[rangingProfile];
+
+    {
+        I2cTransaction bus(I2C_DEV_VL53L0X);
+        if (!dualSensors) {
+            lox.stopRangeContinuous();
+        }
+        configureSensor(lox, profile);
+        if (dualSensors) {
+            configureSensor(loxRight, profile);
+        }
+    }
+    restartRanging();
+    resetRangingStats();
+
+    Serial.printf("VL53L0X: profil %s (%lu us), sygnał %.2f MCPS, sigma %.1f mm\n", profile.name,
+                  (unsigned long)profile.budgetUs, signalRateLimit, sigmaLimit);
+}
+
+void requestRangingConfig() {
+    rangingConfigPending = true;
+}
+
+float rangingSampleRate() {
+    return sampleRate;
+}
+
+bool rangingBurst() {
+    return burstMode || !adaptiveSampling;
+}
+
+// Przełączenie tempa po przetworzeniu próbki, więc nie opóźnia rozpoznania gestu.
+// W trakcie obecności ręki tempo się nie zmienia.
+static void updateSamplingMode(bool active) {
+    if (active) {
+        lastActivityTime = millis();
+    }
+    if (!adaptiveSampling) {
+        return;
+    }
+
+    bool burst = active || millis() - lastActivityTime < RANGING_IDLE_TIMEOUT;
+    if (burst != burstMode) {
+        burstMode = burst;
+        // Dwa czujniki: tempo wynika z planowania par, restart niepotrzebny
+        if (!dualSensors) {
+            restartRanging();
+        }
+        resetRangingStats();
+    }
+}
+
+bool rangingNoise(float& mean, float& stddev, uint8_t& samples) {
+    uint16_t values[RANGING_NOISE_WINDOW];
+    portENTER_CRITICAL(&noiseLock);
+    samples = noiseCount;
+    memcpy(values, noiseWindow, sizeof(values));
+    portEXIT_CRITICAL(&noiseLock);
+
+    if (samples < 2) {
+        return false;
+    }
+
+    float sum = 0;
+    for (uint8_t i = 0; i < samples; i++) {
+        sum += values[i];
+    }
+    mean = sum / samples;
+
+    float variance = 0;
+    for (uint8_t i = 0; i < samples; i++) {
+        variance += (values[i] - mean) * (values[i] - mean);
+    }
+    stddev = sqrtf(variance / (samples - 1));
+    return true;
+}
+
+static void recordSample(const VL53L0X_RangingMeasurementData_t& measure) {
+    rateSamples++;
+    unsigned long elapsed = millis() - rateWindowStart;
+    if (elapsed >= 1000) {
+        sampleRate = rateSamples * 1000.0f / elapsed;
+        rateSamples = 0;
+        rateWindowStart = millis();
+    }
+
+    if (measure.RangeStatus == 0) {
+        portENTER_CRITICAL(&noiseLock);
+        noiseWindow[noiseHead] = measure.RangeMilliMeter;
+        noiseHead = (noiseHead + 1) % RANGING_NOISE_WINDOW;
+        if (noiseCount < RANGING_NOISE_WINDOW) {
+            noiseCount++;
+        }
+        portEXIT_CRITICAL(&noiseLock);
+    }
+}
+
+// Oba czujniki startują pod 0x29. Przy obu XSHUT w stanie niskim budzimy prawy
+// i przenosimy go pod VL53L0X_RIGHT_ADDRESS, potem lewy zostaje pod domyślnym.
+// Jeśli mimo XSHUT w stanie niskim coś odpowiada pod 0x29, XSHUT nie jest
+// podłączony - zostaje jeden czujnik jak dotąd.
+static bool setupRightSensor() {
+    pinMode(VL53L0X_XSHUT_LEFT_PIN, OUTPUT);
+    pinMode(VL53L0X_XSHUT_RIGHT_PIN, OUTPUT);
+    digitalWrite(VL53L0X_XSHUT_LEFT_PIN, LOW);
+    digitalWrite(VL53L0X_XSHUT_RIGHT_PIN, LOW);
+    delay(10);
+
+    Wire.beginTransmission(VL53L0X_I2C_ADDR);
+    bool xshutWired = Wire.endTransmission() != 0;
+    bool found = false;
+    if (xshutWired) {
+        digitalWrite(VL53L0X_XSHUT_RIGHT_PIN, HIGH);
+        delay(10);
+        found = loxRight.begin(VL53L0X_RIGHT_ADDRESS);
+        if (!found) {
+            digitalWrite(VL53L0X_XSHUT_RIGHT_PIN, LOW);
+        }
+    }
+
+    digitalWrite(VL53L0X_XSHUT_LEFT_PIN, HIGH);
+    delay(10);
+    return found;
+}
+
+// Inicjalizacja czujników przy starcie i po awarii (reset, odłączenie). XSHUT resetuje
+// oba, więc utrata prawego też wymaga pełnej sekwencji. Bez lewego gesty są wyłączone.
+static bool startSensors() {
+    bool left;
+    bool right;
+    {
+        I2cTransaction bus(I2C_DEV_VL53L0X);
+        right = setupRightSensor();
+        left = lox.begin();
+    }
+    i2cDeviceSetOnline(I2C_DEV_VL53L0X, left);
+    if (right || rightExpected) {
+        i2cDeviceSetOnline(I2C_DEV_VL53L0X_RIGHT, right);
+    }
+    rightExpected = rightExpected || right;
+    dualSensors = left && right;
+    gestureEngine.setDual(dualSensors);
+    rangeFilter.reset();
+    rightFilter.reset();
+    rightDistance = -1;
+    if (!left) {
         currentDistance = -1;
+        gestureDetected = false;
+        holdDetected = false;
+        Serial.println("Błąd inicjalizacji VL53L0X! Gesty wyłączone do czasu wykrycia czujnika.");
+        return false;
+    }
+
+    // Pomiar ciągły (dwa czujniki: pojedyncze na zmianę); GPIO1 sygnalizuje gotową
+    // próbkę, więc loop() nigdy nie czeka na czujnik
+    VL53L0X_DeviceModes mode = dualSensors ? VL53L0X_DEVICEMODE_SINGLE_RANGING : VL53L0X_DEVICEMODE_CONTINUOUS_RANGING;
+    {
+        I2cTransaction bus(I2C_DEV_VL53L0X);
+        pinMode(VL53L0X_INT_PIN, INPUT);
+        lox.setGpioConfig(mode, VL53L0X_GPIOFUNCTIONALITY_NEW_MEASURE_READY, VL53L0X_INTERRUPTPOLARITY_LOW);
+        attachInterrupt(digitalPinToInterrupt(VL53L0X_INT_PIN), onRangeReady, FALLING);
+        if (dualSensors) {
+            pinMode(VL53L0X_RIGHT_INT_PIN, INPUT);
+            loxRight.setGpioConfig(mode, VL53L0X_GPIOFUNCTIONALITY_NEW_MEASURE_READY, VL53L0X_INTERRUPTPOLARITY_LOW);
+            attachInterrupt(digitalPinToInterrupt(VL53L0X_RIGHT_INT_PIN), onRightRangeReady, FALLING);
+        } else {
+            detachInterrupt(digitalPinToInterrupt(VL53L0X_RIGHT_INT_PIN));
+        }
+    }
+    activeSensor = SENSOR_LEFT;
+    rangeReady = false;
+    rightReady = false;
+    applyRangingConfig();
+    Serial.println(dualSensors ? "VL53L0X zainicjalizowane (dwa czujniki)!" : "VL53L0X zainicjalizowany!");
+    return true;
+}
+
+void setupGesture() {
+    rangingProfile = preferences.getUChar("rngProfile", DEFAULT_RANGING_PROFILE);
+    if (rangingProfile >= RANGING_PROFILE_COUNT) {
+        rangingProfile = DEFAULT_RANGING_PROFILE;
+    }
+    signalRateLimit = preferences.getFloat("rngSignal", RANGING_PROFILES[rangingProfile].signalRate);
+    sigmaLimit = preferences.getFloat("rngSigma", RANGING_PROFILES[rangingProfile].sigma);
+    adaptiveSampling = preferences.getBool("rngAdaptive", true);
+    loadGestureConfig();
+    loadRangeFilterConfig();
+
+    // Pierwsza kalibracja od razu po starcie, potem okresowo
+    autoCalibration = preferences.getBool("gCalAuto", true);
+    calibrated = preferences.isKey("gCalBase");
+    calibrationBaseline = preferences.getInt("gCalBase", -1);
+    // Przy dalekim tle starsze wersje zapisywały tu 200 mm - takie tło okna nie zawęża
+    calibrationLimit = calibrationBaseline < 0 ? UINT16_MAX : preferences.getUShort("gCalMax", UINT16_MAX);
+    nextCalibration = calibrated ? millis() + CALIBRATION_RECHECK_INTERVAL : millis();
+
+    rightFilter.setConfig(rangeFilterConfig);
+    i2cBusSetPendingCheck(gestureSamplePending);
+    startSensors();
+}
+
+// Który czujnik ma nową próbkę. Gdyby zbocze przerwania zginęło (linia została w stanie
+// niskim), po RANGING_STALL_TIMEOUT sprawdzamy status czujnika bezpośrednio.
+static uint8_t takeReadySample() {
+    if (dualSensors && activeSensor == SENSOR_NONE) {
+        // Wolne tempo: następna para po RANGING_IDLE_PERIOD od początku poprzedniej
+        if (rangingBurst() || millis() - pairStartTime >= RANGING_IDLE_PERIOD) {
+            I2cTransaction bus(I2C_DEV_VL53L0X);
+            startPair();
+            lastRangeTime = millis();
+        }
+        return SENSOR_NONE;
+    }
+
+    bool right = dualSensors && activeSensor == SENSOR_RIGHT;
+    volatile bool& ready = right ? rightReady : rangeReady;
+    if (ready) {
+        ready = false;
+        return right ? SENSOR_RIGHT : SENSOR_LEFT;
     }
+    if (millis() - lastRangeTime <= RANGING_STALL_TIMEOUT) {
+        return SENSOR_NONE;
+    }
+    Adafruit_VL53L0X& sensor = right ? loxRight : lox;
+    I2cTransaction bus(right ? I2C_DEV_VL53L0X_RIGHT : I2C_DEV_VL53L0X);
+    if (sensor.isRangeComplete()) {
+        (right ? rightReadyTime : rangeReadyTime) = micros();
+        return right ? SENSOR_RIGHT : SENSOR_LEFT;
+    }
+    // Czujnik po resecie nie mierzy - kolejne błędy wyłączają go do ponownej inicjalizacji
+    if (millis() - lastRangeTime > RANGING_FAULT_TIMEOUT) {
+        bus.fail();
+    }
+    return SENSOR_NONE;
+}
+
+void requestGestureConfig() {
+    gestureConfigPending = true;
+}
+
+void saveGestureConfig() {
+    preferences.putUShort("gWinMin", gestureConfig.minDistance);
+    preferences.putUShort("gWinMax", gestureConfig.maxDistance);
+    preferences.putUShort("gWinUser", userMaxDistance);
+    preferences.putUShort("gTapMax", gestureConfig.tapMaxMs);
+    preferences.putUShort("gDblTap", gestureConfig.doubleTapWindowMs);
+    preferences.putUShort("gSwipeMax", gestureConfig.swipeMaxMs);
+    preferences.putUShort("gSwipeMin", gestureConfig.swipeMinTravel);
+    preferences.putUShort("gSliderHold", gestureConfig.sliderHoldMs);
+    preferences.putUShort("gSliderStill", gestureConfig.sliderStillMm);
+    preferences.putUShort("gSliderHyst", gestureConfig.sliderHysteresisMm);
+    preferences.putBool("gClassifier", gestureConfig.classifierEnabled);
+    preferences.putUChar("gClsConf", gestureConfig.minConfidence);
+    preferences.putUShort("gLatGap", gestureConfig.lateralGapMs);
+    preferences.putUShort("gLatMin", gestureConfig.lateralMinGapMs);
+    preferences.putUShort("gLatWait", gestureConfig.lateralWaitMs);
+}
+
+static void loadGestureConfig() {
+    GestureConfig defaults;
+    gestureConfig.minDistance = preferences.getUShort("gWinMin", defaults.minDistance);
+    gestureConfig.maxDistance = preferences.getUShort("gWinMax", defaults.maxDistance);
+    // Bez zapisanej wartości użytkownika (starsza wersja) obecne okno jest jego granicą
+    userMaxDistance = preferences.getUShort("gWinUser", gestureConfig.maxDistance);
+    gestureConfig.tapMaxMs = preferences.getUShort("gTapMax", defaults.tapMaxMs);
+    gestureConfig.doubleTapWindowMs = preferences.getUShort("gDblTap", defaults.doubleTapWindowMs);
+    gestureConfig.swipeMaxMs = preferences.getUShort("gSwipeMax", defaults.swipeMaxMs);
+    gestureConfig.swipeMinTravel = preferences.getUShort("gSwipeMin", defaults.swipeMinTravel);
+    gestureConfig.sliderHoldMs = preferences.getUShort("gSliderHold", defaults.sliderHoldMs);
+    gestureConfig.sliderStillMm = preferences.getUShort("gSliderStill", defaults.sliderStillMm);
+    gestureConfig.sliderHysteresisMm = preferences.getUShort("gSliderHyst", defaults.sliderHysteresisMm);
+    gestureConfig.classifierEnabled = preferences.getBool("gClassifier", defaults.classifierEnabled);
+    gestureConfig.minConfidence = preferences.getUChar("gClsConf", defaults.minConfidence);
+    gestureConfig.lateralGapMs = preferences.getUShort("gLatGap", defaults.lateralGapMs);
+    gestureConfig.lateralMinGapMs = preferences.getUShort("gLatMin", defaults.lateralMinGapMs);
+    gestureConfig.lateralWaitMs = preferences.getUShort("gLatWait", defaults.lateralWaitMs);
+    gestureEngine.setConfig(gestureConfig);
+    gestureEngine.setClock([]() -> uint32_t { return micros(); });
+    rawGestureEngine.setConfig(gestureConfig);
+}
+
+void requestRangeFilterConfig() {
+    rangeFilterPending = true;
+}
+
+void saveRangeFilterConfig() {
+    preferences.putBool("fltMedian", rangeFilterConfig.medianEnabled);
+    preferences.putBool("fltKalman", rangeFilterConfig.kalmanEnabled);
+    preferences.putFloat("fltMinSig", rangeFilterConfig.minSignalRate);
+    preferences.putFloat("fltMaxAmb", rangeFilterConfig.maxAmbientRate);
+    preferences.putFloat("fltQ", rangeFilterConfig.kalmanQ);
+    preferences.putFloat("fltR", rangeFilterConfig.kalmanR);
+}
+
+static void loadRangeFilterConfig() {
+    RangeFilterConfig defaults;
+    rangeFilterConfig.medianEnabled = preferences.getBool("fltMedian", defaults.medianEnabled);
+    rangeFilterConfig.kalmanEnabled = preferences.getBool("fltKalman", defaults.kalmanEnabled);
+    rangeFilterConfig.minSignalRate = preferences.getFloat("fltMinSig", defaults.minSignalRate);
+    rangeFilterConfig.maxAmbientRate = preferences.getFloat("fltMaxAmb", defaults.maxAmbientRate);
+    rangeFilterConfig.kalmanQ = preferences.getFloat("fltQ", defaults.kalmanQ);
+    rangeFilterConfig.kalmanR = preferences.getFloat("fltR", defaults.kalmanR);
+    rangeFilter.setConfig(rangeFilterConfig);
+}
+
+const RangeFilterStats& rangeFilterStats() {
+    return rangeFilter.stats();
+}
+
+const ClassifierStats& gestureClassifierStats() {
+    return gestureEngine.classifierStats();
+}
+
+void rangeFilterGestureCounts(uint32_t& raw, uint32_t& filtered) {
+    raw = rawGestureCount;
+    filtered = filteredGestureCount;
+}
+
+void requestCalibration() {
+    calibrationRequested = true;
+}
+
+bool calibrationActive() {
+    return calibrator.active();
+}
+
+uint32_t calibrationElapsed() {
+    return calibrator.elapsed(millis());
+}
+
+const CalibrationResult& lastCalibrationResult() {
+    return calibrator.result();
+}
+
+// Kalibracja tylko zawęża okno względem wartości użytkownika, nigdy go nie poszerza
+uint16_t calibratedMaxDistance(uint16_t userMax) {
+    return min(userMax, calibrationLimit);
+}
+
+static void startCalibration(bool manual) {
+    calibrationManual = manual;
+    calibrator.start(millis());
+    nextCalibration = millis() + CALIBRATION_RECHECK_INTERVAL;
+    Serial.printf("Kalibracja okna gestów (%s)\n", manual ? "na żądanie" : "okresowa");
+}
+
+// Wynik kalibracji na żądanie stosujemy zawsze, gdy jest poprawny. Okresowa zmienia okno
+// tylko przy stabilnym tle, które przesunęło się o więcej niż CALIBRATION_DRIFT_MM.
+static void finishCalibration() {
+    const CalibrationResult& result = calibrator.result();
+    Serial.printf("Kalibracja: tło %d mm (mediana %d mm, %u próbek), okno do %u mm\n",
+                  result.baseline, result.median, result.samples, min(result.maxDistance, userMaxDistance));
+
+    if (!result.valid) {
+        Serial.println("Kalibracja: tło za blisko lub za mało próbek - okno bez zmian");
+        return;
+    }
+    if (!calibrationManual) {
+        if (!result.stable) {
+            Serial.println("Kalibracja: tło niestabilne - okno bez zmian");
+            return;
+        }
+        bool bothFar = result.baseline < 0 && calibrationBaseline < 0;
+        bool near = result.baseline >= 0 && calibrationBaseline >= 0 &&
+                    abs(result.baseline - calibrationBaseline) <= CALIBRATION_DRIFT_MM;
+        if (calibrated && (bothFar || near)) {
+            return;
+        }
+    }
+
+    calibrationBaseline = result.baseline;
+    calibrated = true;
+    preferences.putInt("gCalBase", calibrationBaseline);
+    calibrationLimit = result.maxDistance;
+    preferences.putUShort("gCalMax", calibrationLimit);
+
+    uint16_t maxDistance = calibratedMaxDistance(userMaxDistance);
+    if (maxDistance != gestureConfig.maxDistance) {
+        gestureConfig.maxDistance = maxDistance;
+        gestureEngine.setConfig(gestureConfig);
+        rawGestureEngine.setConfig(gestureConfig);
+        saveGestureConfig();
+    }
+}
+
+// Gest -> nowy bieg: tap ON/OFF, double-tap pełna moc, swipe +/-1 (w prawo/zbliżenie +1),
+// tryb proporcjonalny 1-4
+static void handleGesture(const GestureResult& gesture, unsigned long readStart, unsigned long readDone) {
+    int newSpeed;
+    LatencyGesture latencyType;
+    switch (gesture.type) {
+        case GESTURE_TAP:
+            newSpeed = currentSpeed == 0 ? defaultSpeed : 0;
+            latencyType = LATENCY_TAP;
+            break;
+        case GESTURE_DOUBLE_TAP:
+            newSpeed = 4;
+            latencyType = LATENCY_DOUBLE_TAP;
+            break;
+        case GESTURE_APPROACH:
+        case GESTURE_SWIPE_RIGHT:
+            newSpeed = min(currentSpeed + 1, 4);
+            latencyType = LATENCY_SWIPE;
+            break;
+        case GESTURE_RETREAT:
+        case GESTURE_SWIPE_LEFT:
+            newSpeed = max(currentSpeed - 1, 0);
+            latencyType = LATENCY_SWIPE;
+            break;
+        case GESTURE_SLIDER:
+            newSpeed = gesture.level;
+            latencyType = LATENCY_SLIDER;
+            break;
+        default:
+            return;
+    }
+
+    metricIncrement(METRIC_GESTURES);
+    Serial.printf("Wykryto gest %s (%d mm) - bieg %d\n", gestureTypeName(gesture.type), gesture.distance, newSpeed);
+    if (newSpeed == currentSpeed) {
+        return;
+    }
+
+    latencyBegin(latencyType, readStart, readDone);
+    int oldSpeed = currentSpeed;
+    String details = "Hand gesture - " + String(gestureTypeName(gesture.type)) +
+                     " (distance: " + String(gesture.distance) + "mm)";
+    logGestureEvent(oldSpeed, newSpeed, details);
+    setFanSpeed(newSpeed);
+    sendWebhookRequest(currentSpeed, "GESTURE", oldSpeed);
+    notifyClients();
+    latencyEnd();
+}
+
+static bool gesturesSuppressed() {
+    return calibrator.active() && calibrationManual;
+}
+
+#define VL53L0X_REG_RESULT_SIGNAL_RATE 0x1A     // 2 x uint16 FixPoint 9.7: sygnał, tło
+
+// Wynik pomiaru, który zgłosił przerwanie, bez startu następnego. getRangingMeasurement()
+// wykonuje nowy pomiar pojedynczy i czeka na niego cały budżet czasowy; readRangeResult()
+// czyta gotowe dane (VL53L0X_GetRangingMeasurementData) i kasuje przerwanie. Szybkości
+// sygnału i tła dla filtra biblioteka tam gubi - czytane wcześniej wprost z rejestrów wyniku.
+static bool readFinishedShot(Adafruit_VL53L0X& sensor, uint8_t address, VL53L0X_RangingMeasurementData_t& measure) {
+    Wire.beginTransmission(address);
+    Wire.write(VL53L0X_REG_RESULT_SIGNAL_RATE);
+    if (Wire.endTransmission(false) != 0 || Wire.requestFrom(address, (uint8_t)4) != 4) {
+        return false;
+    }
+    uint16_t signal = Wire.read() << 8;
+    signal |= Wire.read();
+    uint16_t ambient = Wire.read() << 8;
+    ambient |= Wire.read();
+    measure.SignalRateRtnMegaCps = (FixPoint1616_t)signal << 9;
+    measure.AmbientRateRtnMegaCps = (FixPoint1616_t)ambient << 9;
+
+    uint16_t range = sensor.readRangeResult();
+    measure.RangeStatus = sensor.readRangeStatus();
+    measure.RangeMilliMeter = range;
+    // 0xFFFF bez statusu 4 (poza zasięgiem) to błąd odczytu albo kasowania przerwania
+    return range != 0xFFFF || measure.RangeStatus == 4;
+}
+
+// Prawy czujnik: tylko filtr i kierunek ruchu poprzecznego
+static void processRightSample() {
+    VL53L0X_RangingMeasurementData_t measure = {};
+    unsigned long readStart = rightReadyTime;
+    unsigned long i2cStart = micros();
+    bool valid;
+    {
+        I2cTransaction bus(I2C_DEV_VL53L0X_RIGHT);
+        valid = readFinishedShot(loxRight, VL53L0X_RIGHT_ADDRESS, measure);
+        if (!valid) {
+            loxRight.clearInterruptMask(false);
+            bus.fail();
+        }
+        if (rangingBurst()) {
+            startPair();
+        } else {
+            activeSensor = SENSOR_NONE;
+        }
+    }
+    unsigned long readDone = micros();
+    metricObserve(METRIC_I2C_READ_TIME, readDone - i2cStart);
+    // Nieudany odczyt nie może trafić do filtra ani silnika gestów - następny pomiar już trwa
+    if (!valid) {
+        return;
+    }
+
+    int rawDistance = measure.RangeStatus != 4 ? measure.RangeMilliMeter : -1;
+    rightDistance = rightFilter.update(rawDistance,
+                                       measure.SignalRateRtnMegaCps / 65536.0f,
+                                       measure.AmbientRateRtnMegaCps / 65536.0f);
+
+    GestureResult gesture = gestureEngine.updateSecondary(millis(), rightDistance);
+    if (gesture.type != GESTURE_NONE) {
+        filteredGestureCount++;
+        if (!gesturesSuppressed()) {
+            handleGesture(gesture, readStart, readDone);
+        }
+    }
+}
 
-    delay(50);
+void processGesture() {
+    // Utrata czujnika: lewego - ponowna inicjalizacja z rosnącym odstępem; prawego -
+    // od razu dalej z samym lewym, a prawy próbowany później, gdy nikogo nie ma przy okapie
+    if (!i2cDeviceOnline(I2C_DEV_VL53L0X) || (dualSensors && !i2cDeviceOnline(I2C_DEV_VL53L0X_RIGHT))) {
+        if (i2cDeviceOnline(I2C_DEV_VL53L0X) || i2cDeviceRetryDue(I2C_DEV_VL53L0X)) {
+            startSensors();
+        }
+        return;
+    }
+    if (rightExpected && !dualSensors && !gestureEngine.busy() && i2cDeviceRetryDue(I2C_DEV_VL53L0X_RIGHT)) {
+        startSensors();
+    }
+
+    if (rangingConfigPending) {
+        rangingConfigPending = false;
+        applyRangingConfig();
+    }
+    if (gestureConfigPending) {
+        gestureConfigPending = false;
+        gestureEngine.setConfig(gestureConfig);
+        rawGestureEngine.setConfig(gestureConfig);
+    }
+    if (rangeFilterPending) {
+        rangeFilterPending = false;
+        rangeFilter.setConfig(rangeFilterConfig);
+        rightFilter.setConfig(rangeFilterConfig);
+    }
+    if (calibrationRequested) {
+        calibrationRequested = false;
+        startCalibration(true);
+    } else if (autoCalibration && !calibrator.active() && (long)(millis() - nextCalibration) >= 0) {
+        startCalibration(false);
+    }
+
+    uint8_t sensor = takeReadySample();
+    if (sensor == SENSOR_NONE) {
+        return;
+    }
+    TRACE_SCOPE("processGesture");
+    lastRangeTime = millis();
+    if (sensor == SENSOR_RIGHT) {
+        processRightSample();
+        return;
+    }
+
+    VL53L0X_RangingMeasurementData_t measure = {};
+    unsigned long readStart = rangeReadyTime;
+    unsigned long i2cStart = micros();
+    bool valid;
+    {
+        I2cTransaction bus(I2C_DEV_VL53L0X);
+        valid = readFinishedShot(lox, VL53L0X_I2C_ADDR, measure);
+        if (!valid) {
+            lox.clearInterruptMask(false);
+            bus.fail();
+        }
+        if (dualSensors) {
+            rightReady = false;
+            loxRight.startRange();
+            activeSensor = SENSOR_RIGHT;
+        }
+    }
+    unsigned long readDone = micros();
+    metricObserve(METRIC_I2C_READ_TIME, readDone - i2cStart);
+    if (!valid) {
+        return;
+    }
+    recordSample(measure);
+
+    int rawDistance = measure.RangeStatus != 4 ? measure.RangeMilliMeter : -1;
+    currentDistance = rangeFilter.update(rawDistance,
+                                         measure.SignalRateRtnMegaCps / 65536.0f,
+                                         measure.AmbientRateRtnMegaCps / 65536.0f);
+
+    unsigned long now = millis();
+    if (rawGestureEngine.update(now, rawDistance).type != GESTURE_NONE) {
+        rawGestureCount++;
+    }
+
+    GestureResult gesture = gestureEngine.update(now, currentDistance);
+    gestureDetected = gestureEngine.present();
+    holdDetected = gestureEngine.sliderActive();
+    if (gesture.type != GESTURE_NONE) {
+        filteredGestureCount++;
+        if (!gesturesSuppressed()) {
+            handleGesture(gesture, readStart, readDone);
+        }
+    }
+    if (calibrator.active() &&
+        calibrator.update(now, currentDistance, gestureConfig.minDistance, GESTURE_MIN_WINDOW)) {
+        finishCalibration();
+    }
+    captureRecord(now, measure.RangeMilliMeter, measure.RangeStatus, gesture.type,
+                  measure.SignalRateRtnMegaCps, measure.AmbientRateRtnMegaCps);
+
+    int nearest = currentDistance;
+    if (dualSensors && rightDistance >= 0 && (nearest < 0 || rightDistance < nearest)) {
+        nearest = rightDistance;
+    }
+    updateSamplingMode(gestureEngine.busy() ||
+                       (nearest >= 0 && nearest <= gestureConfig.maxDistance + RANGING_APPROACH_MARGIN));
 }
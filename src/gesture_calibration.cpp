@@ -0,0 +1,79 @@
+#include "gesture_calibration.h"
+#include <string.h>
+
+GestureCalibrator::GestureCalibrator(const CalibrationConfig& config) : _config(config) {
+}
+
+void GestureCalibrator::start(uint32_t now) {
+    memset(_bins, 0, sizeof(_bins));
+    _far = 0;
+    _total = 0;
+    _startTime = now;
+    _active = true;
+}
+
+bool GestureCalibrator::update(uint32_t now, int distance, uint16_t minDistance, uint16_t minWindow) {
+    if (!_active) {
+        return false;
+    }
+
+    if (_total < UINT16_MAX) {
+        if (distance < 0 || distance >= BIN_MM * BIN_COUNT) {
+            _far++;
+        } else {
+            _bins[distance / BIN_MM]++;
+        }
+        _total++;
+    }
+
+    if (now - _startTime < _config.durationMs) {
+        return false;
+    }
+    finish(minDistance, minWindow);
+    return true;
+}
+
+// Środek przedziału, w którym wypada percentyl; -1 gdy wypada w "brak celu"
+int GestureCalibrator::percentile(uint8_t percent) const {
+    uint32_t rank = ((uint32_t)_total * percent + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < BIN_COUNT; i++) {
+        seen += _bins[i];
+        if (seen >= rank) {
+            return i * BIN_MM + BIN_MM / 2;
+        }
+    }
+    return -1;
+}
+
+void GestureCalibrator::finish(uint16_t minDistance, uint16_t minWindow) {
+    _active = false;
+
+    CalibrationResult result;
+    result.samples = _total;
+    result.baseline = percentile(5);
+    result.median = percentile(50);
+
+    if (result.baseline < 0) {
+        // Nic w zasięgu - tło nie ogranicza okna (zostaje granica użytkownika)
+        result.stable = true;
+        result.maxDistance = _config.windowLimit;
+    } else {
+        int margin = result.baseline * _config.marginPercent / 100;
+        if (margin < _config.marginMm) {
+            margin = _config.marginMm;
+        }
+        int maxDistance = result.baseline - margin;
+        if (maxDistance > _config.windowLimit) {
+            maxDistance = _config.windowLimit;
+        }
+        result.maxDistance = maxDistance > 0 ? maxDistance : 0;
+        result.stable = result.median >= 0 && result.median - result.baseline <= _config.maxSpread;
+    }
+
+    result.valid = _total >= _config.minSamples && result.maxDistance >= minDistance + minWindow;
+    _result = result;
+}
@@ -0,0 +1,72 @@
+#include "gesture_classifier.h"
+
+static int16_t saturate(int32_t value) {
+    return value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value);
+}
+
+void SegmentFeatureExtractor::begin(uint32_t now, int distance) {
+    _start = now;
+    _first = distance;
+    _last = distance;
+    _min = distance;
+    _max = distance;
+    _minIndex = 0;
+    _path = 0;
+    _reversals = 0;
+    _direction = 0;
+    _samples = 1;
+}
+
+void SegmentFeatureExtractor::add(int distance) {
+    int delta = distance - _last;
+    int magnitude = delta < 0 ? -delta : delta;
+    if (magnitude >= SEGMENT_REVERSAL_MM) {
+        int8_t direction = delta > 0 ? 1 : -1;
+        if (_direction && direction != _direction) {
+            _reversals++;
+        }
+        _direction = direction;
+    }
+    _path += magnitude;
+    _last = distance;
+
+    if (distance < _min) {
+        _min = distance;
+        _minIndex = _samples;
+    }
+    if (distance > _max) {
+        _max = distance;
+    }
+    if (_samples < UINT16_MAX) {
+        _samples++;
+    }
+}
+
+void SegmentFeatureExtractor::compute(uint32_t now, SegmentFeatures& features) const {
+    uint32_t duration = now - _start;
+    features.values[FEATURE_DURATION] = duration > INT16_MAX ? INT16_MAX : duration;
+    features.values[FEATURE_TRAVEL] = _last - _first;
+    features.values[FEATURE_SPAN] = _max - _min;
+    features.values[FEATURE_PATH] = saturate(_path);
+    features.values[FEATURE_REVERSALS] = _reversals;
+    features.values[FEATURE_MIN_POSITION] = _samples > 1 ? (uint32_t)_minIndex * 100 / (_samples - 1) : 0;
+    features.values[FEATURE_SAMPLES] = saturate(_samples);
+}
+
+// Dzieci mają zawsze wyższe indeksy - uszkodzony model daje brak gestu zamiast zapętlenia
+Classification classifySegment(const TreeNode* tree, const SegmentFeatures& features) {
+    uint8_t index = 0;
+    while (tree[index].feature != TREE_LEAF) {
+        const TreeNode& node = tree[index];
+        uint8_t next = features.values[node.feature] <= node.threshold ? node.left : node.right;
+        if (next <= index) {
+            return Classification();
+        }
+        index = next;
+    }
+
+    Classification result;
+    result.type = tree[index].left;
+    result.confidence = tree[index].right;
+    return result;
+}
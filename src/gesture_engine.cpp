@@ -0,0 +1,276 @@
+#include "gesture_engine.h"
+#include "gesture_model.h"
+
+static const char* GESTURE_NAMES[GESTURE_TYPE_COUNT] = {
+    "none", "tap", "doubleTap", "approach", "retreat", "slider", "swipeLeft", "swipeRight"
+};
+
+const char* gestureTypeName(GestureType type) {
+    return type < GESTURE_TYPE_COUNT ? GESTURE_NAMES[type] : "unknown";
+}
+
+// Pierwszy pasujący wiersz (stan, zdarzenie, warunek) wykonuje akcję i zmienia stan.
+// Kolejność wierszy ma znaczenie - bardziej szczegółowe warunki wcześniej.
+const GestureEngine::Transition GestureEngine::TRANSITIONS[] = {
+    { STATE_IDLE,        EVENT_ENTER, nullptr,                         &GestureEngine::startPresence,          STATE_PRESENT },
+
+    { STATE_PRESENT,     EVENT_STAY,  &GestureEngine::secondTapOverdue, &GestureEngine::emitPendingTap,        STATE_PRESENT },
+    { STATE_PRESENT,     EVENT_STAY,  &GestureEngine::sliderReady,      &GestureEngine::enterSlider,           STATE_SLIDER },
+    { STATE_PRESENT,     EVENT_STAY,  nullptr,                          nullptr,                               STATE_PRESENT },
+    { STATE_PRESENT,     EVENT_LEAVE, &GestureEngine::isSwipeAfterTap,  &GestureEngine::emitPendingTapThenSwipe, STATE_IDLE },
+    { STATE_PRESENT,     EVENT_LEAVE, &GestureEngine::isSwipe,          &GestureEngine::emitSwipe,             STATE_IDLE },
+    { STATE_PRESENT,     EVENT_LEAVE, &GestureEngine::isSecondTap,      &GestureEngine::emitDoubleTap,         STATE_IDLE },
+    { STATE_PRESENT,     EVENT_LEAVE, &GestureEngine::tapWindowOpen,    &GestureEngine::rememberTap,           STATE_TAP_PENDING },
+    { STATE_PRESENT,     EVENT_LEAVE, &GestureEngine::isTap,            &GestureEngine::emitTap,               STATE_IDLE },
+    { STATE_PRESENT,     EVENT_LEAVE, &GestureEngine::hasPendingTap,    &GestureEngine::emitPendingTap,        STATE_IDLE },
+    { STATE_PRESENT,     EVENT_LEAVE, nullptr,                          nullptr,                               STATE_IDLE },
+
+    { STATE_SLIDER,      EVENT_STAY,  nullptr,                          &GestureEngine::updateSlider,          STATE_SLIDER },
+    { STATE_SLIDER,      EVENT_LEAVE, nullptr,                          nullptr,                               STATE_IDLE },
+
+    { STATE_TAP_PENDING, EVENT_ENTER, &GestureEngine::tapWindowExpired, &GestureEngine::emitPendingTapAndStart, STATE_PRESENT },
+    { STATE_TAP_PENDING, EVENT_ENTER, nullptr,                          &GestureEngine::startSecondPresence,   STATE_PRESENT },
+    { STATE_TAP_PENDING, EVENT_AWAY,  &GestureEngine::tapWindowExpired, &GestureEngine::emitPendingTap,        STATE_IDLE },
+};
+
+GestureEngine::GestureEngine(const GestureConfig& config) : _config(config) {
+}
+
+void GestureEngine::setConfig(const GestureConfig& config) {
+    _config = config;
+    reset();
+}
+
+void GestureEngine::reset() {
+    _state = STATE_IDLE;
+    _inWindow = false;
+    _secondTap = false;
+    _level = 0;
+    _deferred = GESTURE_NONE;
+}
+
+GestureResult GestureEngine::update(uint32_t now, int distance) {
+    _now = now;
+    _distance = distance;
+
+    bool inWindow = distance >= _config.minDistance && distance <= _config.maxDistance;
+    Event event;
+    if (inWindow) {
+        event = _inWindow ? EVENT_STAY : EVENT_ENTER;
+    } else {
+        event = _inWindow ? EVENT_LEAVE : EVENT_AWAY;
+    }
+    _inWindow = inWindow;
+
+    // Statystyki obecności aktualizowane przed przejściem, żeby warunki widziały bieżącą próbkę
+    if (event == EVENT_STAY) {
+        trackPresence();
+    } else if (event == EVENT_LEAVE && _config.classifierEnabled) {
+        classifyPresence();
+    }
+
+    GestureResult result;
+    for (const Transition& transition : TRANSITIONS) {
+        if (transition.state != _state || transition.event != event) {
+            continue;
+        }
+        if (transition.guard && !(this->*transition.guard)()) {
+            continue;
+        }
+        if (transition.action) {
+            (this->*transition.action)(result);
+        }
+        _state = transition.next;
+        break;
+    }
+
+    if (result.type == GESTURE_NONE && _deferred != GESTURE_NONE) {
+        result.type = _deferred;
+        _deferred = GESTURE_NONE;
+    }
+
+    if (result.type != GESTURE_NONE && distance >= 0) {
+        result.distance = distance;
+    }
+    return result;
+}
+
+// --- Warunki ---
+
+bool GestureEngine::isSwipe() const {
+    if (_config.classifierEnabled) {
+        return _classification.type == GESTURE_APPROACH || _classification.type == GESTURE_RETREAT;
+    }
+    uint16_t travel = _lastDistance > _firstDistance ? _lastDistance - _firstDistance : _firstDistance - _lastDistance;
+    return _now - _enterTime <= _config.swipeMaxMs && travel >= _config.swipeMinTravel;
+}
+
+bool GestureEngine::isTap() const {
+    if (_config.classifierEnabled) {
+        return _classification.type == GESTURE_TAP;
+    }
+    return _now - _enterTime <= _config.tapMaxMs;
+}
+
+bool GestureEngine::isSecondTap() const {
+    return _secondTap && isTap();
+}
+
+// Druga obecność po tapie, która nie okazała się drugim tapem - pierwszy tap był pojedynczy
+bool GestureEngine::hasPendingTap() const {
+    return _secondTap;
+}
+
+bool GestureEngine::isSwipeAfterTap() const {
+    return _secondTap && isSwipe();
+}
+
+bool GestureEngine::tapWindowOpen() const {
+    return _config.doubleTapWindowMs > 0 && isTap();
+}
+
+bool GestureEngine::tapWindowExpired() const {
+    return _now - _tapTime > _config.doubleTapWindowMs;
+}
+
+// Druga obecność trwa za długo na tap - pierwszy tap był pojedynczy
+bool GestureEngine::secondTapOverdue() const {
+    return _secondTap && _now - _enterTime > _config.tapMaxMs;
+}
+
+bool GestureEngine::sliderReady() const {
+    return _now - _stillSince >= _config.sliderHoldMs;
+}
+
+// --- Akcje ---
+
+void GestureEngine::startPresence(GestureResult&) {
+    _enterTime = _now;
+    _firstDistance = _distance;
+    _lastDistance = _distance;
+    _stillSince = _now;
+    _stillMin = _distance;
+    _stillMax = _distance;
+    _secondTap = false;
+    _segment.begin(_now, _distance);
+}
+
+void GestureEngine::startSecondPresence(GestureResult& result) {
+    startPresence(result);
+    _secondTap = true;
+}
+
+// Dłoń uznajemy za nieruchomą, dopóki wszystkie odczyty od _stillSince mieszczą się
+// w przedziale sliderStillMm; większy ruch zaczyna odliczanie od nowa
+void GestureEngine::trackPresence() {
+    _segment.add(_distance);
+    _lastDistance = _distance;
+    uint16_t low = _distance < _stillMin ? _distance : _stillMin;
+    uint16_t high = _distance > _stillMax ? _distance : _stillMax;
+    if (high - low > _config.sliderStillMm) {
+        _stillSince = _now;
+        _stillMin = _distance;
+        _stillMax = _distance;
+    } else {
+        _stillMin = low;
+        _stillMax = high;
+    }
+}
+
+// Wynik modelu dla zakończonej obecności; niepewny = brak gestu
+void GestureEngine::classifyPresence() {
+    uint32_t start = _clock ? _clock() : 0;
+    SegmentFeatures features;
+    _segment.compute(_now, features);
+    Classification classification = classifySegment(GESTURE_MODEL, features);
+    uint32_t elapsed = _clock ? _clock() - start : 0;
+
+    _classifierStats.inferences++;
+    _classifierStats.lastUs = elapsed;
+    _classifierStats.totalUs += elapsed;
+    if (elapsed > _classifierStats.maxUs) {
+        _classifierStats.maxUs = elapsed;
+    }
+    _classifierStats.last = classification;
+
+    if (classification.confidence < _config.minConfidence || classification.type >= GESTURE_TYPE_COUNT) {
+        _classifierStats.rejected++;
+        classification.type = GESTURE_NONE;
+    }
+    _classification = classification;
+}
+
+void GestureEngine::emitSwipe(GestureResult& result) {
+    if (_config.classifierEnabled) {
+        result.type = (GestureType)_classification.type;
+        return;
+    }
+    result.type = _lastDistance < _firstDistance ? GESTURE_APPROACH : GESTURE_RETREAT;
+}
+
+void GestureEngine::emitTap(GestureResult& result) {
+    result.type = GESTURE_TAP;
+}
+
+void GestureEngine::emitDoubleTap(GestureResult& result) {
+    result.type = GESTURE_DOUBLE_TAP;
+    _secondTap = false;
+}
+
+void GestureEngine::rememberTap(GestureResult&) {
+    _tapTime = _now;
+}
+
+void GestureEngine::emitPendingTap(GestureResult& result) {
+    result.type = GESTURE_TAP;
+    _secondTap = false;
+}
+
+void GestureEngine::emitPendingTapAndStart(GestureResult& result) {
+    result.type = GESTURE_TAP;
+    startPresence(result);
+}
+
+// Jedna próbka kończy dwa gesty: najpierw czekający tap, swipe w następnym wywołaniu
+void GestureEngine::emitPendingTapThenSwipe(GestureResult& result) {
+    GestureResult swipe;
+    emitSwipe(swipe);
+    _deferred = swipe.type;
+    emitPendingTap(result);
+}
+
+void GestureEngine::enterSlider(GestureResult& result) {
+    _level = levelFor(_distance);
+    result.type = GESTURE_SLIDER;
+    result.level = _level;
+}
+
+// Bliżej czujnika (wyżej) = wyższy bieg
+uint8_t GestureEngine::levelFor(int distance) const {
+    int span = _config.maxDistance - _config.minDistance + 1;
+    int offset = _config.maxDistance - distance;
+    if (offset < 0) {
+        offset = 0;
+    }
+    int level = 1 + offset * 4 / span;
+    return level > 4 ? 4 : level;
+}
+
+void GestureEngine::updateSlider(GestureResult& result) {
+    uint8_t candidate = levelFor(_distance);
+    if (candidate == _level) {
+        return;
+    }
+
+    // Zmiana dopiero po przekroczeniu granicy o histerezę, żeby bieg nie migał na krawędzi
+    bool up = candidate > _level;
+    uint8_t confirmed = levelFor(up ? _distance + _config.sliderHysteresisMm
+                                    : _distance - _config.sliderHysteresisMm);
+    if (up ? confirmed <= _level : confirmed >= _level) {
+        return;
+    }
+
+    _level = confirmed;
+    result.type = GESTURE_SLIDER;
+    result.level = _level;
+}
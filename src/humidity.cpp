@@ -0,0 +1,76 @@
+#include "humidity.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Stałe Magnusa nad wodą (Sonntag 1990), błąd < 0,5 % w zakresie -45..60 °C
+static const float MAGNUS_A = 17.62f;
+static const float MAGNUS_B = 243.12f;      // °C
+static const float MAGNUS_E0 = 6.112f;      // hPa przy 0 °C
+
+// Stała gazowa pary wodnej przeliczona na g/m³ z hPa: 100 / 461,5 * 1000
+static const float VAPOR_DENSITY_FACTOR = 216.7f;
+
+static const float LOG2_E = 1.44269504f;
+static const float LN_2 = 0.69314718f;
+
+// 2^x: część całkowita wprost do wykładnika floata, ułamek wielomianem 5. stopnia.
+// Błąd względny < 1e-5 - daleko poniżej dokładności czujnika, bez wołania biblioteki.
+static float fastExp2(float x) {
+    if (x < -126.0f) {
+        return 0.0f;
+    }
+    if (x > 127.0f) {
+        return INFINITY;
+    }
+    float whole = floorf(x);
+    float f = x - whole;
+    float p = 1.0f + f * (0.69314720f + f * (0.24022652f + f * (0.05550357f +
+                     f * (0.00961813f + f * (0.00133336f + f * 0.00015403f)))));
+    int32_t bits;
+    memcpy(&bits, &p, sizeof(bits));
+    bits += (int32_t)whole << 23;
+    memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+// ln(x) dla x > 0: wykładnik floata wprost, mantysa sprowadzona do [0,75; 1,5) i szereg
+// atanh - ln(m) = 2 * (s + s^3/3 + s^5/5 + s^7/7), s = (m - 1) / (m + 1), |s| < 0,2
+static float fastLog(float x) {
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int32_t exponent = ((bits >> 23) & 0xFF) - 127;
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > 1.5f) {
+        m *= 0.5f;
+        exponent++;
+    }
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    float series = s * (2.0f + s2 * (0.66666667f + s2 * (0.4f + s2 * 0.28571429f)));
+    return exponent * LN_2 + series;
+}
+
+// Ciśnienie pary nasyconej (hPa)
+static float saturationPressure(float temperature) {
+    return MAGNUS_E0 * fastExp2(LOG2_E * MAGNUS_A * temperature / (MAGNUS_B + temperature));
+}
+
+float absoluteHumidity(float temperature, float humidity, float pressure) {
+    float vapor = saturationPressure(temperature) * humidity / 100.0f;
+    if (pressure > 0) {
+        vapor *= 1.0016f + 3.15e-6f * pressure - 0.074f / pressure;
+    }
+    return VAPOR_DENSITY_FACTOR * vapor / (temperature + 273.15f);
+}
+
+// Odwrócony wzór Magnusa: gamma = ln(RH/100) + a*T/(b+T), Td = b*gamma / (a - gamma)
+float dewPointTemperature(float temperature, float humidity) {
+    if (!(humidity > 0.1f)) {
+        humidity = 0.1f;
+    }
+    float gamma = fastLog(humidity / 100.0f) + MAGNUS_A * temperature / (MAGNUS_B + temperature);
+    return MAGNUS_B * gamma / (MAGNUS_A - gamma);
+}
@@ -0,0 +1,226 @@
+#include <Wire.h>
+#include <atomic>
+#include <freertos/semphr.h>
+#include "i2c_bus.h"
+#include "config.h"
+
+static const char* const DEVICE_NAMES[I2C_DEV_COUNT] = { "vl53l0x", "vl53l0xRight", "bme280", "bme280Room" };
+
+static SemaphoreHandle_t busMutex = nullptr;
+static std::atomic<uint8_t> highWaiting(0);
+static bool (*pendingCheck)() = nullptr;
+
+// Statystyki zapisywane przez właściciela magistrali, czytane z zadania HTTP
+static I2cDeviceStats deviceStats[I2C_DEV_COUNT];
+static uint64_t windowBusyUs = 0;
+static unsigned long windowStart = 0;
+static float utilization = 0;
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+
+struct DeviceHealth {
+    volatile bool online = false;
+    bool lost = false;              // Wyłączone przez błędy - udana inicjalizacja to odzyskanie
+    uint8_t consecutiveErrors = 0;
+    unsigned long retryDelay = I2C_RETRY_MIN;
+    unsigned long nextRetry = 0;
+    uint32_t recoveries = 0;
+};
+
+static DeviceHealth deviceHealth[I2C_DEV_COUNT];
+static uint32_t busClears = 0;
+
+#define I2C_CLEAR_HALF_PERIOD 5     // us - ok. 100 kHz
+
+// Ręczne taktowanie SCL jako GPIO open-drain; Wire musi być wtedy wyłączony
+static bool clockOutBus() {
+    pinMode(SDA_PIN, INPUT_PULLUP);
+    pinMode(SCL_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(SCL_PIN, HIGH);
+    delayMicroseconds(I2C_CLEAR_HALF_PERIOD);
+
+    for (uint8_t i = 0; i < I2C_CLEAR_PULSES && digitalRead(SDA_PIN) == LOW; i++) {
+        digitalWrite(SCL_PIN, LOW);
+        delayMicroseconds(I2C_CLEAR_HALF_PERIOD);
+        digitalWrite(SCL_PIN, HIGH);
+        delayMicroseconds(I2C_CLEAR_HALF_PERIOD);
+    }
+
+    // STOP: SDA z niskiego na wysoki przy wysokim SCL
+    digitalWrite(SCL_PIN, LOW);
+    pinMode(SDA_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(SDA_PIN, LOW);
+    delayMicroseconds(I2C_CLEAR_HALF_PERIOD);
+    digitalWrite(SCL_PIN, HIGH);
+    delayMicroseconds(I2C_CLEAR_HALF_PERIOD);
+    digitalWrite(SDA_PIN, HIGH);
+    delayMicroseconds(I2C_CLEAR_HALF_PERIOD);
+
+    pinMode(SDA_PIN, INPUT_PULLUP);
+    return digitalRead(SDA_PIN) == HIGH;
+}
+
+void i2cBusBegin() {
+    if (!busMutex) {
+        busMutex = xSemaphoreCreateMutex();
+    }
+    if (!clockOutBus()) {
+        Serial.println("I2C: SDA trzymane w stanie niskim po starcie");
+    }
+    Wire.begin(SDA_PIN, SCL_PIN);
+    Wire.setClock(I2C_BUS_CLOCK);
+    windowStart = millis();
+}
+
+bool i2cBusClear() {
+    Wire.end();
+    bool released = clockOutBus();
+    Wire.begin(SDA_PIN, SCL_PIN);
+    Wire.setClock(I2C_BUS_CLOCK);
+    busClears++;
+    Serial.printf("I2C: czyszczenie magistrali %s\n", released ? "udane" : "nieudane - SDA nadal w stanie niskim");
+    return released;
+}
+
+bool i2cDeviceOnline(uint8_t device) {
+    return device < I2C_DEV_COUNT && deviceHealth[device].online;
+}
+
+bool i2cDeviceRetryDue(uint8_t device) {
+    const DeviceHealth& health = deviceHealth[device];
+    return !health.online && (long)(millis() - health.nextRetry) >= 0;
+}
+
+void i2cDeviceSetOnline(uint8_t device, bool online) {
+    DeviceHealth& health = deviceHealth[device];
+    health.consecutiveErrors = 0;
+    if (online) {
+        if (health.lost) {
+            health.recoveries++;
+            Serial.printf("I2C: %s ponownie dostępny\n", DEVICE_NAMES[device]);
+        }
+        health.lost = false;
+        health.retryDelay = I2C_RETRY_MIN;
+    } else {
+        health.nextRetry = millis() + health.retryDelay;
+        health.retryDelay = min(health.retryDelay * 2, (unsigned long)I2C_RETRY_MAX);
+    }
+    health.online = online;
+}
+
+// Wołane z destruktora transakcji, gdy magistrala jest jeszcze zajęta
+static void recordResult(I2cDevice device, bool failed) {
+    DeviceHealth& health = deviceHealth[device];
+    if (!failed) {
+        health.consecutiveErrors = 0;
+        return;
+    }
+    if (++health.consecutiveErrors < I2C_DEVICE_MAX_ERRORS || !health.online) {
+        return;
+    }
+
+    // Pierwsza próba od razu po wyczyszczeniu magistrali, potem coraz rzadziej
+    Serial.printf("I2C: %s niedostępny po %d błędach\n", DEVICE_NAMES[device], health.consecutiveErrors);
+    health.online = false;
+    health.lost = true;
+    health.consecutiveErrors = 0;
+    health.retryDelay = I2C_RETRY_MIN;
+    health.nextRetry = millis();
+    i2cBusClear();
+}
+
+void i2cBusSetPendingCheck(bool (*pending)()) {
+    pendingCheck = pending;
+}
+
+const char* i2cDeviceName(uint8_t device) {
+    return device < I2C_DEV_COUNT ? DEVICE_NAMES[device] : "unknown";
+}
+
+I2cDeviceStats i2cDeviceStats(uint8_t device) {
+    portENTER_CRITICAL(&statsLock);
+    I2cDeviceStats stats = deviceStats[device];
+    portEXIT_CRITICAL(&statsLock);
+    return stats;
+}
+
+float i2cBusUtilization() {
+    portENTER_CRITICAL(&statsLock);
+    float value = utilization;
+    portEXIT_CRITICAL(&statsLock);
+    return value;
+}
+
+I2cTransaction::I2cTransaction(I2cDevice device, I2cPriority priority, TickType_t wait)
+    : _device(device), _acquired(false) {
+    if (priority == I2C_PRIORITY_LOW &&
+        (highWaiting.load() > 0 || (pendingCheck && pendingCheck()))) {
+        portENTER_CRITICAL(&statsLock);
+        deviceStats[device].deferred++;
+        portEXIT_CRITICAL(&statsLock);
+        return;
+    }
+
+    if (priority == I2C_PRIORITY_HIGH) {
+        highWaiting++;
+    }
+    _acquired = xSemaphoreTake(busMutex, wait) == pdTRUE;
+    if (priority == I2C_PRIORITY_HIGH) {
+        highWaiting--;
+    }
+    if (!_acquired) {
+        portENTER_CRITICAL(&statsLock);
+        deviceStats[device].deferred++;
+        portEXIT_CRITICAL(&statsLock);
+        return;
+    }
+    _start = micros();
+}
+
+I2cTransaction::~I2cTransaction() {
+    if (!_acquired) {
+        return;
+    }
+    uint32_t elapsed = micros() - _start;
+    unsigned long now = millis();
+
+    portENTER_CRITICAL(&statsLock);
+    I2cDeviceStats& stats = deviceStats[_device];
+    stats.transactions++;
+    if (_failed) {
+        stats.errors++;
+    }
+    stats.busyUs += elapsed;
+    stats.lastUs = elapsed;
+    if (elapsed > stats.maxUs) {
+        stats.maxUs = elapsed;
+    }
+    windowBusyUs += elapsed;
+    if (now - windowStart >= I2C_BUS_STATS_WINDOW) {
+        utilization = windowBusyUs / ((now - windowStart) * 10.0f);
+        windowBusyUs = 0;
+        windowStart = now;
+    }
+    portEXIT_CRITICAL(&statsLock);
+
+    recordResult(_device, _failed);
+    xSemaphoreGive(busMutex);
+}
+
+void fillI2cBusStatus(JsonObject root) {
+    root["clockHz"] = I2C_BUS_CLOCK;
+    root["utilization"] = i2cBusUtilization();
+    root["busClears"] = busClears;
+    JsonObject devices = root.createNestedObject("devices");
+    for (uint8_t i = 0; i < I2C_DEV_COUNT; i++) {
+        I2cDeviceStats stats = i2cDeviceStats(i);
+        JsonObject device = devices.createNestedObject(DEVICE_NAMES[i]);
+        device["online"] = i2cDeviceOnline(i);
+        device["recoveries"] = deviceHealth[i].recoveries;
+        device["transactions"] = stats.transactions;
+        device["errors"] = stats.errors;
+        device["deferred"] = stats.deferred;
+        device["avgUs"] = stats.transactions ? (uint32_t)(stats.busyUs / stats.transactions) : 0;
+        device["maxUs"] = stats.maxUs;
+        device["lastUs"] = stats.lastUs;
+    }
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "latency.h"
+
+static const char* GESTURE_NAMES[LATENCY_GESTURE_COUNT] = { "tap", "doubleTap", "swipe", "slider" };
+static const char* STAGE_NAMES[LATENCY_STAGE_COUNT] = { "sampled", "classified", "relay", "wsQueued" };
+
+// Okno ostatnich pomiarów: przesunięcie każdego etapu względem początku odczytu (us)
+struct LatencyWindow {
+    uint32_t samples[LATENCY_STAGE_COUNT][LATENCY_WINDOW];
+    uint8_t head;
+    uint8_t count;
+    uint32_t total;
+};
+
+static LatencyWindow windows[LATENCY_GESTURE_COUNT];
+static portMUX_TYPE latencyLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Pomiar w toku - tylko w zadaniu, które go rozpoczęło (loop)
+static TaskHandle_t activeTask = nullptr;
+static LatencyGesture activeGesture;
+static uint32_t activeStart;
+static uint32_t activeStages[LATENCY_STAGE_COUNT];
+
+void latencyBegin(LatencyGesture gesture, uint32_t sampleStart, uint32_t sampleDone) {
+    activeTask = xTaskGetCurrentTaskHandle();
+    activeGesture = gesture;
+    activeStart = sampleStart;
+    for (uint8_t i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        activeStages[i] = 0;
+    }
+    activeStages[STAGE_SAMPLED] = sampleDone - sampleStart;
+    activeStages[STAGE_CLASSIFIED] = micros() - sampleStart;
+}
+
+void latencyMark(LatencyStage stage) {
+    if (!activeTask || activeTask != xTaskGetCurrentTaskHandle()) {
+        return;
+    }
+    if (activeStages[stage] == 0) {
+        activeStages[stage] = micros() - activeStart;
+    }
+}
+
+void latencyEnd() {
+    if (!activeTask) {
+        return;
+    }
+    activeTask = nullptr;
+
+    portENTER_CRITICAL(&latencyLock);
+    LatencyWindow& window = windows[activeGesture];
+    for (uint8_t i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        window.samples[i][window.head] = activeStages[i];
+    }
+    window.head = (window.head + 1) % LATENCY_WINDOW;
+    if (window.count < LATENCY_WINDOW) {
+        window.count++;
+    }
+    window.total++;
+    portEXIT_CRITICAL(&latencyLock);
+}
+
+static uint32_t percentile(uint32_t* sorted, uint8_t count, uint8_t p) {
+    if (count == 0) {
+        return 0;
+    }
+    uint16_t rank = ((uint16_t)p * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void fillLatencyReport(JsonObject root) {
+    root["unit"] = "us";
+    JsonObject gestures = root.createNestedObject("gestures");
+
+    // Bufor poza stosem async_tcp
+    static uint32_t values[LATENCY_WINDOW];
+
+    for (uint8_t g = 0; g < LATENCY_GESTURE_COUNT; g++) {
+        JsonObject gesture = gestures.createNestedObject(GESTURE_NAMES[g]);
+
+        for (uint8_t s = 0; s < LATENCY_STAGE_COUNT; s++) {
+            uint8_t count;
+            uint32_t total;
+            portENTER_CRITICAL(&latencyLock);
+            count = windows[g].count;
+            total = windows[g].total;
+            memcpy(values, windows[g].samples[s], count * sizeof(uint32_t));
+            portEXIT_CRITICAL(&latencyLock);
+
+            if (s == STAGE_SAMPLED) {
+                gesture["total"] = total;
+                gesture["window"] = count;
+            }
+
+            // Etap pominięty (np. bieg się nie zmienił) ma wartość 0 - nie wlicza się
+            uint8_t valid = 0;
+            for (uint8_t i = 0; i < count; i++) {
+                if (values[i] != 0 || s == STAGE_SAMPLED) {
+                    values[valid++] = values[i];
+                }
+            }
+            std::sort(values, values + valid);
+
+            JsonObject stage = gesture.createNestedObject(STAGE_NAMES[s]);
+            stage["p50"] = percentile(values, valid, 50);
+            stage["p95"] = percentile(values, valid, 95);
+            stage["p99"] = percentile(values, valid, 99);
+        }
+    }
+}
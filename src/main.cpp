@@ -5,6 +5,12 @@
 #include "webserver.h"  // Make sure this is included
 #include "relays.h"
 #include "gesture.h"
+#include "telemetry.h"
+#include "webhook.h"
+#include "mqtt.h"
+#include "metrics.h"
+#include "diagnostics.h"
+#include "i2c_bus.h"
 #include <ArduinoOTA.h>
 #include <Adafruit_Sensor.h>
 #include <Adafruit_BME280.h>
@@ -14,13 +20,18 @@
 // Definicje zmiennych globalnych
 int currentSpeed = 0;     // Domyślnie wentylator wyłączony
 int defaultSpeed = 1;     // Domyślny bieg wentylatora
-String webhookUrl = "";   // URL webhooka, domyślnie pusty
 
 
 
 unsigned long lastRelayLogTime = 0; // Zmienna do śledzenia czasu dla logowania
 float temperature = 0.0;
 float humidity = 0.0;
+float pressure = 0.0;
+float absHumidity = 0.0;
+float dewPoint = 0.0;
+float roomTemperature = 0.0;
+float roomHumidity = 0.0;
+float roomPressure = 0.0;
 bool gestureControlEnabled = true;
 
 unsigned long lastSensorUpdateTime = 0;
@@ -104,6 +115,7 @@ void setupTime() {
 void setup() {
     Serial.begin(115200);
     delay(1000);
+    setupDiagnostics();
 
     preferences.begin("okap", false);
 
@@ -183,37 +195,41 @@ void setup() {
     setupRelays();
 
     // Inicjalizacja magistrali I2C i VL53L0X
-    Wire.begin(SDA_PIN, SCL_PIN);
-    Wire.setClock(100000); // Zegar I2C 100 kHz
+    i2cBusBegin();
 
     setupGesture();
 
     // Inicjalizacja serwera Web GUI i API
     setupWebServer();
-
-    if (!bme.begin(0x76)) {
-        Serial.println("Błąd inicjalizacji BME280!");
-        while (1);
-    }
+    setupMqtt();
 
     // Take initial readings to prevent false triggers on boot
-    temperature = bme.readTemperature();
-    humidity = bme.readHumidity();
-    lastTemperature = temperature;
-    lastHumidity = humidity;
-    lastMonitoringTime = millis();
+    if (!startEnvSensor()) {
+        // Reszta systemu działa dalej; updateSensorData() ponawia inicjalizację w tle
+        Serial.println("Błąd inicjalizacji BME280! Automatyka wyłączona do czasu wykrycia czujnika.");
+    }
+    if (startRoomSensor()) {
+        Serial.println("BME280 w pomieszczeniu - wykrywanie różnicowe");
+    }
 }
 
 void loop() {
-    // Monitorowanie połączenia Ethernet
-    if (!ETH.linkUp()) {
-        Serial.println("Ethernet rozłączony!");
+    unsigned long loopStart = micros();
+
+    // Monitorowanie połączenia Ethernet - komunikat tylko przy zmianie stanu łącza
+    static bool ethLinkUp = true;
+    bool linkUp = ETH.linkUp();
+    if (linkUp != ethLinkUp) {
+        Serial.println(linkUp ? "Ethernet połączony" : "Ethernet rozłączony!");
+        ethLinkUp = linkUp;
     }
     
     ArduinoOTA.handle();
+    mqttLoop();
+    diagnosticsLoop();
     
-    if (millis() - lastSensorUpdateTime >= 1000) {
-        updateSensorData();
+    // Odczyt odłożony na rzecz próbki gestu jest ponawiany w następnym obiegu
+    if (millis() - lastSensorUpdateTime >= 1000 && updateSensorData()) {
         lastSensorUpdateTime = millis();
     }
 
@@ -234,9 +250,14 @@ void loop() {
         lastTimeSyncMillis = millis();
     }
 
-    if (webhookUrl.length() > 0) {  // Only call if webhook URL is set
+    if (webhookTargetCount > 0) {  // Only call if a webhook target is set
         sendPeriodicWebhook();
     }
 
     // Remove MDNS.update() as it's not needed on ESP32
+
+    metricObserve(METRIC_LOOP_TIME, micros() - loopStart);
+
+    // Oddaj procesor - próbki z czujnika przychodzą przerwaniem, nie trzeba na nie czekać
+    delay(1);
 }
@@ -0,0 +1,192 @@
+#include "metrics.h"
+
+std::atomic<uint32_t> metricCounters[METRIC_COUNTER_COUNT];
+
+static const uint32_t WEBHOOK_LATENCY_BOUNDS[METRIC_BUCKETS] = {
+    5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000
+};
+static const uint32_t LOOP_TIME_BOUNDS[METRIC_BUCKETS] = {
+    100, 500, 1000, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+};
+static const uint32_t I2C_READ_BOUNDS[METRIC_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000
+};
+
+Histogram metricHistograms[METRIC_HISTOGRAM_COUNT] = {
+    { WEBHOOK_LATENCY_BOUNDS, {}, 0, portMUX_INITIALIZER_UNLOCKED },
+    { LOOP_TIME_BOUNDS, {}, 0, portMUX_INITIALIZER_UNLOCKED },
+    { I2C_READ_BOUNDS, {}, 0, portMUX_INITIALIZER_UNLOCKED },
+};
+
+struct MetricInfo {
+    const char* name;
+    const char* help;
+};
+
+static const MetricInfo COUNTER_INFO[METRIC_COUNTER_COUNT] = {
+    { "okap_gestures_total", "Recognized hand gestures" },
+    { "okap_api_commands_total", "Speed commands received via HTTP API or MQTT" },
+    { "okap_auto_triggers_total", "Automatic fan activations from temperature/humidity rise" },
+    { "okap_relay_switches_total", "Relay state changes" },
+    { "okap_webhook_success_total", "Webhook deliveries acknowledged by the server" },
+    { "okap_webhook_failure_total", "Failed webhook delivery attempts" },
+};
+
+static const MetricInfo HISTOGRAM_INFO[METRIC_HISTOGRAM_COUNT] = {
+    { "okap_webhook_latency_seconds", "Webhook request latency" },
+    { "okap_loop_duration_seconds", "Main loop iteration time" },
+    { "okap_i2c_read_duration_seconds", "Sensor read time on the I2C bus" },
+};
+
+enum MetricGauge : uint8_t {
+    GAUGE_FREE_HEAP = 0,
+    GAUGE_MIN_FREE_HEAP,
+    GAUGE_WS_CLIENTS,
+    GAUGE_COUNT
+};
+
+static const MetricInfo GAUGE_INFO[GAUGE_COUNT] = {
+    { "okap_heap_free_bytes", "Free heap" },
+    { "okap_heap_min_free_bytes", "Minimum free heap since boot" },
+    { "okap_ws_clients", "Connected WebSocket clients" },
+};
+
+enum MetricsSection : uint8_t {
+    SECTION_COUNTERS = 0,
+    SECTION_HISTOGRAMS,
+    SECTION_GAUGES,
+    SECTION_DONE
+};
+
+// HELP, TYPE, kubełki, +Inf, _sum, _count
+static const uint8_t HISTOGRAM_ROWS = METRIC_BUCKETS + 5;
+
+MetricsStream::MetricsStream(uint32_t wsClients) {
+    // Migawka na początku odpowiedzi, żeby kubełki i _count były spójne
+    for (uint8_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        _counters[i] = metricCounters[i].load(std::memory_order_relaxed);
+    }
+    for (uint8_t h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        Histogram& histogram = metricHistograms[h];
+        for (uint8_t b = 0; b <= METRIC_BUCKETS; b++) {
+            _buckets[h][b] = histogram.buckets[b].load(std::memory_order_relaxed);
+        }
+        portENTER_CRITICAL(&histogram.sumLock);
+        _sums[h] = histogram.sum;
+        portEXIT_CRITICAL(&histogram.sumLock);
+    }
+    _freeHeap = ESP.getFreeHeap();
+    _minFreeHeap = ESP.getMinFreeHeap();
+    _wsClients = wsClients;
+}
+
+bool MetricsStream::nextLine() {
+    int length = -1;
+
+    while (length < 0) {
+        switch (_section) {
+            case SECTION_COUNTERS: {
+                if (_item >= METRIC_COUNTER_COUNT) {
+                    _section++;
+                    _item = 0;
+                    break;
+                }
+                const MetricInfo& info = COUNTER_INFO[_item];
+                if (_row == 0) {
+                    length = snprintf(_line, sizeof(_line), "# HELP %s %s\n", info.name, info.help);
+                } else if (_row == 1) {
+                    length = snprintf(_line, sizeof(_line), "# TYPE %s counter\n", info.name);
+                } else {
+                    length = snprintf(_line, sizeof(_line), "%s %u\n", info.name, _counters[_item]);
+                }
+                if (++_row == 3) {
+                    _row = 0;
+                    _item++;
+                }
+                break;
+            }
+
+            case SECTION_HISTOGRAMS: {
+                if (_item >= METRIC_HISTOGRAM_COUNT) {
+                    _section++;
+                    _item = 0;
+                    break;
+                }
+                const MetricInfo& info = HISTOGRAM_INFO[_item];
+                const uint32_t* buckets = _buckets[_item];
+                uint32_t total = 0;
+                for (uint8_t b = 0; b <= METRIC_BUCKETS; b++) {
+                    total += buckets[b];
+                }
+
+                if (_row == 0) {
+                    length = snprintf(_line, sizeof(_line), "# HELP %s %s\n", info.name, info.help);
+                } else if (_row == 1) {
+                    length = snprintf(_line, sizeof(_line), "# TYPE %s histogram\n", info.name);
+                } else if (_row < 2 + METRIC_BUCKETS) {
+                    uint8_t bucket = _row - 2;
+                    uint32_t cumulative = 0;
+                    for (uint8_t b = 0; b <= bucket; b++) {
+                        cumulative += buckets[b];
+                    }
+                    length = snprintf(_line, sizeof(_line), "%s_bucket{le=\"%g\"} %u\n", info.name,
+                                      metricHistograms[_item].bounds[bucket] / 1e6, cumulative);
+                } else if (_row == 2 + METRIC_BUCKETS) {
+                    length = snprintf(_line, sizeof(_line), "%s_bucket{le=\"+Inf\"} %u\n", info.name, total);
+                } else if (_row == 3 + METRIC_BUCKETS) {
+                    length = snprintf(_line, sizeof(_line), "%s_sum %.6f\n", info.name, _sums[_item] / 1e6);
+                } else {
+                    length = snprintf(_line, sizeof(_line), "%s_count %u\n", info.name, total);
+                }
+                if (++_row == HISTOGRAM_ROWS) {
+                    _row = 0;
+                    _item++;
+                }
+                break;
+            }
+
+            case SECTION_GAUGES: {
+                if (_item >= GAUGE_COUNT) {
+                    _section++;
+                    _item = 0;
+                    break;
+                }
+                const MetricInfo& info = GAUGE_INFO[_item];
+                uint32_t values[GAUGE_COUNT] = { _freeHeap, _minFreeHeap, _wsClients };
+                if (_row == 0) {
+                    length = snprintf(_line, sizeof(_line), "# HELP %s %s\n", info.name, info.help);
+                } else if (_row == 1) {
+                    length = snprintf(_line, sizeof(_line), "# TYPE %s gauge\n", info.name);
+                } else {
+                    length = snprintf(_line, sizeof(_line), "%s %u\n", info.name, values[_item]);
+                }
+                if (++_row == 3) {
+                    _row = 0;
+                    _item++;
+                }
+                break;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    _lineLength = (size_t)length < sizeof(_line) ? length : sizeof(_line) - 1;
+    _linePos = 0;
+    return true;
+}
+
+size_t MetricsStream::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (_linePos >= _lineLength && !nextLine()) {
+            break;
+        }
+        size_t count = min(maxLen - written, _lineLength - _linePos);
+        memcpy(buffer + written, _line + _linePos, count);
+        written += count;
+        _linePos += count;
+    }
+    return written;
+}
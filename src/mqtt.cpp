@@ -0,0 +1,360 @@
+#include <AsyncMqttClient.h>
+#include <ArduinoJson.h>
+#include <ETH.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "mqtt.h"
+#include "config.h"
+#include "webserver.h"
+#include "i2c_bus.h"
+
+bool mqttEnabled = false;
+String mqttHost = "";
+uint16_t mqttPort = DEFAULT_MQTT_PORT;
+String mqttUser = "";
+String mqttPassword = "";
+String mqttBaseTopic = DEFAULT_MQTT_BASE_TOPIC;
+
+static AsyncMqttClient mqttClient;
+static SemaphoreHandle_t mqttLock = xSemaphoreCreateRecursiveMutex();
+static String clientId;
+static String availabilityTopic;
+static unsigned long reconnectDelay = MQTT_RECONNECT_MIN;
+static unsigned long nextReconnect = 0;
+
+// Ostatnio opublikowany stan - publikujemy tylko zmiany
+static int publishedSpeed = -1;
+static char publishedTemperature[12] = "";
+static char publishedHumidity[12] = "";
+static char publishedPressure[12] = "";
+static char publishedAbsHumidity[12] = "";
+static char publishedDewPoint[12] = "";
+static char publishedRoomTemperature[12] = "";
+static char publishedRoomHumidity[12] = "";
+
+// Bufor wiadomości QoS1 na czas braku połączenia. Wiadomości na ten sam temat
+// są scalane (liczy się najnowszy stan), więc bufor nie zapełnia się powtórzeniami.
+struct PendingMessage {
+    char topic[80];
+    char payload[MQTT_PAYLOAD_MAX];
+    bool retain;
+    bool used;
+};
+
+static PendingMessage pendingMessages[MQTT_OFFLINE_QUEUE];
+static uint32_t pendingDropped = 0;
+
+static void buildTopic(char* topic, size_t size, const char* suffix) {
+    snprintf(topic, size, "%s/%s", mqttBaseTopic.c_str(), suffix);
+}
+
+static void bufferMessage(const char* topic, const char* payload, bool retain) {
+    PendingMessage* slot = nullptr;
+    for (PendingMessage& message : pendingMessages) {
+        if (message.used && strcmp(message.topic, topic) == 0) {
+            slot = &message;
+            break;
+        }
+        if (!message.used && !slot) {
+            slot = &message;
+        }
+    }
+    if (!slot) {
+        pendingDropped++;
+        return;
+    }
+
+    strlcpy(slot->topic, topic, sizeof(slot->topic));
+    strlcpy(slot->payload, payload, sizeof(slot->payload));
+    slot->retain = retain;
+    slot->used = true;
+}
+
+static void flushPendingMessages() {
+    for (PendingMessage& message : pendingMessages) {
+        if (message.used && mqttClient.publish(message.topic, 1, message.retain, message.payload) != 0) {
+            message.used = false;
+        }
+    }
+}
+
+static void publish(const char* suffix, const char* payload, bool retain) {
+    char topic[80];
+    buildTopic(topic, sizeof(topic), suffix);
+
+    xSemaphoreTakeRecursive(mqttLock, portMAX_DELAY);
+    if (!mqttClient.connected() || mqttClient.publish(topic, 1, retain, payload) == 0) {
+        bufferMessage(topic, payload, retain);
+    }
+    xSemaphoreGiveRecursive(mqttLock);
+}
+
+// Konfiguracja Home Assistant MQTT discovery: wentylator 1-4 oraz czujniki
+static void publishDiscovery() {
+    char topic[96];
+    char stateTopic[80];
+    char commandTopic[80];
+    String payload;
+
+    StaticJsonDocument<768> doc;
+    JsonObject device;
+
+    auto addDevice = [&]() {
+        doc["availability_topic"] = availabilityTopic;
+        device = doc.createNestedObject("device");
+        device["identifiers"][0] = clientId;
+        device["name"] = "turboOKAP";
+        device["manufacturer"] = "okap";
+        device["model"] = "WT32-ETH01";
+    };
+
+    doc.clear();
+    doc["name"] = "Okap";
+    doc["unique_id"] = clientId + "_fan";
+    buildTopic(stateTopic, sizeof(stateTopic), "fan/state");
+    buildTopic(commandTopic, sizeof(commandTopic), "fan/set");
+    doc["state_topic"] = stateTopic;
+    doc["command_topic"] = commandTopic;
+    buildTopic(stateTopic, sizeof(stateTopic), "fan/speed");
+    buildTopic(commandTopic, sizeof(commandTopic), "fan/speed/set");
+    doc["percentage_state_topic"] = stateTopic;
+    doc["percentage_command_topic"] = commandTopic;
+    doc["speed_range_min"] = 1;
+    doc["speed_range_max"] = 4;
+    addDevice();
+    payload = "";
+    serializeJson(doc, payload);
+    snprintf(topic, sizeof(topic), "homeassistant/fan/%s/config", clientId.c_str());
+    mqttClient.publish(topic, 1, true, payload.c_str());
+
+    const char* sensors[][3] = {
+        { "temperature", "temperature", "°C" },
+        { "humidity", "humidity", "%" },
+        { "pressure", "pressure", "hPa" },
+        { "absolute_humidity", "", "g/m³" },    // Bez device_class - starsze HA jej nie znają
+        { "dew_point", "temperature", "°C" },
+        { "room_temperature", "temperature", "°C" },
+        { "room_humidity", "humidity", "%" },
+    };
+    for (auto& sensor : sensors) {
+        doc.clear();
+        doc["name"] = String("Okap ") + sensor[0];
+        doc["unique_id"] = clientId + "_" + sensor[0];
+        buildTopic(stateTopic, sizeof(stateTopic), sensor[0]);
+        doc["state_topic"] = stateTopic;
+        if (sensor[1][0]) {
+            doc["device_class"] = sensor[1];
+        }
+        doc["unit_of_measurement"] = sensor[2];
+        doc["state_class"] = "measurement";
+        addDevice();
+        payload = "";
+        serializeJson(doc, payload);
+        snprintf(topic, sizeof(topic), "homeassistant/sensor/%s_%s/config", clientId.c_str(), sensor[0]);
+        mqttClient.publish(topic, 1, true, payload.c_str());
+    }
+}
+
+static void subscribeCommands() {
+    char topic[80];
+    buildTopic(topic, sizeof(topic), "fan/set");
+    mqttClient.subscribe(topic, 1);
+    buildTopic(topic, sizeof(topic), "fan/speed/set");
+    mqttClient.subscribe(topic, 1);
+    buildTopic(topic, sizeof(topic), "state/set");
+    mqttClient.subscribe(topic, 1);
+}
+
+static void onMqttConnect(bool sessionPresent) {
+    Serial.println("MQTT połączony");
+    xSemaphoreTakeRecursive(mqttLock, portMAX_DELAY);
+    reconnectDelay = MQTT_RECONNECT_MIN;
+    mqttClient.publish(availabilityTopic.c_str(), 1, true, "online");
+    subscribeCommands();
+    publishDiscovery();
+    flushPendingMessages();
+
+    // Wymuś pełną publikację stanu po połączeniu
+    publishedSpeed = -1;
+    publishedTemperature[0] = '\0';
+    publishedHumidity[0] = '\0';
+    publishedPressure[0] = '\0';
+    publishedAbsHumidity[0] = '\0';
+    publishedDewPoint[0] = '\0';
+    publishedRoomTemperature[0] = '\0';
+    publishedRoomHumidity[0] = '\0';
+    xSemaphoreGiveRecursive(mqttLock);
+
+    mqttPublishState();
+}
+
+static void onMqttDisconnect(AsyncMqttClientDisconnectReason reason) {
+    Serial.printf("MQTT rozłączony (powód %d), ponowna próba za %lu ms\n", (int)reason, reconnectDelay);
+    nextReconnect = millis() + reconnectDelay;
+}
+
+// Komendy trafiają do tej samej ścieżki co POST /state
+static void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties properties,
+                          size_t len, size_t index, size_t total) {
+    if (index != 0 || len != total || len >= MQTT_PAYLOAD_MAX) {
+        return;
+    }
+
+    char value[MQTT_PAYLOAD_MAX];
+    memcpy(value, payload, len);
+    value[len] = '\0';
+
+    char expected[80];
+    int speed = -1;
+
+    buildTopic(expected, sizeof(expected), "fan/set");
+    if (strcmp(topic, expected) == 0) {
+        if (strcasecmp(value, "OFF") == 0) {
+            speed = 0;
+        } else if (strcasecmp(value, "ON") == 0) {
+            speed = currentSpeed == 0 ? defaultSpeed : currentSpeed;
+        }
+    }
+
+    buildTopic(expected, sizeof(expected), "fan/speed/set");
+    if (strcmp(topic, expected) == 0) {
+        speed = atoi(value);
+    }
+
+    buildTopic(expected, sizeof(expected), "state/set");
+    if (strcmp(topic, expected) == 0) {
+        StaticJsonDocument<200> doc;
+        if (!deserializeJson(doc, value)) {
+            speed = doc["speed"] | -1;
+        }
+    }
+
+    if (speed >= 0 && !applySpeedCommand(speed, "MQTT")) {
+        Serial.printf("MQTT: niepoprawna komenda %s = %s\n", topic, value);
+    }
+}
+
+static void applyClientSettings() {
+    uint64_t mac = ESP.getEfuseMac();
+    char id[16];
+    snprintf(id, sizeof(id), "okap_%06x", (uint32_t)(mac >> 24) & 0xFFFFFF);
+    clientId = id;
+    availabilityTopic = mqttBaseTopic + "/status";
+
+    // AsyncMqttClient przechowuje wskaźniki - Stringi muszą żyć do kolejnej zmiany ustawień
+    mqttClient.setServer(mqttHost.c_str(), mqttPort);
+    mqttClient.setCredentials(mqttUser.isEmpty() ? nullptr : mqttUser.c_str(),
+                              mqttPassword.isEmpty() ? nullptr : mqttPassword.c_str());
+    mqttClient.setClientId(clientId.c_str());
+    mqttClient.setWill(availabilityTopic.c_str(), 1, true, "offline");
+    mqttClient.setKeepAlive(15);
+}
+
+void setupMqtt() {
+    mqttEnabled = preferences.getBool("mqttEnabled", false);
+    mqttHost = preferences.getString("mqttHost", "");
+    mqttPort = preferences.getUShort("mqttPort", DEFAULT_MQTT_PORT);
+    mqttUser = preferences.getString("mqttUser", "");
+    mqttPassword = preferences.getString("mqttPass", "");
+    mqttBaseTopic = preferences.getString("mqttBase", DEFAULT_MQTT_BASE_TOPIC);
+
+    mqttClient.onConnect(onMqttConnect);
+    mqttClient.onDisconnect(onMqttDisconnect);
+    mqttClient.onMessage(onMqttMessage);
+    applyClientSettings();
+    nextReconnect = millis();
+}
+
+void restartMqtt() {
+    xSemaphoreTakeRecursive(mqttLock, portMAX_DELAY);
+    if (mqttClient.connected()) {
+        mqttClient.disconnect();
+    }
+    applyClientSettings();
+    for (PendingMessage& message : pendingMessages) {
+        message.used = false;
+    }
+    reconnectDelay = MQTT_RECONNECT_MIN;
+    nextReconnect = millis();
+    xSemaphoreGiveRecursive(mqttLock);
+}
+
+void mqttLoop() {
+    if (!mqttEnabled || mqttHost.isEmpty() || mqttClient.connected() || !ETH.linkUp()) {
+        return;
+    }
+    if ((long)(millis() - nextReconnect) < 0) {
+        return;
+    }
+
+    Serial.printf("MQTT: łączenie z %s:%u\n", mqttHost.c_str(), mqttPort);
+    mqttClient.connect();
+    nextReconnect = millis() + reconnectDelay;
+    reconnectDelay = min(reconnectDelay * 2, (unsigned long)MQTT_RECONNECT_MAX);
+}
+
+bool mqttConnected() {
+    return mqttClient.connected();
+}
+
+void mqttPublishState() {
+    if (!mqttEnabled) {
+        return;
+    }
+
+    xSemaphoreTakeRecursive(mqttLock, portMAX_DELAY);
+    if (currentSpeed != publishedSpeed) {
+        publish("fan/state", currentSpeed == 0 ? "OFF" : "ON", true);
+        char speed[4];
+        snprintf(speed, sizeof(speed), "%d", currentSpeed);
+        publish("fan/speed", speed, true);
+        publishedSpeed = currentSpeed;
+    }
+
+    // Bez BME280 zostają ostatnie opublikowane wartości
+    if (!i2cDeviceOnline(I2C_DEV_BME280)) {
+        xSemaphoreGiveRecursive(mqttLock);
+        return;
+    }
+
+    char value[12];
+    snprintf(value, sizeof(value), "%.1f", temperature);
+    if (strcmp(value, publishedTemperature) != 0) {
+        publish("temperature", value, true);
+        strlcpy(publishedTemperature, value, sizeof(publishedTemperature));
+    }
+    snprintf(value, sizeof(value), "%.1f", humidity);
+    if (strcmp(value, publishedHumidity) != 0) {
+        publish("humidity", value, true);
+        strlcpy(publishedHumidity, value, sizeof(publishedHumidity));
+    }
+    snprintf(value, sizeof(value), "%.1f", pressure);
+    if (!isnan(pressure) && strcmp(value, publishedPressure) != 0) {
+        publish("pressure", value, true);
+        strlcpy(publishedPressure, value, sizeof(publishedPressure));
+    }
+    snprintf(value, sizeof(value), "%.2f", absHumidity);
+    if (strcmp(value, publishedAbsHumidity) != 0) {
+        publish("absolute_humidity", value, true);
+        strlcpy(publishedAbsHumidity, value, sizeof(publishedAbsHumidity));
+    }
+    snprintf(value, sizeof(value), "%.1f", dewPoint);
+    if (strcmp(value, publishedDewPoint) != 0) {
+        publish("dew_point", value, true);
+        strlcpy(publishedDewPoint, value, sizeof(publishedDewPoint));
+    }
+    if (i2cDeviceOnline(I2C_DEV_BME280_ROOM)) {
+        snprintf(value, sizeof(value), "%.1f", roomTemperature);
+        if (strcmp(value, publishedRoomTemperature) != 0) {
+            publish("room_temperature", value, true);
+            strlcpy(publishedRoomTemperature, value, sizeof(publishedRoomTemperature));
+        }
+        snprintf(value, sizeof(value), "%.1f", roomHumidity);
+        if (strcmp(value, publishedRoomHumidity) != 0) {
+            publish("room_humidity", value, true);
+            strlcpy(publishedRoomHumidity, value, sizeof(publishedRoomHumidity));
+        }
+    }
+    xSemaphoreGiveRecursive(mqttLock);
+}
@@ -0,0 +1,251 @@
+#include <LittleFS.h>
+#include <esp32/rom/crc.h>
+#include <stddef.h>
+#include "outbox.h"
+
+bool outboxAvailable = false;
+
+bool setupOutboxStorage() {
+    outboxAvailable = LittleFS.begin(true);  // Formatuj przy pierwszym uruchomieniu
+    if (!outboxAvailable) {
+        Serial.println("Błąd montowania LittleFS - outbox webhooków wyłączony");
+    }
+    return outboxAvailable;
+}
+
+static uint32_t recordCrc(const OutboxRecordHeader& header, const uint8_t* payload, size_t length) {
+    uint32_t crc = crc32_le(0, (const uint8_t*)&header, offsetof(OutboxRecordHeader, crc));
+    return crc32_le(crc, payload, length);
+}
+
+void WebhookOutbox::begin(int index) {
+    _path = "/outbox" + String(index) + ".bin";
+    _headPath = "/outbox" + String(index) + ".head";
+    _head = 0;
+    _size = 0;
+    _count = 0;
+
+    if (!outboxAvailable || !LittleFS.exists(_path)) {
+        return;
+    }
+
+    File file = LittleFS.open(_path, "r");
+    if (file) {
+        _size = file.size();
+        file.close();
+    }
+    if (LittleFS.exists(_headPath)) {
+        File headFile = LittleFS.open(_headPath, "r");
+        if (headFile) {
+            headFile.read((uint8_t*)&_head, sizeof(_head));
+            headFile.close();
+        }
+    }
+    if (_head > _size) {
+        _head = _size;
+    }
+
+    // Policz rekordy, które przetrwały restart
+    OutboxRecordHeader header;
+    uint32_t offset = _head;
+    while (offset < _size && readHeader(offset, header)) {
+        _count++;
+        offset += sizeof(header) + header.length;
+    }
+}
+
+bool WebhookOutbox::readHeader(uint32_t offset, OutboxRecordHeader& header) {
+    File file = LittleFS.open(_path, "r");
+    if (!file) {
+        return false;
+    }
+    bool ok = file.seek(offset) &&
+              file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == OUTBOX_MAGIC &&
+              header.length <= OUTBOX_RECORD_MAX &&
+              offset + sizeof(header) + header.length <= _size;
+    file.close();
+    return ok;
+}
+
+void WebhookOutbox::saveHead() {
+    _unsavedPops = 0;
+    File headFile = LittleFS.open(_headPath, "w");
+    if (headFile) {
+        headFile.write((const uint8_t*)&_head, sizeof(_head));
+        headFile.close();
+    }
+}
+
+bool WebhookOutbox::append(uint32_t sequence, uint8_t contentType, const uint8_t* payload, size_t length) {
+    if (!outboxAvailable) {
+        return false;
+    }
+    if (length > OUTBOX_RECORD_MAX) {
+        rejectedOversize++;
+        Serial.printf("Outbox %s: payload %u B > %d B - odrzucony\n", _path.c_str(), (unsigned)length, OUTBOX_RECORD_MAX);
+        return false;
+    }
+
+    size_t recordSize = sizeof(OutboxRecordHeader) + length;
+    if (_size + recordSize > OUTBOX_MAX_BYTES) {
+        dropOldest(recordSize);
+        compact();
+    }
+
+    OutboxRecordHeader header = { OUTBOX_MAGIC, sequence, (uint16_t)length, contentType, 0, 0 };
+    header.crc = recordCrc(header, payload, length);
+
+    File file = LittleFS.open(_path, "a");
+    if (!file) {
+        return false;
+    }
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              file.write(payload, length) == length;
+    _size = file.size();  // Przy częściowym zapisie rekord zostanie odrzucony przez CRC
+    file.close();
+
+    if (ok) {
+        _count++;
+    }
+    return ok;
+}
+
+bool WebhookOutbox::peek(OutboxRecordHeader& header, uint8_t* payload, size_t size) {
+    if (!outboxAvailable || empty()) {
+        return false;
+    }
+
+    File file = LittleFS.open(_path, "r");
+    if (!file) {
+        _head = _size = _count = 0;
+        return false;
+    }
+
+    bool skipped = false;
+    while (_head < _size) {
+        if (file.seek(_head) &&
+            file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == OUTBOX_MAGIC &&
+            header.length <= size &&
+            _head + sizeof(header) + header.length <= _size &&
+            file.read(payload, header.length) == header.length &&
+            header.crc == recordCrc(header, payload, header.length)) {
+            file.close();
+            if (skipped) {
+                saveHead();
+            }
+            _peekedEnd = _head + sizeof(header) + header.length;
+            return true;
+        }
+
+        // Uszkodzony rekord (np. zanik zasilania podczas zapisu) - szukaj następnego nagłówka
+        if (!skipped) {
+            corrupted++;
+            if (_count > 0) {
+                _count--;
+            }
+        }
+        skipped = true;
+        _head++;
+    }
+
+    file.close();
+    pop();
+    return false;
+}
+
+void WebhookOutbox::pop() {
+    if (_peekedEnd > _head) {
+        _head = _peekedEnd;
+        if (_count > 0) {
+            _count--;
+        }
+    }
+
+    if (_head >= _size) {
+        // Wszystko potwierdzone - usuń pliki zamiast trzymać pusty log
+        clear();
+    } else if (++_unsavedPops >= OUTBOX_HEAD_SAVE_EVERY) {
+        saveHead();
+    }
+}
+
+void WebhookOutbox::flush() {
+    if (_unsavedPops > 0) {
+        saveHead();
+    }
+}
+
+void WebhookOutbox::clear() {
+    if (outboxAvailable) {
+        LittleFS.remove(_path);
+        LittleFS.remove(_headPath);
+    }
+    _head = 0;
+    _size = 0;
+    _count = 0;
+    _peekedEnd = 0;
+    _unsavedPops = 0;
+}
+
+void WebhookOutbox::dropOldest(size_t needed) {
+    OutboxRecordHeader header;
+    while (_head < _size && (_size - _head) + needed > OUTBOX_MAX_BYTES) {
+        if (readHeader(_head, header)) {
+            _head += sizeof(header) + header.length;
+        } else {
+            _head = _size;
+        }
+        droppedOverflow++;
+        if (_count > 0) {
+            _count--;
+        }
+    }
+}
+
+void WebhookOutbox::compact() {
+    _peekedEnd = 0;
+    if (_head == 0) {
+        return;
+    }
+    if (_head >= _size) {
+        LittleFS.remove(_path);
+        LittleFS.remove(_headPath);
+        _head = 0;
+        _size = 0;
+        return;
+    }
+
+    String tmpPath = _path + ".tmp";
+    File src = LittleFS.open(_path, "r");
+    if (!src) {
+        return;
+    }
+    File dst = LittleFS.open(tmpPath, "w");
+    if (!dst) {
+        src.close();
+        return;
+    }
+
+    uint8_t buffer[256];
+    bool ok = src.seek(_head);
+    size_t read;
+    while (ok && (read = src.read(buffer, sizeof(buffer))) > 0) {
+        ok = dst.write(buffer, read) == read;
+    }
+    src.close();
+    dst.close();
+    if (!ok) {
+        // Pełny system plików - zostaje stary plik z przesuniętym head
+        LittleFS.remove(tmpPath);
+        saveHead();
+        return;
+    }
+
+    LittleFS.remove(_path);
+    LittleFS.rename(tmpPath, _path);
+    _size -= _head;
+    _head = 0;
+    saveHead();
+}
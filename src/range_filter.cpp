@@ -0,0 +1,85 @@
+#include "range_filter.h"
+
+RangeFilter::RangeFilter(const RangeFilterConfig& config) : _config(config) {
+}
+
+void RangeFilter::setConfig(const RangeFilterConfig& config) {
+    _config = config;
+    reset();
+}
+
+void RangeFilter::reset() {
+    _filled = 0;
+    _estimating = false;
+}
+
+int RangeFilter::update(int distance, float signalRate, float ambientRate) {
+    _stats.samples++;
+
+    int16_t value = distance < 0 ? NO_TARGET : distance;
+    if (value != NO_TARGET && signalRate < _config.minSignalRate) {
+        _stats.gatedSignal++;
+        value = NO_TARGET;
+    } else if (value != NO_TARGET && ambientRate > _config.maxAmbientRate) {
+        _stats.gatedAmbient++;
+        value = NO_TARGET;
+    }
+
+    if (_config.medianEnabled) {
+        value = median(value);
+    }
+
+    if (value == NO_TARGET) {
+        _estimating = false;
+        return -1;
+    }
+    return _config.kalmanEnabled ? kalman(value) : value;
+}
+
+// Mediana z 3 ostatnich próbek - usuwa pojedyncze skoki w obie strony
+// (odblask w oknie gestów albo chwilowa utrata dłoni) kosztem jednej próbki opóźnienia
+int16_t RangeFilter::median(int16_t value) {
+    _window[0] = _window[1];
+    _window[1] = _window[2];
+    _window[2] = value;
+    if (_filled < 3) {
+        _filled++;
+        return value;
+    }
+
+    int16_t a = _window[0];
+    int16_t b = _window[1];
+    int16_t c = _window[2];
+    int16_t result;
+    if ((a <= b && b <= c) || (c <= b && b <= a)) {
+        result = b;
+    } else if ((b <= a && a <= c) || (c <= a && a <= b)) {
+        result = a;
+    } else {
+        result = c;
+    }
+
+    // Statystyka: środkowa próbka odstawała od obu sąsiadów w tę samą stronę
+    if ((b > a + SPIKE_MM && b > c + SPIKE_MM) || (b < a - SPIKE_MM && b < c - SPIKE_MM)) {
+        _stats.suppressed++;
+    }
+    return result;
+}
+
+// Model stałej pozycji; duży skok (nowa dłoń, zmiana celu) zaczyna estymację od nowa,
+// żeby filtr nie ciągnął starej wartości
+int RangeFilter::kalman(int distance) {
+    if (!_estimating || (distance > _estimate + _config.kalmanResetMm) ||
+        (distance < _estimate - _config.kalmanResetMm)) {
+        _estimate = distance;
+        _variance = _config.kalmanR;
+        _estimating = true;
+        return distance;
+    }
+
+    _variance += _config.kalmanQ;
+    float gain = _variance / (_variance + _config.kalmanR);
+    _estimate += gain * (distance - _estimate);
+    _variance *= 1.0f - gain;
+    return (int)(_estimate + 0.5f);
+}
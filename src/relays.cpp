@@ -2,6 +2,13 @@
 #include "relays.h"
 #include "config.h"
 #include "webserver.h"  // Add this include
+#include "metrics.h"
+#include "trace.h"
+#include "latency.h"
+
+// Bieg faktycznie ustawiony na przekaźnikach. currentSpeed bywa przypisywany przed
+// setFanSpeed(), więc nie nadaje się do wykrywania przełączeń.
+static int relaySpeed = 0;
 
 void setupRelays() {
     // Konfiguracja pinów przekaźników jako wyjścia
@@ -16,7 +23,8 @@ void setupRelays() {
 }
 
 void setFanSpeed(int speed) {
-    int oldSpeed = currentSpeed;
+    TRACE_SCOPE("setFanSpeed");
+    int oldSpeed = relaySpeed;
     // Sterowanie prędkością wentylatora przy użyciu przekaźników
     switch (speed) {
         case 0: 
@@ -45,6 +53,11 @@ void setFanSpeed(int speed) {
             digitalWrite(RELAY_PIN3, LOW);
             break;
     }
+    latencyMark(STAGE_RELAY);
+
+    if (speed != oldSpeed) {
+        metricIncrement(METRIC_RELAY_SWITCHES);
+    }
 
     if (speed == 0) {
         isFanRunning = false;
@@ -53,5 +66,6 @@ void setFanSpeed(int speed) {
         fanStartTime = millis();
     }
 
+    relaySpeed = speed;
     currentSpeed = speed;
 }
@@ -0,0 +1,164 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "telemetry.h"
+#include "webhook.h"
+#include "webserver.h"
+#include "config.h"
+#include "outbox.h"
+
+// Bufor cykliczny próbek - przy zapełnieniu najstarsze są nadpisywane
+static TelemetrySample samples[MAX_TELEMETRY_BATCH];
+static size_t sampleHead = 0;   // Indeks najstarszej próbki
+static size_t sampleCount = 0;
+static unsigned long batchStartTime = 0;
+static SemaphoreHandle_t batchLock = xSemaphoreCreateMutex();
+
+static unsigned long fanRunningTime() {
+    return isFanRunning ? (millis() - fanStartTime) / 1000 : 0;
+}
+
+static void addSample() {
+    if (sampleCount == 0) {
+        batchStartTime = millis();
+    }
+
+    size_t index = (sampleHead + sampleCount) % MAX_TELEMETRY_BATCH;
+    if (sampleCount == MAX_TELEMETRY_BATCH) {
+        sampleHead = (sampleHead + 1) % MAX_TELEMETRY_BATCH;
+    } else {
+        sampleCount++;
+    }
+
+    TelemetrySample& sample = samples[index];
+    sample.timestamp = time(nullptr);
+    sample.speed = currentSpeed;
+    sample.temperature = temperature;
+    sample.humidity = humidity;
+    sample.absHumidity = absHumidity;
+    sample.dewPoint = dewPoint;
+    sample.runningTime = fanRunningTime();
+}
+
+#define TELEMETRY_LINE_MAX 200     // Najdłuższa linia próbki (ok. 150 B typowo)
+
+// Składa paczkę jako tablicę JSON albo NDJSON (jeden obiekt w linii), od próbki first.
+// Paczka nie przekracza OUTBOX_RECORD_MAX, żeby nieudana wysyłka mogła trafić do outboxa;
+// count zwraca liczbę próbek, które się zmieściły (co najmniej jedna).
+static String buildBatchPayload(size_t first, size_t& count) {
+    String payload;
+    payload.reserve(min((sampleCount - first) * 152 + 2, (size_t)OUTBOX_RECORD_MAX));
+
+    if (!telemetryNdjson) {
+        payload += '[';
+    }
+
+    char line[TELEMETRY_LINE_MAX];
+    size_t i = first;
+    for (; i < sampleCount; i++) {
+        const TelemetrySample& sample = samples[(sampleHead + i) % MAX_TELEMETRY_BATCH];
+        int length = snprintf(line, sizeof(line),
+                 "{\"timestamp\":%ld,\"speed\":%d,\"cause\":\"PERIODIC\",\"temperature\":%.2f,\"humidity\":%.2f,\"absHumidity\":%.2f,\"dewPoint\":%.2f,\"runningTime\":%lu}",
+                 (long)sample.timestamp, sample.speed, sample.temperature, sample.humidity,
+                 sample.absHumidity, sample.dewPoint, sample.runningTime);
+        // Separator i zamknięcie tablicy / znak nowej linii - po 1 B
+        if (i > first && payload.length() + length + 2 > OUTBOX_RECORD_MAX) {
+            break;
+        }
+        if (i > first && !telemetryNdjson) {
+            payload += ',';
+        }
+        payload += line;
+        if (telemetryNdjson) {
+            payload += '\n';
+        }
+    }
+
+    if (!telemetryNdjson) {
+        payload += ']';
+    }
+    count = i - first;
+    return payload;
+}
+
+void flushTelemetryBatch() {
+    if (webhookTargetCount == 0) {
+        return;
+    }
+
+    xSemaphoreTake(batchLock, portMAX_DELAY);
+    if (sampleCount == 0) {
+        xSemaphoreGive(batchLock);
+        return;
+    }
+
+    // Wysyłka odbywa się w zadaniach celów - tu tylko przekazujemy gotowe paczki
+    size_t count = sampleCount;
+    size_t parts = 0;
+    for (size_t first = 0; first < sampleCount; parts++) {
+        size_t used;
+        dispatchWebhookBatch(buildBatchPayload(first, used), telemetryNdjson);
+        first += used;
+    }
+    sampleHead = 0;
+    sampleCount = 0;
+    xSemaphoreGive(batchLock);
+
+    Serial.printf("Telemetry batch queued (%u samples, %u parts)\n", (unsigned)count, (unsigned)parts);
+}
+
+size_t telemetryPendingCount() {
+    return sampleCount;
+}
+
+// Raport okresowy tylko przy zmianie biegu, wyjściu temperatury/wilgotności poza
+// strefę martwą albo po upływie interwału heartbeat. Strefa 0 wyłącza dany warunek -
+// zostaje sam interwał.
+static bool periodicReportDue() {
+    static bool reported = false;
+    static unsigned long lastReportTime = 0;
+    static int lastSpeed = 0;
+    static float lastTemp = 0.0f;
+    static float lastHum = 0.0f;
+
+    bool due = !reported ||
+               currentSpeed != lastSpeed ||
+               (tempDeadband > 0 && fabsf(temperature - lastTemp) >= tempDeadband) ||
+               (humDeadband > 0 && fabsf(humidity - lastHum) >= humDeadband) ||
+               millis() - lastReportTime >= heartbeatInterval;
+
+    if (due) {
+        reported = true;
+        lastReportTime = millis();
+        lastSpeed = currentSpeed;
+        lastTemp = temperature;
+        lastHum = humidity;
+    }
+    return due;
+}
+
+void sendPeriodicWebhook() {
+    static unsigned long lastCheckTime = 0;
+    static unsigned long lastSampleTime = 0;
+
+    if (!telemetryBatchEnabled) {
+        if (millis() - lastCheckTime >= PERIODIC_CHECK_INTERVAL) {
+            lastCheckTime = millis();
+            if (periodicReportDue()) {
+                sendWebhookRequest(currentSpeed, "PERIODIC", currentSpeed);
+            }
+        }
+        return;
+    }
+
+    if (millis() - lastSampleTime >= telemetrySampleInterval) {
+        xSemaphoreTake(batchLock, portMAX_DELAY);
+        addSample();
+        xSemaphoreGive(batchLock);
+        lastSampleTime = millis();
+    }
+
+    if (sampleCount >= (size_t)telemetryBatchSize ||
+        (sampleCount > 0 && millis() - batchStartTime >= telemetryBatchMaxAge)) {
+        flushTelemetryBatch();
+    }
+}
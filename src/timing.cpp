@@ -0,0 +1,159 @@
+#include "timing.h"
+#include "metrics.h"
+
+static const char* ROUTE_NAMES[TIMING_ROUTE_COUNT] = {
+    "/state", "/default", "/gesture", "/autoSettings", "/webhook"
+};
+static const char* STAGE_NAMES[TIMING_STAGE_COUNT] = {
+    "parse", "validate", "apply", "persist", "notify"
+};
+
+static const uint32_t STAGE_BOUNDS[METRIC_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000
+};
+
+// Etapy + całość żądania (ostatni histogram)
+#define ROUTE_HISTOGRAM { STAGE_BOUNDS, {}, 0, portMUX_INITIALIZER_UNLOCKED }
+#define ROUTE_HISTOGRAMS { ROUTE_HISTOGRAM, ROUTE_HISTOGRAM, ROUTE_HISTOGRAM, \
+                           ROUTE_HISTOGRAM, ROUTE_HISTOGRAM, ROUTE_HISTOGRAM }
+
+static Histogram routeHistograms[TIMING_ROUTE_COUNT][TIMING_STAGE_COUNT + 1] = {
+    ROUTE_HISTOGRAMS, ROUTE_HISTOGRAMS, ROUTE_HISTOGRAMS, ROUTE_HISTOGRAMS, ROUTE_HISTOGRAMS
+};
+
+RequestTiming::RequestTiming(TimingRoute route) : _route(route) {
+    _start = micros();
+    _last = _start;
+    for (uint8_t i = 0; i < TIMING_STAGE_COUNT; i++) {
+        _stages[i] = 0;
+    }
+}
+
+void RequestTiming::mark(TimingStage stage) {
+    uint32_t now = micros();
+    _stages[stage] += now - _last;
+    _marked |= 1 << stage;
+    _last = now;
+}
+
+void RequestTiming::send(AsyncWebServerRequest* request, int code,
+                         const String& contentType, const String& content) {
+    uint32_t totalUs = micros() - _start;
+
+    // parse;dur=0.412, ... - czasy w milisekundach
+    char header[160];
+    size_t length = 0;
+    for (uint8_t i = 0; i < TIMING_STAGE_COUNT && length < sizeof(header); i++) {
+        if (_marked & (1 << i)) {
+            length += snprintf(header + length, sizeof(header) - length, "%s;dur=%.3f, ",
+                               STAGE_NAMES[i], _stages[i] / 1000.0f);
+            routeHistograms[_route][i].observe(_stages[i]);
+        }
+    }
+    if (length < sizeof(header)) {
+        snprintf(header + length, sizeof(header) - length, "total;dur=%.3f", totalUs / 1000.0f);
+    }
+    routeHistograms[_route][TIMING_STAGE_COUNT].observe(totalUs);
+
+    AsyncWebServerResponse* response = request->beginResponse(code, contentType, content);
+    response->addHeader("Server-Timing", header);
+    request->send(response);
+}
+
+enum TimingSection : uint8_t {
+    SECTION_HEAD = 0,       // Granice kubełków, początek "routes"
+    SECTION_ROUTES,         // Jeden histogram na część: najpierw "total", potem etapy
+    SECTION_END,
+    SECTION_DONE
+};
+
+TimingStream::TimingStream() {
+    for (uint8_t r = 0; r < TIMING_ROUTE_COUNT; r++) {
+        for (uint8_t h = 0; h <= TIMING_STAGE_COUNT; h++) {
+            Histogram& histogram = routeHistograms[r][h];
+            for (uint8_t b = 0; b <= METRIC_BUCKETS; b++) {
+                _buckets[r][h][b] = histogram.buckets[b].load(std::memory_order_relaxed);
+            }
+            portENTER_CRITICAL(&histogram.sumLock);
+            _sums[r][h] = histogram.sum;
+            portEXIT_CRITICAL(&histogram.sumLock);
+        }
+    }
+}
+
+bool TimingStream::nextPart() {
+    int length = -1;
+
+    while (length < 0) {
+        switch (_section) {
+            case SECTION_HEAD:
+                // Górne granice kubełków (us); ostatni kubełek w "buckets" to +Inf
+                length = snprintf(_part, sizeof(_part), "{\"boundsUs\":[");
+                for (uint8_t b = 0; b < METRIC_BUCKETS; b++) {
+                    length += snprintf(_part + length, sizeof(_part) - length, "%s%u",
+                                       b ? "," : "", STAGE_BOUNDS[b]);
+                }
+                length += snprintf(_part + length, sizeof(_part) - length, "],\"routes\":{");
+                _section++;
+                break;
+
+            case SECTION_ROUTES: {
+                if (_route >= TIMING_ROUTE_COUNT) {
+                    _section++;
+                    break;
+                }
+                // Całość żądania jest ostatnim histogramem trasy, ale w odpowiedzi pierwsza
+                uint8_t h = _item == 0 ? TIMING_STAGE_COUNT : _item - 1;
+                const uint32_t* buckets = _buckets[_route][h];
+
+                if (_item == 0) {
+                    length = snprintf(_part, sizeof(_part), "%s\"%s\":{\"total\":{\"buckets\":[",
+                                      _route ? "," : "", ROUTE_NAMES[_route]);
+                } else {
+                    length = snprintf(_part, sizeof(_part), ",\"%s\":{\"buckets\":[", STAGE_NAMES[h]);
+                }
+                uint32_t count = 0;
+                for (uint8_t b = 0; b <= METRIC_BUCKETS; b++) {
+                    length += snprintf(_part + length, sizeof(_part) - length, "%s%u",
+                                       b ? "," : "", buckets[b]);
+                    count += buckets[b];
+                }
+                length += snprintf(_part + length, sizeof(_part) - length, "],\"count\":%u,\"avgUs\":%u}%s",
+                                   count, count ? (uint32_t)(_sums[_route][h] / count) : 0,
+                                   _item == TIMING_STAGE_COUNT ? "}" : "");
+
+                if (++_item > TIMING_STAGE_COUNT) {
+                    _item = 0;
+                    _route++;
+                }
+                break;
+            }
+
+            case SECTION_END:
+                length = snprintf(_part, sizeof(_part), "}}");
+                _section++;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    _partLength = (size_t)length < sizeof(_part) ? length : sizeof(_part) - 1;
+    _partPos = 0;
+    return true;
+}
+
+size_t TimingStream::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (_partPos >= _partLength && !nextPart()) {
+            break;
+        }
+        size_t count = min(maxLen - written, _partLength - _partPos);
+        memcpy(buffer + written, _part + _partPos, count);
+        written += count;
+        _partPos += count;
+    }
+    return written;
+}
@@ -0,0 +1,147 @@
+#include "trace.h"
+#include <atomic>
+
+#if TRACE_ENABLED
+
+static TraceEvent events[TRACE_BUFFER_SIZE];
+static uint16_t eventHead = 0;
+static uint16_t eventCount = 0;
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<uint8_t> traceReaders(0);     // Pobierania w toku (async_tcp)
+
+#define TRACE_MAX_THREADS 16
+static TaskHandle_t threads[TRACE_MAX_THREADS];
+static uint8_t threadCount = 0;
+
+void traceRecord(const char* name, char phase) {
+    // Sprawdzenie pod blokadą, jak w captureRecord() - pobieranie nie zacznie się w trakcie zapisu
+    portENTER_CRITICAL_SAFE(&traceLock);
+    if (traceReaders) {
+        portEXIT_CRITICAL_SAFE(&traceLock);
+        return;
+    }
+    TraceEvent& event = events[eventHead];
+    event.cycles = ESP.getCycleCount();
+    event.ticks = xTaskGetTickCount();
+    event.name = name;
+    event.task = xTaskGetCurrentTaskHandle();
+    event.phase = phase;
+    event.core = xPortGetCoreID();
+    eventHead = (eventHead + 1) % TRACE_BUFFER_SIZE;
+    if (eventCount < TRACE_BUFFER_SIZE) {
+        eventCount++;
+    }
+    portEXIT_CRITICAL_SAFE(&traceLock);
+}
+
+static uint8_t threadId(TaskHandle_t task) {
+    for (uint8_t i = 0; i < threadCount; i++) {
+        if (threads[i] == task) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// CCOUNT przepełnia się co ~18 s przy 240 MHz. Tick FreeRTOS (1 ms) wyznacza,
+// ile pełnych obiegów minęło, a CCOUNT daje dokładność poniżej mikrosekundy.
+static double eventMicros(const TraceEvent& event, uint32_t mhz) {
+    int64_t expected = (int64_t)event.ticks * portTICK_PERIOD_MS * 1000 * mhz;
+    int64_t wraps = (expected - (int64_t)event.cycles + (1LL << 31)) >> 32;
+    if (wraps < 0) {
+        wraps = 0;
+    }
+    uint64_t cycles = ((uint64_t)wraps << 32) + event.cycles;
+    return (double)cycles / mhz;
+}
+
+TraceStream::TraceStream() {
+    // Po wstrzymaniu zapisu pierścień już się nie zmienia
+    portENTER_CRITICAL(&traceLock);
+    traceReaders++;
+    _count = eventCount;
+    _start = (eventHead + TRACE_BUFFER_SIZE - eventCount) % TRACE_BUFFER_SIZE;
+    portEXIT_CRITICAL(&traceLock);
+
+    threadCount = 0;
+    for (uint16_t i = 0; i < _count; i++) {
+        TaskHandle_t task = events[(_start + i) % TRACE_BUFFER_SIZE].task;
+        if (!threadId(task) && threadCount < TRACE_MAX_THREADS) {
+            threads[threadCount++] = task;
+        }
+    }
+}
+
+TraceStream::~TraceStream() {
+    traceReaders--;
+}
+
+bool TraceStream::nextLine() {
+    int length = -1;
+
+    while (length < 0) {
+        switch (_section) {
+            case 0:
+                length = snprintf(_line, sizeof(_line), "{\"traceEvents\":[\n");
+                _section++;
+                break;
+
+            case 1:
+                // Nazwy wątków (zadań FreeRTOS) w widoku Perfetto
+                if (_item >= threadCount) {
+                    _section++;
+                    _item = 0;
+                    break;
+                }
+                length = snprintf(_line, sizeof(_line),
+                                  "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}\n",
+                                  _item == 0 ? "" : ",", _item + 1, pcTaskGetTaskName(threads[_item]));
+                _item++;
+                break;
+
+            case 2: {
+                if (_item >= _count) {
+                    _section++;
+                    break;
+                }
+                const TraceEvent& event = events[(_start + _item) % TRACE_BUFFER_SIZE];
+                uint8_t tid = threadId(event.task);
+                if (tid) {
+                    length = snprintf(_line, sizeof(_line),
+                                      ",{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u}}\n",
+                                      event.name, event.phase, eventMicros(event, getCpuFrequencyMhz()), tid, event.core);
+                }
+                _item++;
+                break;
+            }
+
+            case 3:
+                length = snprintf(_line, sizeof(_line), "],\"displayTimeUnit\":\"ms\"}\n");
+                _section++;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    _lineLength = (size_t)length < sizeof(_line) ? length : sizeof(_line) - 1;
+    _linePos = 0;
+    return true;
+}
+
+size_t TraceStream::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (_linePos >= _lineLength && !nextLine()) {
+            break;
+        }
+        size_t count = min(maxLen - written, _lineLength - _linePos);
+        memcpy(buffer + written, _line + _linePos, count);
+        written += count;
+        _linePos += count;
+    }
+    return written;
+}
+
+#endif
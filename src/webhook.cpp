@@ -0,0 +1,726 @@
+#include <WiFi.h>
+#include <Preferences.h>
+#include "webhook.h"
+#include "config.h"
+#include "metrics.h"
+
+extern Preferences preferences;
+
+WebhookTarget webhookTargets[MAX_WEBHOOK_TARGETS];
+int webhookTargetCount = 0;
+
+const char* DEFAULT_WEBHOOK_TEMPLATE =
+    "{\"speed\":{{speed}},\"cause\":\"{{cause}}\",\"previousSpeed\":{{previousSpeed}},"
+    "\"temperature\":{{temperature}},\"humidity\":{{humidity}},\"absHumidity\":{{absHumidity}},\"dewPoint\":{{dewPoint}},"
+    "\"runningTime\":{{runningTime}},\"seq\":{{seq}}}";
+
+static const char* const CAUSE_NAMES[CAUSE_COUNT] = { "API", "GESTURE", "AUTO", "PERIODIC", "MQTT" };
+
+enum ContentType : uint8_t {
+    CONTENT_JSON = 0,
+    CONTENT_NDJSON,
+    CONTENT_TYPE_COUNT
+};
+
+static const char* const CONTENT_TYPES[CONTENT_TYPE_COUNT] = { "application/json", "application/x-ndjson" };
+
+static portMUX_TYPE sequenceMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t sequenceNext = 0;
+static uint32_t sequenceReserved = 0;
+
+const char* webhookCauseName(uint8_t cause) {
+    return cause < CAUSE_COUNT ? CAUSE_NAMES[cause] : "";
+}
+
+int webhookCauseFromString(const String& name) {
+    for (int i = 0; i < CAUSE_COUNT; i++) {
+        if (name == CAUSE_NAMES[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void WebhookLatencyStats::add(uint32_t ms) {
+    count++;
+    totalMs += ms;
+    lastMs = ms;
+    if (ms > maxMs) {
+        maxMs = ms;
+    }
+}
+
+WebhookConnection::WebhookConnection() {
+    _lock = xSemaphoreCreateMutex();
+    // Tak jak HTTPClient::begin(url) bez certyfikatu CA - połączenie TLS bez weryfikacji
+    _secureClient.setInsecure();
+}
+
+void WebhookConnection::setUrl(const String& url) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (url != _url) {
+        _url = url;
+        parseUrl();
+        reset();
+    }
+    xSemaphoreGive(_lock);
+}
+
+void WebhookConnection::reset() {
+    _plainClient.stop();
+    _secureClient.stop();
+    _resolved = false;
+}
+
+bool WebhookConnection::parseUrl() {
+    _valid = false;
+
+    int schemeEnd = _url.indexOf("://");
+    if (schemeEnd < 0) {
+        return false;
+    }
+    String scheme = _url.substring(0, schemeEnd);
+    scheme.toLowerCase();
+    if (scheme != "http" && scheme != "https") {
+        return false;
+    }
+    _secure = (scheme == "https");
+
+    int hostStart = schemeEnd + 3;
+    int pathStart = _url.indexOf('/', hostStart);
+    if (pathStart < 0) {
+        pathStart = _url.length();
+    }
+
+    String authority = _url.substring(hostStart, pathStart);
+    int at = authority.lastIndexOf('@');  // user:pass@host
+    if (at >= 0) {
+        authority.remove(0, at + 1);
+    }
+
+    int colon = authority.lastIndexOf(':');
+    if (colon >= 0) {
+        _host = authority.substring(0, colon);
+        _port = authority.substring(colon + 1).toInt();
+    } else {
+        _host = authority;
+        _port = _secure ? 443 : 80;
+    }
+
+    _valid = _host.length() > 0 && _port > 0;
+    return _valid;
+}
+
+bool WebhookConnection::resolve() {
+    if (_resolved && millis() - _resolvedAt < WEBHOOK_DNS_TTL) {
+        return true;
+    }
+
+    IPAddress ip;
+    if (!ip.fromString(_host)) {
+        dnsLookups++;
+        if (WiFi.hostByName(_host.c_str(), ip) != 1) {
+            _resolved = false;
+            return false;
+        }
+    }
+
+    _address = ip;
+    _resolvedAt = millis();
+    _resolved = true;
+    return true;
+}
+
+bool WebhookConnection::ensureConnected(bool& reused) {
+    WiFiClient& client = _secure ? static_cast<WiFiClient&>(_secureClient) : _plainClient;
+    if (client.connected()) {
+        reused = true;
+        return true;
+    }
+
+    reused = false;
+    client.stop();
+
+    // TLS potrzebuje nazwy hosta (SNI), więc połączenie otworzy HTTPClient
+    if (_secure) {
+        return true;
+    }
+
+    if (!resolve()) {
+        return false;
+    }
+    if (!_plainClient.connect(_address, _port, WEBHOOK_TIMEOUT)) {
+        _resolved = false;  // Adres mógł się zmienić - następnym razem zapytaj DNS
+        return false;
+    }
+    return true;
+}
+
+int WebhookConnection::postOnce(const uint8_t* payload, size_t length, const char* contentType, uint32_t sequence, bool& reused) {
+    if (!ensureConnected(reused)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    WiFiClient& client = _secure ? static_cast<WiFiClient&>(_secureClient) : _plainClient;
+    _http.setReuse(webhookKeepAlive);
+    if (!_http.begin(client, _url)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    _http.addHeader("Content-Type", contentType);
+    if (sequence) {
+        _http.addHeader("X-Sequence-Id", String(sequence));
+    }
+    _http.setTimeout(WEBHOOK_TIMEOUT);
+
+    int code = _http.POST(const_cast<uint8_t*>(payload), length);
+    _http.end();
+    return code;
+}
+
+int WebhookConnection::post(const uint8_t* payload, size_t length, const char* contentType, uint32_t sequence) {
+    if (xSemaphoreTake(_lock, pdMS_TO_TICKS(WEBHOOK_TIMEOUT)) != pdTRUE) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    if (!_valid) {
+        xSemaphoreGive(_lock);
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    unsigned long start = micros();
+    bool reused = false;
+    int code = postOnce(payload, length, contentType, sequence, reused);
+
+    // Serwer zamknął bezczynne połączenie - połącz się od nowa i wyślij jeszcze raz
+    if (reused && (code == HTTPC_ERROR_SEND_HEADER_FAILED ||
+                   code == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+                   code == HTTPC_ERROR_CONNECTION_LOST ||
+                   code == HTTPC_ERROR_NOT_CONNECTED)) {
+        reconnects++;
+        reset();
+        code = postOnce(payload, length, contentType, sequence, reused);
+    }
+
+    uint32_t elapsedUs = micros() - start;
+    metricObserve(METRIC_WEBHOOK_LATENCY, elapsedUs);
+    uint32_t elapsedMs = elapsedUs / 1000;
+    if (reused) {
+        reusedStats.add(elapsedMs);
+    } else {
+        freshStats.add(elapsedMs);
+    }
+
+    if (!webhookKeepAlive || code <= 0) {
+        reset();
+    }
+
+    xSemaphoreGive(_lock);
+    return code;
+}
+
+// --- Szablony payloadu ---
+
+enum TemplateField : uint8_t {
+    FIELD_TEXT = 0,
+    FIELD_SPEED,
+    FIELD_PREVIOUS_SPEED,
+    FIELD_CAUSE,
+    FIELD_TEMPERATURE,
+    FIELD_HUMIDITY,
+    FIELD_ABS_HUMIDITY,
+    FIELD_DEW_POINT,
+    FIELD_RUNNING_TIME,
+    FIELD_TIMESTAMP,
+    FIELD_SEQUENCE,
+    FIELD_COUNT
+};
+
+static const char* const FIELD_NAMES[FIELD_COUNT] = {
+    "", "speed", "previousSpeed", "cause", "temperature", "humidity", "absHumidity", "dewPoint", "runningTime", "timestamp", "seq"
+};
+
+bool PayloadTemplate::compile(const String& source) {
+    Token tokens[WEBHOOK_TEMPLATE_MAX_TOKENS];
+    uint8_t count = 0;
+    int length = source.length();
+    int pos = 0;
+
+    if (length > WEBHOOK_PAYLOAD_MAX) {
+        return false;
+    }
+
+    while (pos < length) {
+        int open = source.indexOf("{{", pos);
+        int textEnd = open < 0 ? length : open;
+
+        if (textEnd > pos) {
+            if (count >= WEBHOOK_TEMPLATE_MAX_TOKENS) {
+                return false;
+            }
+            tokens[count++] = { FIELD_TEXT, (uint16_t)pos, (uint16_t)(textEnd - pos) };
+        }
+        if (open < 0) {
+            break;
+        }
+
+        int close = source.indexOf("}}", open + 2);
+        if (close < 0) {
+            return false;
+        }
+        String name = source.substring(open + 2, close);
+        name.trim();
+
+        uint8_t field = FIELD_TEXT;
+        for (uint8_t f = 1; f < FIELD_COUNT; f++) {
+            if (name == FIELD_NAMES[f]) {
+                field = f;
+                break;
+            }
+        }
+        if (field == FIELD_TEXT || count >= WEBHOOK_TEMPLATE_MAX_TOKENS) {
+            return false;
+        }
+        tokens[count++] = { field, 0, 0 };
+        pos = close + 2;
+    }
+
+    _source = source;
+    memcpy(_tokens, tokens, sizeof(Token) * count);
+    _tokenCount = count;
+    return true;
+}
+
+size_t PayloadTemplate::render(const WebhookEvent& event, char* out, size_t size) const {
+    size_t pos = 0;
+    const char* source = _source.c_str();
+
+    for (uint8_t i = 0; i < _tokenCount && pos + 1 < size; i++) {
+        const Token& token = _tokens[i];
+        size_t remaining = size - pos;
+        int written = 0;
+
+        switch (token.field) {
+            case FIELD_TEXT:
+                written = token.length < remaining - 1 ? token.length : remaining - 1;
+                memcpy(out + pos, source + token.offset, written);
+                break;
+            case FIELD_SPEED:
+                written = snprintf(out + pos, remaining, "%d", event.speed);
+                break;
+            case FIELD_PREVIOUS_SPEED:
+                written = snprintf(out + pos, remaining, "%d", event.previousSpeed);
+                break;
+            case FIELD_CAUSE:
+                written = snprintf(out + pos, remaining, "%s", webhookCauseName(event.cause));
+                break;
+            case FIELD_TEMPERATURE:
+                written = snprintf(out + pos, remaining, "%.2f", event.temperature);
+                break;
+            case FIELD_HUMIDITY:
+                written = snprintf(out + pos, remaining, "%.2f", event.humidity);
+                break;
+            case FIELD_ABS_HUMIDITY:
+                written = snprintf(out + pos, remaining, "%.2f", event.absHumidity);
+                break;
+            case FIELD_DEW_POINT:
+                written = snprintf(out + pos, remaining, "%.2f", event.dewPoint);
+                break;
+            case FIELD_RUNNING_TIME:
+                written = snprintf(out + pos, remaining, "%lu", (unsigned long)event.runningTime);
+                break;
+            case FIELD_TIMESTAMP:
+                written = snprintf(out + pos, remaining, "%ld", (long)event.timestamp);
+                break;
+            case FIELD_SEQUENCE:
+                written = snprintf(out + pos, remaining, "%lu", (unsigned long)event.sequence);
+                break;
+        }
+
+        if (written < 0) {
+            break;
+        }
+        pos += (size_t)written < remaining - 1 ? (size_t)written : remaining - 1;
+    }
+
+    out[pos] = '\0';
+    return pos;
+}
+
+// --- Cele i kolejki ---
+
+struct WebhookJob {
+    WebhookEvent event;
+    String* batch;              // Gotowy payload paczki (zwalnia zadanie) albo nullptr
+    uint8_t contentType;
+    bool clearOutbox;           // Zadanie sterujące: cel zmienił adres, zaległe rekordy do usunięcia
+};
+
+// Potwierdzenie od serwera: 2xx. Błędy 4xx też kończą próby (ponowienie nic nie zmieni).
+static bool isDelivered(int httpResponseCode) {
+    return httpResponseCode > 0 && httpResponseCode < 500;
+}
+
+// Przygotowuje payload zadania - paczka jest gotowa, zdarzenie renderujemy szablonem do bufora
+static size_t preparePayload(WebhookTarget& target, const WebhookJob& job, uint8_t* buffer, const uint8_t*& payload) {
+    if (job.batch) {
+        payload = (const uint8_t*)job.batch->c_str();
+        return job.batch->length();
+    }
+    xSemaphoreTake(target.lock, portMAX_DELAY);
+    size_t length = target.payloadTemplate.render(job.event, (char*)buffer, WEBHOOK_PAYLOAD_MAX);
+    xSemaphoreGive(target.lock);
+    payload = buffer;
+    return length;
+}
+
+// Za duży payload liczy outbox (rejectedOversize), dropped zostaje dla błędów zapisu
+static void appendToOutbox(WebhookTarget& target, const WebhookJob& job, const uint8_t* payload, size_t length) {
+    if (!target.outbox.append(job.event.sequence, job.contentType, payload, length) &&
+        length <= OUTBOX_RECORD_MAX) {
+        target.dropped++;
+    }
+}
+
+static void storeInOutbox(WebhookTarget& target, const WebhookJob& job, uint8_t* buffer) {
+    const uint8_t* payload;
+    size_t length = preparePayload(target, job, buffer, payload);
+    appendToOutbox(target, job, payload, length);
+    delete job.batch;
+}
+
+// Outbox jest używany tylko przez zadanie celu, więc czyści go ono samo po odebraniu
+// zadania sterującego z configureWebhookTarget()
+static bool clearOutboxJob(WebhookTarget& target, const WebhookJob& job, int index) {
+    if (!job.clearOutbox) {
+        return false;
+    }
+    if (!target.outbox.empty()) {
+        Serial.printf("Webhook %d: zmiana adresu - usunięto %lu zaległych zdarzeń\n", index,
+                      (unsigned long)target.outbox.count());
+    }
+    target.outbox.clear();
+    return true;
+}
+
+static void webhookTask(void* param) {
+    WebhookTarget* target = static_cast<WebhookTarget*>(param);
+    int index = target - webhookTargets;
+    // Jeden bufor na cały czas życia zadania - mieści też rekordy paczek z outboxa
+    uint8_t* buffer = (uint8_t*)malloc(OUTBOX_RECORD_MAX);
+    if (!buffer) {
+        Serial.printf("Webhook %d: brak pamięci na bufor\n", index);
+        vTaskDelete(nullptr);
+        return;
+    }
+    unsigned long retryDelay = WEBHOOK_RETRY_MIN;
+    unsigned long nextAttempt = millis();
+    WebhookJob job;
+
+    for (;;) {
+        // Są zaległe rekordy - nowe zdarzenia trafiają na koniec outboxa, żeby zachować kolejność
+        if (!target->outbox.empty()) {
+            while (xQueueReceive(target->queue, &job, 0) == pdTRUE) {
+                if (!clearOutboxJob(*target, job, index)) {
+                    storeInOutbox(*target, job, buffer);
+                }
+            }
+            if (target->outbox.empty()) {
+                retryDelay = WEBHOOK_RETRY_MIN;
+                continue;
+            }
+
+            long wait = (long)(nextAttempt - millis());
+            if (wait > 0) {
+                // Czekaj na kolejną próbę, ale nie blokuj przyjmowania zdarzeń
+                xQueuePeek(target->queue, &job, pdMS_TO_TICKS(wait));
+                continue;
+            }
+
+            OutboxRecordHeader header;
+            if (!target->outbox.peek(header, buffer, OUTBOX_RECORD_MAX)) {
+                continue;
+            }
+
+            uint8_t type = header.contentType < CONTENT_TYPE_COUNT ? header.contentType : CONTENT_JSON;
+            int httpResponseCode = target->connection.post(buffer, header.length, CONTENT_TYPES[type], header.sequence);
+            if (isDelivered(httpResponseCode)) {
+                target->outbox.pop();
+                target->delivered++;
+                metricIncrement(METRIC_WEBHOOK_SUCCESS);
+                retryDelay = WEBHOOK_RETRY_MIN;
+                nextAttempt = millis() + OUTBOX_REPLAY_INTERVAL;
+                Serial.printf("Webhook %d replayed #%lu (%lu left)\n", index,
+                              (unsigned long)header.sequence, (unsigned long)target->outbox.count());
+            } else {
+                target->failed++;
+                metricIncrement(METRIC_WEBHOOK_FAILURE);
+                target->outbox.flush();     // Seria przerwana - zapisz head odłożony przez pop()
+                nextAttempt = millis() + retryDelay;
+                retryDelay = min(retryDelay * 2, (unsigned long)WEBHOOK_RETRY_MAX);
+            }
+            continue;
+        }
+
+        if (xQueueReceive(target->queue, &job, portMAX_DELAY) != pdTRUE || clearOutboxJob(*target, job, index)) {
+            continue;
+        }
+
+        const uint8_t* payload;
+        size_t length = preparePayload(*target, job, buffer, payload);
+        int httpResponseCode = target->connection.post(payload, length, CONTENT_TYPES[job.contentType], job.event.sequence);
+
+        if (isDelivered(httpResponseCode)) {
+            target->delivered++;
+            metricIncrement(METRIC_WEBHOOK_SUCCESS);
+            Serial.printf("Webhook %d sent! Response code: %d\n", index, httpResponseCode);
+        } else {
+            target->failed++;
+            metricIncrement(METRIC_WEBHOOK_FAILURE);
+            Serial.printf("Webhook %d failed! Error: %s\n", index, HTTPClient::errorToString(httpResponseCode).c_str());
+            // Zachowaj zdarzenie do ponownego wysłania, gdy serwer znów odpowie
+            appendToOutbox(*target, job, payload, length);
+            nextAttempt = millis() + retryDelay;
+            retryDelay = min(retryDelay * 2, (unsigned long)WEBHOOK_RETRY_MAX);
+        }
+        delete job.batch;
+    }
+}
+
+static void startTargetTask(WebhookTarget& target) {
+    if (target.task) {
+        return;
+    }
+    char name[16];
+    snprintf(name, sizeof(name), "webhook%d", (int)(&target - webhookTargets));
+    target.queue = xQueueCreate(WEBHOOK_QUEUE_LENGTH, sizeof(WebhookJob));
+    xTaskCreate(webhookTask, name, WEBHOOK_TASK_STACK, &target, 1, &target.task);
+}
+
+// Wstawia zadanie do kolejki celu; przy pełnej kolejce odrzuca najstarsze
+static void enqueueJob(WebhookTarget& target, const WebhookJob& job) {
+    if (xQueueSend(target.queue, &job, 0) == pdTRUE) {
+        return;
+    }
+    WebhookJob oldest;
+    if (xQueueReceive(target.queue, &oldest, 0) == pdTRUE) {
+        delete oldest.batch;
+        target.dropped++;
+    }
+    if (xQueueSend(target.queue, &job, 0) != pdTRUE) {
+        delete job.batch;
+        target.dropped++;
+    }
+}
+
+// Zdarzenia czekające w kolejce i outboxie należą do poprzedniego odbiorcy - nie mogą
+// trafić pod nowy adres ani zostać na zawsze w pliku usuniętego celu
+static void discardPendingEvents(WebhookTarget& target) {
+    WebhookJob job;
+    while (xQueueReceive(target.queue, &job, 0) == pdTRUE) {
+        delete job.batch;
+    }
+    WebhookJob clearJob = {};
+    clearJob.clearOutbox = true;
+    xQueueSendToFront(target.queue, &clearJob, 0);
+}
+
+bool validateWebhookTarget(const String& url, const String& templateSource) {
+    if (!url.isEmpty()) {
+        int schemeEnd = url.indexOf("://");
+        String scheme = url.substring(0, schemeEnd < 0 ? 0 : schemeEnd);
+        scheme.toLowerCase();
+        if ((scheme != "http" && scheme != "https") || (int)url.length() <= schemeEnd + 3 ||
+            url[schemeEnd + 3] == '/' || url[schemeEnd + 3] == ':') {
+            return false;
+        }
+    }
+    PayloadTemplate compiled;
+    return compiled.compile(templateSource.isEmpty() ? String(DEFAULT_WEBHOOK_TEMPLATE) : templateSource);
+}
+
+bool configureWebhookTarget(int index, const String& url, uint8_t causeMask,
+                            unsigned long minInterval, const String& templateSource) {
+    if (index < 0 || index >= MAX_WEBHOOK_TARGETS) {
+        return false;
+    }
+
+    WebhookTarget& target = webhookTargets[index];
+    PayloadTemplate compiled;
+    if (!compiled.compile(templateSource.isEmpty() ? String(DEFAULT_WEBHOOK_TEMPLATE) : templateSource)) {
+        return false;
+    }
+
+    xSemaphoreTake(target.lock, portMAX_DELAY);
+    bool urlChanged = target.url != url;
+    target.url = url;
+    target.causeMask = causeMask & CAUSE_MASK_ALL;
+    target.minInterval = minInterval;
+    target.payloadTemplate = compiled;
+    target.queuedOnce = false;
+    xSemaphoreGive(target.lock);
+
+    target.connection.setUrl(url);
+    // Bez zadania cel nie miał jeszcze adresu od startu - outbox z flash należy do tego celu
+    if (urlChanged && target.task) {
+        discardPendingEvents(target);
+    }
+    if (!url.isEmpty()) {
+        startTargetTask(target);
+    }
+    return true;
+}
+
+void setWebhookTargetCount(int count) {
+    if (count < 0) {
+        count = 0;
+    }
+    if (count > MAX_WEBHOOK_TARGETS) {
+        count = MAX_WEBHOOK_TARGETS;
+    }
+    // Cele poza listą przestają dostawać zdarzenia
+    for (int i = count; i < MAX_WEBHOOK_TARGETS; i++) {
+        configureWebhookTarget(i, "", CAUSE_MASK_ALL, 0, "");
+    }
+    webhookTargetCount = count;
+}
+
+void saveWebhookTargets() {
+    char key[16];
+    preferences.putInt("whCount", webhookTargetCount);
+    preferences.putBool("whMaskMqtt", true);
+    for (int i = 0; i < webhookTargetCount; i++) {
+        WebhookTarget& target = webhookTargets[i];
+        snprintf(key, sizeof(key), "wh%dUrl", i);
+        preferences.putString(key, target.url);
+        snprintf(key, sizeof(key), "wh%dMask", i);
+        preferences.putUChar(key, target.causeMask);
+        snprintf(key, sizeof(key), "wh%dMin", i);
+        preferences.putULong(key, target.minInterval);
+        snprintf(key, sizeof(key), "wh%dTpl", i);
+        preferences.putString(key, target.payloadTemplate.source());
+    }
+}
+
+uint32_t nextWebhookSequence() {
+    portENTER_CRITICAL(&sequenceMux);
+    uint32_t sequence = sequenceNext++;
+    bool reserve = sequenceNext > sequenceReserved;
+    if (reserve) {
+        sequenceReserved += WEBHOOK_SEQUENCE_BLOCK;
+    }
+    uint32_t reserved = sequenceReserved;
+    portEXIT_CRITICAL(&sequenceMux);
+
+    // Zapis do NVS raz na blok - po restarcie numeracja zaczyna się za zarezerwowanym blokiem
+    if (reserve) {
+        preferences.putULong("whSeq", reserved);
+    }
+    return sequence;
+}
+
+// Outbox celu usuniętego przed restartem nie ma już odbiorcy
+static void dropOrphanOutboxes() {
+    for (int i = 0; i < MAX_WEBHOOK_TARGETS; i++) {
+        WebhookTarget& target = webhookTargets[i];
+        if ((i >= webhookTargetCount || target.url.isEmpty()) && !target.outbox.empty()) {
+            Serial.printf("Webhook %d: usunięto outbox bez celu (%lu zdarzeń)\n", i, (unsigned long)target.outbox.count());
+            target.outbox.clear();
+        }
+    }
+}
+
+void setupWebhooks() {
+    setupOutboxStorage();
+    for (int i = 0; i < MAX_WEBHOOK_TARGETS; i++) {
+        webhookTargets[i].lock = xSemaphoreCreateMutex();
+        webhookTargets[i].outbox.begin(i);
+    }
+
+    webhookKeepAlive = preferences.getBool("webhookReuse", true);
+    sequenceNext = preferences.getULong("whSeq", 1);
+    sequenceReserved = sequenceNext;
+
+    // Migracja z pojedynczego adresu "webhook" z poprzednich wersji
+    if (!preferences.isKey("whCount")) {
+        String legacyUrl = preferences.getString("webhook", "");
+        if (!legacyUrl.isEmpty()) {
+            configureWebhookTarget(0, legacyUrl, CAUSE_MASK_ALL, 0, DEFAULT_WEBHOOK_TEMPLATE);
+            webhookTargetCount = 1;
+            saveWebhookTargets();
+            preferences.remove("webhook");
+        }
+        dropOrphanOutboxes();
+        return;
+    }
+
+    char key[16];
+    int count = preferences.getInt("whCount", 0);
+    // Maski zapisane przed dodaniem CAUSE_MQTT - komendy MQTT szły wtedy jako API
+    bool mqttInMask = preferences.getBool("whMaskMqtt", false);
+    for (int i = 0; i < count && i < MAX_WEBHOOK_TARGETS; i++) {
+        snprintf(key, sizeof(key), "wh%dUrl", i);
+        String url = preferences.getString(key, "");
+        snprintf(key, sizeof(key), "wh%dMask", i);
+        uint8_t mask = preferences.getUChar(key, CAUSE_MASK_ALL);
+        if (!mqttInMask && (mask & (1 << CAUSE_API))) {
+            mask |= 1 << CAUSE_MQTT;
+        }
+        snprintf(key, sizeof(key), "wh%dMin", i);
+        unsigned long minInterval = preferences.getULong(key, 0);
+        snprintf(key, sizeof(key), "wh%dTpl", i);
+        String templateSource = preferences.getString(key, DEFAULT_WEBHOOK_TEMPLATE);
+
+        if (!configureWebhookTarget(i, url, mask, minInterval, templateSource)) {
+            Serial.printf("Webhook %d: niepoprawny szablon, używam domyślnego\n", i);
+            configureWebhookTarget(i, url, mask, minInterval, DEFAULT_WEBHOOK_TEMPLATE);
+        }
+        Serial.printf("Załadowano webhook %d: %s\n", i, url.c_str());
+    }
+    webhookTargetCount = count < MAX_WEBHOOK_TARGETS ? count : MAX_WEBHOOK_TARGETS;
+    dropOrphanOutboxes();
+}
+
+void dispatchWebhookEvent(const WebhookEvent& event) {
+    for (int i = 0; i < webhookTargetCount; i++) {
+        WebhookTarget& target = webhookTargets[i];
+
+        xSemaphoreTake(target.lock, portMAX_DELAY);
+        bool accepted = !target.url.isEmpty() && target.queue &&
+                        (event.cause >= CAUSE_COUNT || (target.causeMask & (1 << event.cause)));
+        if (accepted && target.minInterval > 0 && target.queuedOnce &&
+            millis() - target.lastQueuedTime < target.minInterval) {
+            target.throttled++;
+            accepted = false;
+        }
+        if (accepted) {
+            target.lastQueuedTime = millis();
+            target.queuedOnce = true;
+        }
+        xSemaphoreGive(target.lock);
+
+        if (accepted) {
+            WebhookJob job = { event, nullptr, CONTENT_JSON };
+            enqueueJob(target, job);
+        }
+    }
+}
+
+void dispatchWebhookBatch(const String& payload, bool ndjson) {
+    WebhookEvent event = {};
+    event.sequence = nextWebhookSequence();
+    event.timestamp = time(nullptr);
+    event.cause = CAUSE_PERIODIC;
+
+    for (int i = 0; i < webhookTargetCount; i++) {
+        WebhookTarget& target = webhookTargets[i];
+
+        xSemaphoreTake(target.lock, portMAX_DELAY);
+        bool accepted = !target.url.isEmpty() && target.queue && (target.causeMask & (1 << CAUSE_PERIODIC));
+        xSemaphoreGive(target.lock);
+
+        if (accepted) {
+            WebhookJob job = { event, new String(payload), ndjson ? CONTENT_NDJSON : CONTENT_JSON };
+            enqueueJob(target, job);
+        }
+    }
+}
@@ -9,11 +9,25 @@
 #include "relays.h"
 #include "config.h"  // This already includes LogEntry struct
 #include "gesture.h"
+#include "webhook.h"
+#include "telemetry.h"
+#include "mqtt.h"
+#include "metrics.h"
+#include "diagnostics.h"
+#include "trace.h"
+#include "latency.h"
+#include "timing.h"
+#include "capture.h"
+#include "gesture_model.h"
+#include "i2c_bus.h"
+#include "humidity.h"
+#include "env_detector.h"
 
 extern int currentSpeed;
 extern int defaultSpeed;
 extern float temperature;
 extern float humidity;
+extern float pressure;
 extern bool gestureControlEnabled;
 
 Preferences preferences;
@@ -22,6 +36,9 @@ AsyncWebSocket ws("/ws");
 
 static const size_t MAX_LOGS = 100;
 
+// Wykrywanie różnicowe okap - pokój, gdy jest czujnik odniesienia
+static DifferentialDetector diffDetector;
+
 // Add the logging function
 void addLog(const String& cause, int fromSpeed, int toSpeed, const String& details) {
     if (speedLogs.size() >= MAX_LOG_ENTRIES) {
@@ -40,21 +57,61 @@ void addLog(const String& cause, int fromSpeed, int toSpeed, const String& detai
 
 // Funkcja do powiadamiania klientów przez WebSocket
 void notifyClients() {
-    StaticJsonDocument<256> jsonResponse;  // Use StaticJsonDocument instead of JsonDocument
+    TRACE_SCOPE("notifyClients");
+    StaticJsonDocument<640> jsonResponse;  // Use StaticJsonDocument instead of JsonDocument
     jsonResponse["currentSpeed"] = currentSpeed;
     jsonResponse["temperature"] = temperature;
     jsonResponse["humidity"] = humidity;
+    jsonResponse["pressure"] = pressure;
+    jsonResponse["absHumidity"] = absHumidity;
+    jsonResponse["dewPoint"] = dewPoint;
     jsonResponse["gestureControlEnabled"] = gestureControlEnabled;
     jsonResponse["gestureDetected"] = gestureDetected;
     jsonResponse["holdDetected"] = holdDetected;
     jsonResponse["tempRiseThreshold"] = tempRiseThreshold;
-    jsonResponse["humRiseThreshold"] = humRiseThreshold;
+    jsonResponse["ahRiseThreshold"] = ahRiseThreshold;
     jsonResponse["monitoringInterval"] = monitoringInterval;
     jsonResponse["autoActivationEnabled"] = autoActivationEnabled;
     jsonResponse["distance"] = currentDistance;  // Add distance to websocket data
+    jsonResponse["envSensor"] = i2cDeviceOnline(I2C_DEV_BME280);
+    if (i2cDeviceOnline(I2C_DEV_BME280_ROOM)) {
+        jsonResponse["roomTemperature"] = roomTemperature;
+        jsonResponse["roomHumidity"] = roomHumidity;
+        jsonResponse["diffTemperature"] = diffDetector.deltaTemperature();
+        jsonResponse["diffAbsHumidity"] = diffDetector.deltaAbsHumidity();
+    }
+    jsonResponse["gestureSensor"] = i2cDeviceOnline(I2C_DEV_VL53L0X);
+    if (dualSensors) {
+        jsonResponse["distanceRight"] = rightDistance;
+    }
     String response;
     serializeJson(jsonResponse, response);
     ws.textAll(response);
+    latencyMark(STAGE_WS_QUEUED);
+
+    mqttPublishState();
+}
+
+// Wspólna ścieżka zmiany biegu dla POST /state i komend MQTT; source ("API"/"MQTT")
+// trafia do logu i jako przyczyna zdarzenia webhooka
+bool applySpeedCommand(int speed, const String& source, RequestTiming* timing) {
+    if (speed < 0 || speed > 4) {
+        return false;
+    }
+    metricIncrement(METRIC_API_COMMANDS);
+    int oldSpeed = currentSpeed;
+    addLog(source, currentSpeed, speed);
+    setFanSpeed(speed);
+    currentSpeed = speed;
+    sendWebhookRequest(currentSpeed, source, oldSpeed);
+    if (timing) {
+        timing->mark(TIMING_APPLY);
+    }
+    notifyClients();
+    if (timing) {
+        timing->mark(TIMING_NOTIFY);
+    }
+    return true;
 }
 
 // Obsługa zdarzeń WebSocket
@@ -66,113 +123,236 @@ void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsE
     }
 }
 
-// Update the webhook request function with better error handling
+// Przekazuje zdarzenie do kolejek celów webhooka - wysyłka odbywa się w ich zadaniach
 void sendWebhookRequest(int speed, const String& cause, int previousSpeed) {
-    if (webhookUrl.isEmpty()) {
+    TRACE_SCOPE("sendWebhookRequest");
+    if (webhookTargetCount == 0) {
         return;
     }
 
-    HTTPClient http;
-    http.begin(webhookUrl);
-    http.addHeader("Content-Type", "application/json");
-    http.setTimeout(5000);  // 5 second timeout
+    // Zdarzenie zmiany stanu - najpierw wyślij zebrane próbki, żeby zachować kolejność
+    if (telemetryBatchEnabled && cause != "PERIODIC") {
+        flushTelemetryBatch();
+    }
+
+    WebhookEvent event;
+    event.sequence = nextWebhookSequence();
+    event.timestamp = time(nullptr);
+    event.runningTime = isFanRunning ? (millis() - fanStartTime) / 1000 : 0;
+    event.temperature = temperature;
+    event.humidity = humidity;
+    event.absHumidity = absHumidity;
+    event.dewPoint = dewPoint;
+    event.speed = speed;
+    event.previousSpeed = previousSpeed;
+    int causeIndex = webhookCauseFromString(cause);
+    event.cause = causeIndex < 0 ? CAUSE_COUNT : causeIndex;
 
-    unsigned long runningTime = 0;
-    if (isFanRunning) {
-        runningTime = (millis() - fanStartTime) / 1000;
+    dispatchWebhookEvent(event);
+}
+
+// ...existing code...
+
+// Zmiana presetu BME280 z HTTP - stosowana w pętli głównej, która jako jedyna używa I2C
+static volatile int pendingBmePreset = -1;
+
+static bool startBme(BurstBME280& sensor, uint8_t address, I2cDevice device, BmeReading& reading) {
+    bool ok;
+    {
+        I2cTransaction bus(device);
+        ok = sensor.begin(address);
+        if (ok) {
+            sensor.applyPreset(preferences.getUChar("bmePreset", DEFAULT_BME_PRESET));
+            ok = sensor.readBlocking(reading);
+            sensor.startMeasurement();  // Wynik gotowy na następne updateSensorData()
+        }
     }
+    i2cDeviceSetOnline(device, ok);
+    return ok;
+}
 
-    StaticJsonDocument<512> doc;
-    doc["speed"] = speed;
-    doc["cause"] = cause;
-    doc["previousSpeed"] = previousSpeed;
-    doc["temperature"] = temperature;
-    doc["humidity"] = humidity;
-    doc["runningTime"] = runningTime;
+enum BmeReadResult : uint8_t { BME_READ_OK, BME_READ_DEFERRED, BME_READ_FAILED };
 
-    String payload;
-    serializeJson(doc, payload);
-    
-    int httpResponseCode = http.POST(payload);
-    
-    if (httpResponseCode > 0) {
-        Serial.printf("Webhook sent! Response code: %d\n", httpResponseCode);
-    } else {
-        Serial.printf("Webhook failed! Error: %s\n", http.errorToString(httpResponseCode).c_str());
+// Odczyt pomiaru wyzwolonego w poprzednim wywołaniu i od razu wyzwolenie następnego -
+// pomiar w trybie forced trwa kilka-kilkadziesiąt ms, a odstęp to 1 s
+static BmeReadResult readBme(BurstBME280& sensor, I2cDevice device, BmeReading& reading) {
+    I2cTransaction bus(device, I2C_PRIORITY_LOW, 0);
+    if (!bus.acquired()) {
+        return BME_READ_DEFERRED;
+    }
+
+    unsigned long readStart = micros();
+    bool ok = sensor.readAll(reading);
+    sensor.startMeasurement();
+    metricObserve(METRIC_I2C_READ_TIME, micros() - readStart);
+    if (!ok) {
+        bus.fail();
+        return BME_READ_FAILED;
+    }
+    return BME_READ_OK;
+}
+
+// Nowy preset dla obu czujników; setSampling() w trybie forced od razu wyzwala pomiar
+static void applyPendingPreset() {
+    int preset = pendingBmePreset;
+    if (preset < 0) {
+        return;
+    }
+    pendingBmePreset = -1;
+    if (i2cDeviceOnline(I2C_DEV_BME280)) {
+        I2cTransaction bus(I2C_DEV_BME280);
+        bme.applyPreset(preset);
+    }
+    if (i2cDeviceOnline(I2C_DEV_BME280_ROOM)) {
+        I2cTransaction bus(I2C_DEV_BME280_ROOM);
+        bmeRoom.applyPreset(preset);
     }
-    
-    http.end();
 }
 
-// Add periodic webhook update function
-void sendPeriodicWebhook() {
-    static unsigned long lastWebhookTime = 0;
-    const unsigned long WEBHOOK_INTERVAL = 10000; // 10 seconds
+bool startEnvSensor() {
+    BmeReading reading;
+    if (!startBme(bme, BME280_HOOD_ADDRESS, I2C_DEV_BME280, reading)) {
+        return false;
+    }
+
+    // Punkt odniesienia dla wykrywania wzrostu - bez fałszywego wyzwolenia po starcie
+    temperature = reading.temperature;
+    humidity = reading.humidity;
+    pressure = reading.pressure;
+    absHumidity = absoluteHumidity(temperature, humidity, pressure);
+    dewPoint = dewPointTemperature(temperature, humidity);
+    lastTemperature = temperature;
+    lastAbsHumidity = absHumidity;
+    lastDewPoint = dewPoint;
+    lastMonitoringTime = millis();
+    return true;
+}
 
-    if (millis() - lastWebhookTime >= WEBHOOK_INTERVAL) {
-        sendWebhookRequest(currentSpeed, "PERIODIC", currentSpeed);
-        lastWebhookTime = millis();
+bool startRoomSensor() {
+    BmeReading reading;
+    if (!startBme(bmeRoom, BME280_ROOM_ADDRESS, I2C_DEV_BME280_ROOM, reading)) {
+        return false;
     }
+    roomTemperature = reading.temperature;
+    roomHumidity = reading.humidity;
+    roomPressure = reading.pressure;
+    diffDetector.reset();   // Nowa linia bazowa - czujnik mógł zmienić miejsce
+    return true;
 }
 
-// ...existing code...
+// Jednakowa reakcja obu metod wykrywania: włączenie wentylatora albo wpis w logu
+static void reportCooking(const String& details) {
+    if (currentSpeed == 0) {
+        Serial.println("Detected cooking activity! Activating fan.");
+        metricIncrement(METRIC_AUTO_TRIGGERS);
+        setFanSpeed(defaultSpeed);
+        addLog("AUTO", 0, currentSpeed, details);
+        sendWebhookRequest(currentSpeed, "AUTO", 0);
+    } else {
+        // Fan already running, just log the event
+        addLog("DETECT", currentSpeed, currentSpeed, details);
+    }
+}
+
+bool updateSensorData() {
+    TRACE_SCOPE("updateSensorData");
+    if (!i2cDeviceOnline(I2C_DEV_BME280)) {
+        // Bez czujnika automatyka stoi; ponowna inicjalizacja coraz rzadziej
+        if (i2cDeviceRetryDue(I2C_DEV_BME280) && startEnvSensor()) {
+            notifyClients();
+        }
+        return true;
+    }
 
-void updateSensorData() {
-    float newTemperature = bme.readTemperature();
-    float newHumidity = bme.readHumidity();
+    BmeReading reading;
+    BmeReadResult result = readBme(bme, I2C_DEV_BME280, reading);
+    if (result != BME_READ_OK) {
+        // Odłożony odczyt ponawiany w następnym obiegu loop(), błąd - w następnym cyklu
+        return result != BME_READ_DEFERRED;
+    }
+    applyPendingPreset();
+
+    // Czujnik odniesienia zmienia się wolno - odłożony odczyt czeka na następny cykl
+    bool roomFresh = false;
+    if (i2cDeviceOnline(I2C_DEV_BME280_ROOM)) {
+        BmeReading room;
+        if (readBme(bmeRoom, I2C_DEV_BME280_ROOM, room) == BME_READ_OK) {
+            roomTemperature = room.temperature;
+            roomHumidity = room.humidity;
+            roomPressure = room.pressure;
+            roomFresh = true;
+        }
+    } else if (i2cDeviceRetryDue(I2C_DEV_BME280_ROOM)) {
+        startRoomSensor();
+    }
+
+    float newTemperature = reading.temperature;
+    float newHumidity = reading.humidity;
+    float newAbsHumidity = absoluteHumidity(newTemperature, newHumidity, reading.pressure);
+    float newDewPoint = dewPointTemperature(newTemperature, newHumidity);
+    pressure = reading.pressure;
     
     // Initialize last values if they are zero (first run)
     if (lastTemperature == 0) {
         lastTemperature = newTemperature;
-        lastHumidity = newHumidity;
+        lastAbsHumidity = newAbsHumidity;
+        lastDewPoint = newDewPoint;
         lastMonitoringTime = millis();
         temperature = newTemperature;
         humidity = newHumidity;
+        absHumidity = newAbsHumidity;
+        dewPoint = newDewPoint;
         notifyClients();
-        return; // Skip the first reading to avoid false triggers
+        return true; // Skip the first reading to avoid false triggers
     }
     
+    // Z czujnikiem odniesienia: różnica okap - pokój co próbkę. Linia bazowa uczy się
+    // także przy wyłączonej automatyce, żeby po włączeniu była gotowa.
+    if (roomFresh) {
+        DifferentialConfig config = diffDetector.config();
+        config.tempThreshold = diffTempThreshold;
+        config.ahThreshold = diffAhThreshold;
+        diffDetector.setConfig(config);
+        bool detected = diffDetector.update(millis(), newTemperature, newAbsHumidity,
+                                            roomTemperature, absoluteHumidity(roomTemperature, roomHumidity, roomPressure),
+                                            currentSpeed > 0);
+        if (detected && autoActivationEnabled) {
+            Serial.printf("Hood-room difference: %.2f°C, %.2f g/m3\n",
+                          diffDetector.deltaTemperature(), diffDetector.deltaAbsHumidity());
+            reportCooking("Hood-room: +" + String(diffDetector.deltaTemperature(), 1) + "°C, +" +
+                          String(diffDetector.deltaAbsHumidity(), 1) + "g/m3");
+        }
+    }
+
     // Calculate rate of change per minute
     unsigned long timeDiff = (millis() - lastMonitoringTime) / 1000.0f; // Convert to seconds
-    if (autoActivationEnabled && timeDiff >= (monitoringInterval / 1000)) { // Check every monitoringInterval seconds
+    if (timeDiff >= (monitoringInterval / 1000)) { // Check every monitoringInterval seconds
         float tempChangeRate = ((newTemperature - lastTemperature) / timeDiff) * 60.0f; // Change per minute
-        float humChangeRate = ((newHumidity - lastHumidity) / timeDiff) * 60.0f;       // Change per minute
-
-        // If fan is off and we detect significant changes, activate it
-        if (currentSpeed == 0 && 
-            (tempChangeRate >= tempRiseThreshold || humChangeRate >= humRiseThreshold)) {
-            Serial.println("Detected cooking activity! Activating fan.");
-            Serial.printf("Temperature change rate: %.2f°C/min, Humidity change rate: %.2f%%/min\n", 
-                        tempChangeRate, humChangeRate);
-            
-            currentSpeed = defaultSpeed;
-            setFanSpeed(currentSpeed);
-            sendWebhookRequest(currentSpeed, "AUTO", 0);
-        }
+        // Wilgotność bezwzględna zamiast względnej - %RH spada przy nagrzewaniu i maskuje parę
+        float ahChangeRate = ((newAbsHumidity - lastAbsHumidity) / timeDiff) * 60.0f;   // g/m³ na minutę
+        float dewPointChangeRate = ((newDewPoint - lastDewPoint) / timeDiff) * 60.0f;
 
-        // Log significant changes even if fan is already on
-        if (tempChangeRate >= tempRiseThreshold || humChangeRate >= humRiseThreshold) {
-            String details = "Temp: " + String(tempChangeRate, 1) + "°C/min, Hum: " + String(humChangeRate, 1) + "%/min";
-            
-            if (currentSpeed == 0) {
-                // Fan was off, turning on
-                currentSpeed = defaultSpeed;
-                setFanSpeed(currentSpeed);
-                addLog("AUTO", 0, currentSpeed, details);
-            } else {
-                // Fan already running, just log the event
-                addLog("DETECT", currentSpeed, currentSpeed, details);
-            }
+        // Bez czujnika odniesienia - tempo zmian na samym okapie
+        if (autoActivationEnabled && !i2cDeviceOnline(I2C_DEV_BME280_ROOM) &&
+            (tempChangeRate >= tempRiseThreshold || ahChangeRate >= ahRiseThreshold)) {
+            Serial.printf("Temperature change rate: %.2f°C/min, Absolute humidity change rate: %.2f g/m3/min, Dew point change rate: %.2f°C/min\n",
+                        tempChangeRate, ahChangeRate, dewPointChangeRate);
+            reportCooking("Temp: " + String(tempChangeRate, 1) + "°C/min, AH: " + String(ahChangeRate, 2) +
+                          "g/m3/min, Td: " + String(dewPointChangeRate, 1) + "°C/min");
         }
 
         lastTemperature = newTemperature;
-        lastHumidity = newHumidity;
+        lastAbsHumidity = newAbsHumidity;
+        lastDewPoint = newDewPoint;
         lastMonitoringTime = millis();
     }
 
     temperature = newTemperature;
     humidity = newHumidity;
+    absHumidity = newAbsHumidity;
+    dewPoint = newDewPoint;
     notifyClients();
+    return true;
 }
 
 void setupWebServer() {
@@ -182,38 +362,40 @@ void setupWebServer() {
     if (!preferences.isKey("defaultTempThreshold")) {
         preferences.putFloat("defaultTempThreshold", DEFAULT_TEMP_THRESHOLD);
     }
-    if (!preferences.isKey("defaultHumThreshold")) {
-        preferences.putFloat("defaultHumThreshold", DEFAULT_HUM_THRESHOLD);
-    }
     if (!preferences.isKey("defaultCheckInterval")) {
         preferences.putULong("defaultCheckInterval", DEFAULT_CHECK_INTERVAL);
     }
 
     // Load configuration
-    webhookUrl = preferences.getString("webhook", "");
+    setupWebhooks();
     defaultSpeed = preferences.getInt("defaultSpeed", 1);
     gestureControlEnabled = preferences.getBool("gestureEnabled", true);
     
     // Load thresholds from preferences, using stored defaults as fallback
     float defaultTemp = preferences.getFloat("defaultTempThreshold", DEFAULT_TEMP_THRESHOLD);
-    float defaultHum = preferences.getFloat("defaultHumThreshold", DEFAULT_HUM_THRESHOLD);
     unsigned long defaultInterval = preferences.getULong("defaultCheckInterval", DEFAULT_CHECK_INTERVAL);
     
     tempRiseThreshold = preferences.getFloat("tempThreshold", defaultTemp);
-    humRiseThreshold = preferences.getFloat("humThreshold", defaultHum);
+    ahRiseThreshold = preferences.getFloat("ahThreshold", DEFAULT_AH_THRESHOLD);   // Stary próg %/min nie pasuje do g/m³
     monitoringInterval = preferences.getULong("monitorInterval", defaultInterval);
     autoActivationEnabled = preferences.getBool("autoActivation", true);
+    diffTempThreshold = preferences.getFloat("diffTemp", DEFAULT_DIFF_TEMP_THRESHOLD);
+    diffAhThreshold = preferences.getFloat("diffAh", DEFAULT_DIFF_AH_THRESHOLD);
 
-    Serial.println("Załadowano adres webhooka: " + webhookUrl);
-    Serial.printf("Załadowano domyślny bieg: %d\n", defaultSpeed);
+    telemetryBatchEnabled = preferences.getBool("tlmBatch", false);
+    telemetrySampleInterval = preferences.getULong("tlmSample", DEFAULT_TELEMETRY_SAMPLE_INTERVAL);
+    telemetryBatchSize = preferences.getInt("tlmSize", DEFAULT_TELEMETRY_BATCH_SIZE);
+    telemetryBatchMaxAge = preferences.getULong("tlmAge", DEFAULT_TELEMETRY_BATCH_AGE);
+    telemetryNdjson = preferences.getBool("tlmNdjson", false);
+    heartbeatInterval = preferences.getULong("hbInterval", DEFAULT_HEARTBEAT_INTERVAL);
+    tempDeadband = preferences.getFloat("tempDeadband", DEFAULT_TEMP_DEADBAND);
+    humDeadband = preferences.getFloat("humDeadband", DEFAULT_HUM_DEADBAND);
 
-    if (!bme.begin(0x76)) {
-        Serial.println("Błąd inicjalizacji BME280!");
-        while (1);
-    }
+    Serial.printf("Załadowano domyślny bieg: %d\n", defaultSpeed);
 
     // Główna strona HTML
     server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /");
         String html = "<!DOCTYPE html>";
         html += "<html lang=\"pl\">";
         html += "<head>";
@@ -247,7 +429,7 @@ void setupWebServer() {
         html += "input:checked + .slider { background-color: #0288d1; }";
         html += "input:checked + .slider:before { transform: translateX(26px); }";
         html += ".setting-row { display: flex; justify-content: space-between; align-items: center; margin: 10px 0; }";
-        html += "input[type=\"number\"], input[type=\"text\"] { background: #303030; border: none; color: white; padding: 8px; border-radius: 4px; width: 120px; }";
+        html += "input[type=\"number\"], input[type=\"text\"], select { background: #303030; border: none; color: white; padding: 8px; border-radius: 4px; width: 120px; }";
         // Add network settings styles
         html += ".network-inputs { display: grid; grid-template-columns: 1fr; gap: 10px; margin-top: 10px; }";
         html += ".network-inputs.active { display: grid; }";
@@ -379,6 +561,37 @@ void setupWebServer() {
         html += "<h3>Wilgotność:</h3>";
         html += "<span class=\"sensor-value\" id=\"humidity\">" + String(humidity, 1) + " %</span>";
         html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<h3>Ciśnienie:</h3>";
+        html += "<span class=\"sensor-value\" id=\"pressure\">" + String(pressure, 1) + " hPa</span>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<h3>Wilgotność bezwzględna:</h3>";
+        html += "<span class=\"sensor-value\" id=\"absHumidity\">" + String(absHumidity, 2) + " g/m³</span>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<h3>Punkt rosy:</h3>";
+        html += "<span class=\"sensor-value\" id=\"dewPoint\">" + String(dewPoint, 1) + " °C</span>";
+        html += "</div>";
+        html += "<div class=\"setting-row\" id=\"roomRow\" style=\"display:none\">";
+        html += "<h3>Pokój:</h3>";
+        html += "<span class=\"sensor-value\" id=\"room\">-</span>";
+        html += "</div>";
+        html += "<div class=\"setting-row\" id=\"diffRow\" style=\"display:none\">";
+        html += "<label>Okap - pokój (ponad tło):</label>";
+        html += "<span id=\"diff\">-</span>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Próbkowanie BME280:</label>";
+        html += "<select id=\"bmePreset\" onchange=\"saveEnvSensor()\">";
+        const char* bmeLabels[BME_PRESET_COUNT] = { "Pogoda (forced x1)", "Wygładzone (forced, IIR x4)",
+                                                    "Dokładne (forced x2/x4/x2)", "Ciągłe (normal)" };
+        for (uint8_t i = 0; i < BME_PRESET_COUNT; i++) {
+            html += "<option value=\"" + String(BME_PRESETS[i].name) + "\"" +
+                    String(bme.preset() == i ? " selected" : "") + ">" + bmeLabels[i] + "</option>";
+        }
+        html += "</select>";
+        html += "</div>";
         html += "</div>";
 
         // 5. Gesture Control
@@ -387,6 +600,41 @@ void setupWebServer() {
         html += "<h3>Sterowanie gestami</h3>";
         html += "<label class=\"switch\"><input type=\"checkbox\" id=\"gestureControl\" " + String(gestureControlEnabled ? "checked" : "") + " onchange=\"toggleGestureControl()\"><span class=\"slider\"></span></label>";
         html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Okno gestów (mm):</label>";
+        html += "<span><input type=\"number\" id=\"gWinMin\" value=\"" + String(gestureConfig.minDistance) + "\" min=\"20\" max=\"1000\" style=\"width:70px\">";
+        html += " - <input type=\"number\" id=\"gWinMax\" value=\"" + String(userMaxDistance) + "\" min=\"20\" max=\"1000\" style=\"width:70px\"></span>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Maks. czas tapnięcia (ms):</label>";
+        html += "<input type=\"number\" id=\"gTapMax\" value=\"" + String(gestureConfig.tapMaxMs) + "\" min=\"100\" max=\"3000\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Okno double-tap (ms, 0 = wył.):</label>";
+        html += "<input type=\"number\" id=\"gDblTap\" value=\"" + String(gestureConfig.doubleTapWindowMs) + "\" min=\"0\" max=\"2000\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Min. ruch przesunięcia (mm):</label>";
+        html += "<input type=\"number\" id=\"gSwipeMin\" value=\"" + String(gestureConfig.swipeMinTravel) + "\" min=\"10\" max=\"500\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Tryb proporcjonalny po (ms):</label>";
+        html += "<input type=\"number\" id=\"gSliderHold\" value=\"" + String(gestureConfig.sliderHoldMs) + "\" min=\"300\" max=\"10000\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Klasyfikator (model):</label>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"gClassifier\" " + String(gestureConfig.classifierEnabled ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Automatyczna kalibracja okna:</label>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"gCalAuto\" " + String(autoCalibration ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Tło:</label>";
+        html += "<span id=\"gCalStatus\">" + (calibrationBaseline >= 0 ? String(calibrationBaseline) + " mm" : String("brak celu")) + "</span>";
+        html += "</div>";
+        html += "<button class=\"btn\" onclick=\"saveGestureSettings()\">Zapisz</button>";
+        html += "<button class=\"btn btn-off\" onclick=\"calibrateGesture()\">Kalibruj okno (30 s, bez rąk pod okapem)</button>";
         html += "</div>";
 
         // Add distance sensor card
@@ -410,13 +658,21 @@ void setupWebServer() {
         html += "<input type=\"number\" id=\"tempThreshold\" value=\"" + String(tempRiseThreshold) + "\" step=\"0.1\" min=\"0.1\" max=\"10\">";
         html += "</div>";
         html += "<div class=\"setting-row\">";
-        html += "<label>Próg wilgotności (%/min):</label>";
-        html += "<input type=\"number\" id=\"humThreshold\" value=\"" + String(humRiseThreshold) + "\" step=\"0.1\" min=\"0.1\" max=\"20\">";
+        html += "<label>Próg wilgotności bezwzględnej (g/m³/min):</label>";
+        html += "<input type=\"number\" id=\"ahThreshold\" value=\"" + String(ahRiseThreshold) + "\" step=\"0.05\" min=\"0.05\" max=\"10\">";
         html += "</div>";
         html += "<div class=\"setting-row\">";
         html += "<label>Interwał sprawdzania (s):</label>";
         html += "<input type=\"number\" id=\"checkInterval\" value=\"" + String(monitoringInterval/1000) + "\" min=\"1\" max=\"60\">";
         html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Różnica okap-pokój, temperatura (°C):</label>";
+        html += "<input type=\"number\" id=\"diffTempThreshold\" value=\"" + String(diffTempThreshold) + "\" step=\"0.1\" min=\"0.2\" max=\"10\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Różnica okap-pokój, wilgotność (g/m³):</label>";
+        html += "<input type=\"number\" id=\"diffAhThreshold\" value=\"" + String(diffAhThreshold) + "\" step=\"0.1\" min=\"0.2\" max=\"10\">";
+        html += "</div>";
         html += "<button class=\"btn\" onclick=\"updateAutoSettings()\">Zapisz ustawienia</button>";
         html += "</div>";
 
@@ -429,13 +685,176 @@ void setupWebServer() {
         html += "<button class=\"btn\" onclick=\"setDefault()\">Ustaw</button>";
         html += "</div>";
 
-        // 8. Webhook
+        // 8. Webhook targets
         html += "<div class=\"card\">";
-        html += "<h3>Webhook URL:</h3>";
-        html += "<input type=\"text\" id=\"webhookUrl\" placeholder=\"Podaj adres webhooka\" value=\"" + webhookUrl + "\">";
+        html += "<h3>Webhooki:</h3>";
+        for (int i = 0; i < MAX_WEBHOOK_TARGETS; i++) {
+            const WebhookTarget& target = webhookTargets[i];
+            bool active = i < webhookTargetCount;
+            String idx = String(i);
+            if (i > 0) {
+                html += "<div class=\"separator\"></div>";
+            }
+            html += "<input type=\"text\" id=\"whUrl" + idx + "\" placeholder=\"Adres webhooka " + String(i + 1) + "\" value=\"" + (active ? target.url : String("")) + "\">";
+            html += "<div class=\"setting-row\">";
+            for (int c = 0; c < CAUSE_COUNT; c++) {
+                bool checked = !active || (target.causeMask & (1 << c));
+                html += "<label><input type=\"checkbox\" id=\"whCause" + idx + "_" + String(c) + "\" " + String(checked ? "checked" : "") + "> " + webhookCauseName(c) + "</label>";
+            }
+            html += "</div>";
+            html += "<div class=\"setting-row\">";
+            html += "<label>Min. odstęp (s):</label>";
+            html += "<input type=\"number\" id=\"whMin" + idx + "\" value=\"" + String(active ? target.minInterval / 1000 : 0) + "\" min=\"0\" max=\"3600\">";
+            html += "</div>";
+            html += "<textarea id=\"whTpl" + idx + "\" rows=\"3\" style=\"width:100%;background:#303030;color:white;border:none;border-radius:4px;padding:8px;\">";
+            html += active ? target.payloadTemplate.source() : String(DEFAULT_WEBHOOK_TEMPLATE);
+            html += "</textarea>";
+        }
+        html += "<div class=\"setting-row\">";
+        html += "<label>Utrzymuj połączenie (keep-alive):</label>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"webhookKeepAlive\" " + String(webhookKeepAlive ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
         html += "<button class=\"btn\" onclick=\"setWebhook()\">Zapisz</button>";
         html += "</div>";
 
+        // Distance sensor profile
+        html += "<div class=\"card\">";
+        html += "<h3>Czujnik odległości</h3>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Profil:</label>";
+        html += "<select id=\"rngProfile\">";
+        const char* profileLabels[RANGING_PROFILE_COUNT] = { "Szybki (20 ms)", "Zrównoważony (33 ms)", "Dokładny (200 ms)" };
+        for (uint8_t i = 0; i < RANGING_PROFILE_COUNT; i++) {
+            html += "<option value=\"" + String(RANGING_PROFILES[i].name) + "\"" + String(rangingProfile == i ? " selected" : "") + ">" + profileLabels[i] + "</option>";
+        }
+        html += "</select>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Min. sygnał (MCPS):</label>";
+        html += "<input type=\"number\" id=\"rngSignal\" value=\"" + String(signalRateLimit, 2) + "\" step=\"0.01\" min=\"0.01\" max=\"10\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Maks. sigma (mm):</label>";
+        html += "<input type=\"number\" id=\"rngSigma\" value=\"" + String(sigmaLimit, 1) + "\" step=\"1\" min=\"1\" max=\"100\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Próbkowanie adaptacyjne:</label>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"rngAdaptive\" " + String(adaptiveSampling ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Filtr medianowy:</label>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"fltMedian\" " + String(rangeFilterConfig.medianEnabled ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Filtr Kalmana:</label>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"fltKalman\" " + String(rangeFilterConfig.kalmanEnabled ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Bramka sygnału (MCPS):</label>";
+        html += "<input type=\"number\" id=\"fltMinSig\" value=\"" + String(rangeFilterConfig.minSignalRate, 2) + "\" step=\"0.05\" min=\"0\" max=\"50\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Maks. światło otoczenia (MCPS):</label>";
+        html += "<input type=\"number\" id=\"fltMaxAmb\" value=\"" + String(rangeFilterConfig.maxAmbientRate, 2) + "\" step=\"0.1\" min=\"0.1\" max=\"100\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Gesty surowe / po filtrze:</label>";
+        html += "<span id=\"fltStats\">-</span>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Próbkowanie / szum:</label>";
+        html += "<span id=\"rngStats\">-</span>";
+        html += "</div>";
+        html += "<button class=\"btn\" onclick=\"saveSensor()\">Zapisz</button>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Zapis próbek:</label>";
+        html += "<select id=\"capMode\">";
+        html += "<option value=\"continuous\">Ciągły</option>";
+        html += "<option value=\"trigger\">Wokół gestu</option>";
+        html += "<option value=\"off\">Stop</option>";
+        html += "</select>";
+        html += "<select id=\"capLabel\">";
+        html += "<option value=\"\">Bez etykiety</option>";
+        html += "<option value=\"tap\">Trening: tap</option>";
+        html += "<option value=\"approach\">Trening: zbliżenie</option>";
+        html += "<option value=\"retreat\">Trening: oddalenie</option>";
+        html += "<option value=\"negative\">Trening: nie-gest</option>";
+        html += "</select>";
+        html += "<span id=\"capStatus\">-</span>";
+        html += "</div>";
+        html += "<button class=\"btn\" onclick=\"setCapture()\">Start / stop</button>";
+        html += "<button class=\"btn btn-off\" onclick=\"window.location.href='/capture?format=csv'\">Pobierz CSV</button>";
+        html += "<button class=\"btn btn-off\" onclick=\"window.location.href='/capture?format=bin'\">Pobierz BIN</button>";
+        html += "</div>";
+
+        // MQTT / Home Assistant
+        html += "<div class=\"card\">";
+        html += "<div class=\"setting-row\">";
+        html += "<h3>MQTT</h3>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"mqttEnabled\" " + String(mqttEnabled ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Broker:</label>";
+        html += "<input type=\"text\" id=\"mqttHost\" value=\"" + mqttHost + "\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Port:</label>";
+        html += "<input type=\"number\" id=\"mqttPort\" value=\"" + String(mqttPort) + "\" min=\"1\" max=\"65535\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Użytkownik:</label>";
+        html += "<input type=\"text\" id=\"mqttUser\" value=\"" + mqttUser + "\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Hasło:</label>";
+        html += "<input type=\"password\" id=\"mqttPassword\" placeholder=\"bez zmian\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Temat bazowy:</label>";
+        html += "<input type=\"text\" id=\"mqttBase\" value=\"" + mqttBaseTopic + "\">";
+        html += "</div>";
+        html += "<button class=\"btn\" onclick=\"saveMqtt()\">Zapisz</button>";
+        html += "</div>";
+
+        // Periodic reporting and telemetry batching
+        html += "<div class=\"card\">";
+        html += "<h3>Raporty okresowe</h3>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Heartbeat (s):</label>";
+        html += "<input type=\"number\" id=\"hbInterval\" value=\"" + String(heartbeatInterval / 1000) + "\" min=\"1\" max=\"86400\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Strefa martwa temperatury (°C, 0 = wył.):</label>";
+        html += "<input type=\"number\" id=\"tempDeadband\" value=\"" + String(tempDeadband) + "\" step=\"0.1\" min=\"0\" max=\"10\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Strefa martwa wilgotności (%, 0 = wył.):</label>";
+        html += "<input type=\"number\" id=\"humDeadband\" value=\"" + String(humDeadband) + "\" step=\"0.1\" min=\"0\" max=\"50\">";
+        html += "</div>";
+        html += "<div class=\"separator\"></div>";
+        html += "<div class=\"setting-row\">";
+        html += "<h3>Telemetria w paczkach</h3>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"tlmEnabled\" " + String(telemetryBatchEnabled ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Próbkowanie (s):</label>";
+        html += "<input type=\"number\" id=\"tlmSample\" value=\"" + String(telemetrySampleInterval / 1000) + "\" min=\"1\" max=\"600\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Próbek w paczce:</label>";
+        html += "<input type=\"number\" id=\"tlmSize\" value=\"" + String(telemetryBatchSize) + "\" min=\"1\" max=\"" + String(MAX_TELEMETRY_BATCH) + "\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>Maks. wiek paczki (s):</label>";
+        html += "<input type=\"number\" id=\"tlmAge\" value=\"" + String(telemetryBatchMaxAge / 1000) + "\" min=\"1\" max=\"3600\">";
+        html += "</div>";
+        html += "<div class=\"setting-row\">";
+        html += "<label>NDJSON:</label>";
+        html += "<label class=\"switch\"><input type=\"checkbox\" id=\"tlmNdjson\" " + String(telemetryNdjson ? "checked" : "") + "><span class=\"slider\"></span></label>";
+        html += "</div>";
+        html += "<button class=\"btn\" onclick=\"saveTelemetry()\">Zapisz</button>";
+        html += "</div>";
+
         // Network Settings section
         html += "<div class=\"card\">";
         html += "<div class=\"setting-row\">";
@@ -487,10 +906,21 @@ void setupWebServer() {
         html += "  bars.forEach((bar, index) => {";
         html += "    bar.classList.toggle('active', data.currentSpeed > index);";
         html += "  });";
-        html += "  document.getElementById('temperature').innerText = data.temperature.toFixed(1) + ' °C';";
-        html += "  document.getElementById('humidity').innerText = data.humidity.toFixed(1) + ' %';";
+        html += "  const env = data.envSensor !== false;";
+        html += "  document.getElementById('temperature').innerText = env ? data.temperature.toFixed(1) + ' °C' : 'brak czujnika';";
+        html += "  document.getElementById('humidity').innerText = env ? data.humidity.toFixed(1) + ' %' : 'brak czujnika';";
+        html += "  document.getElementById('pressure').innerText = env ? data.pressure.toFixed(1) + ' hPa' : 'brak czujnika';";
+        html += "  document.getElementById('absHumidity').innerText = env ? data.absHumidity.toFixed(2) + ' g/m³' : 'brak czujnika';";
+        html += "  document.getElementById('dewPoint').innerText = env ? data.dewPoint.toFixed(1) + ' °C' : 'brak czujnika';";
+        html += "  const room = data.roomTemperature !== undefined;";
+        html += "  document.getElementById('roomRow').style.display = room ? '' : 'none';";
+        html += "  document.getElementById('diffRow').style.display = room ? '' : 'none';";
+        html += "  if (room) {";
+        html += "    document.getElementById('room').innerText = data.roomTemperature.toFixed(1) + ' °C, ' + data.roomHumidity.toFixed(1) + ' %';";
+        html += "    document.getElementById('diff').innerText = data.diffTemperature.toFixed(1) + ' °C, ' + data.diffAbsHumidity.toFixed(2) + ' g/m³';";
+        html += "  }";
         html += "  document.getElementById('gestureControl').checked = data.gestureControlEnabled;";
-        html += "  document.getElementById('distance').innerText = data.distance >= 0 ? data.distance : '--';";
+        html += "  document.getElementById('distance').innerText = data.gestureSensor === false ? 'brak czujnika' : (data.distance >= 0 ? data.distance : '--');";
         html += "};";
         html += "function setSpeed(speed) {";
         html += "  fetch('/state', {";
@@ -508,11 +938,151 @@ void setupWebServer() {
         html += "  });";
         html += "}";
         html += "function setWebhook() {";
-        html += "  const url = document.getElementById('webhookUrl').value;";
+        html += "  const targets = [];";
+        html += "  for (let i = 0; i < " + String(MAX_WEBHOOK_TARGETS) + "; i++) {";
+        html += "    const url = document.getElementById('whUrl' + i).value.trim();";
+        html += "    if (!url) continue;";
+        html += "    const causes = [];";
+        html += "    ['API', 'GESTURE', 'AUTO', 'PERIODIC', 'MQTT'].forEach((c, n) => {";
+        html += "      if (document.getElementById('whCause' + i + '_' + n).checked) causes.push(c);";
+        html += "    });";
+        html += "    targets.push({";
+        html += "      url: url,";
+        html += "      causes: causes,";
+        html += "      minInterval: parseInt(document.getElementById('whMin' + i).value || '0') * 1000,";
+        html += "      template: document.getElementById('whTpl' + i).value";
+        html += "    });";
+        html += "  }";
+        html += "  const keepAlive = document.getElementById('webhookKeepAlive').checked;";
         html += "  fetch('/webhook', {";
         html += "    method: 'POST',";
         html += "    headers: { 'Content-Type': 'application/json' },";
-        html += "    body: JSON.stringify({ url: url })";
+        html += "    body: JSON.stringify({ targets: targets, keepAlive: keepAlive })";
+        html += "  }).then(response => {";
+        html += "    if (!response.ok) alert('Niepoprawny szablon webhooka');";
+        html += "  });";
+        html += "}";
+        html += "function saveSensor() {";
+        html += "  fetch('/sensor', {";
+        html += "    method: 'POST',";
+        html += "    headers: { 'Content-Type': 'application/json' },";
+        html += "    body: JSON.stringify({";
+        html += "      profile: document.getElementById('rngProfile').value,";
+        html += "      signalRate: parseFloat(document.getElementById('rngSignal').value),";
+        html += "      sigma: parseFloat(document.getElementById('rngSigma').value),";
+        html += "      adaptive: document.getElementById('rngAdaptive').checked,";
+        html += "      filter: {";
+        html += "        median: document.getElementById('fltMedian').checked,";
+        html += "        kalman: document.getElementById('fltKalman').checked,";
+        html += "        minSignal: parseFloat(document.getElementById('fltMinSig').value),";
+        html += "        maxAmbient: parseFloat(document.getElementById('fltMaxAmb').value)";
+        html += "      }";
+        html += "    })";
+        html += "  }).then(response => {";
+        html += "    if (!response.ok) alert('Niepoprawne ustawienia czujnika');";
+        html += "  });";
+        html += "}";
+        html += "function loadSensorStats() {";
+        html += "  fetch('/sensor').then(r => r.json()).then(data => {";
+        html += "    let text = data.sampleRate.toFixed(1) + ' Hz';";
+        html += "    if (data.noise) text += ', σ ' + data.noise.stddev.toFixed(1) + ' mm @ ' + data.noise.mean.toFixed(0) + ' mm';";
+        html += "    document.getElementById('rngStats').textContent = text;";
+        html += "    const f = data.filter;";
+        html += "    document.getElementById('fltStats').textContent = f.gestures.raw + ' / ' + f.gestures.filtered +";
+        html += "      ' (odrzucone: sygnał ' + f.stats.gatedSignal + ', otoczenie ' + f.stats.gatedAmbient + ', skoki ' + f.stats.spikes + ')';";
+        html += "  });";
+        html += "}";
+        html += "function saveEnvSensor() {";
+        html += "  fetch('/envSensor', {";
+        html += "    method: 'POST',";
+        html += "    headers: { 'Content-Type': 'application/json' },";
+        html += "    body: JSON.stringify({ preset: document.getElementById('bmePreset').value })";
+        html += "  });";
+        html += "}";
+        html += "function loadCaptureStatus() {";
+        html += "  fetch('/api/capture').then(r => r.json()).then(data => {";
+        html += "    document.getElementById('capStatus').textContent = data.mode + ', ' + data.samples + ' próbek' + (data.triggered ? ' (gest)' : '');";
+        html += "  });";
+        html += "}";
+        html += "function setCapture() {";
+        html += "  fetch('/api/capture', {";
+        html += "    method: 'POST',";
+        html += "    headers: { 'Content-Type': 'application/json' },";
+        html += "    body: JSON.stringify({";
+        html += "      mode: document.getElementById('capMode').value,";
+        html += "      label: document.getElementById('capLabel').value";
+        html += "    })";
+        html += "  }).then(loadCaptureStatus);";
+        html += "}";
+        html += "loadCaptureStatus();";
+        html += "setInterval(loadCaptureStatus, 5000);";
+        html += "loadSensorStats();";
+        html += "setInterval(loadSensorStats, 5000);";
+        html += "function saveMqtt() {";
+        html += "  const data = {";
+        html += "    enabled: document.getElementById('mqttEnabled').checked,";
+        html += "    host: document.getElementById('mqttHost').value,";
+        html += "    port: parseInt(document.getElementById('mqttPort').value),";
+        html += "    user: document.getElementById('mqttUser').value,";
+        html += "    baseTopic: document.getElementById('mqttBase').value";
+        html += "  };";
+        html += "  const password = document.getElementById('mqttPassword').value;";
+        html += "  if (password) data.password = password;";
+        html += "  fetch('/mqtt', {";
+        html += "    method: 'POST',";
+        html += "    headers: { 'Content-Type': 'application/json' },";
+        html += "    body: JSON.stringify(data)";
+        html += "  });";
+        html += "}";
+        html += "function saveTelemetry() {";
+        html += "  const data = {";
+        html += "    enabled: document.getElementById('tlmEnabled').checked,";
+        html += "    sampleInterval: parseInt(document.getElementById('tlmSample').value) * 1000,";
+        html += "    batchSize: parseInt(document.getElementById('tlmSize').value),";
+        html += "    maxAge: parseInt(document.getElementById('tlmAge').value) * 1000,";
+        html += "    format: document.getElementById('tlmNdjson').checked ? 'ndjson' : 'json',";
+        html += "    heartbeatInterval: parseInt(document.getElementById('hbInterval').value) * 1000,";
+        html += "    tempDeadband: parseFloat(document.getElementById('tempDeadband').value),";
+        html += "    humDeadband: parseFloat(document.getElementById('humDeadband').value)";
+        html += "  };";
+        html += "  fetch('/telemetry', {";
+        html += "    method: 'POST',";
+        html += "    headers: { 'Content-Type': 'application/json' },";
+        html += "    body: JSON.stringify(data)";
+        html += "  });";
+        html += "}";
+        html += "function saveGestureSettings() {";
+        html += "  const data = {";
+        html += "    minDistance: parseInt(document.getElementById('gWinMin').value),";
+        html += "    maxDistance: parseInt(document.getElementById('gWinMax').value),";
+        html += "    tapMaxMs: parseInt(document.getElementById('gTapMax').value),";
+        html += "    doubleTapWindowMs: parseInt(document.getElementById('gDblTap').value),";
+        html += "    swipeMinTravel: parseInt(document.getElementById('gSwipeMin').value),";
+        html += "    sliderHoldMs: parseInt(document.getElementById('gSliderHold').value),";
+        html += "    classifierEnabled: document.getElementById('gClassifier').checked,";
+        html += "    autoCalibration: document.getElementById('gCalAuto').checked";
+        html += "  };";
+        html += "  fetch('/gestureSettings', {";
+        html += "    method: 'POST',";
+        html += "    headers: { 'Content-Type': 'application/json' },";
+        html += "    body: JSON.stringify(data)";
+        html += "  }).then(response => {";
+        html += "    if (!response.ok) alert('Niepoprawne progi gestów');";
+        html += "  });";
+        html += "}";
+        html += "function calibrateGesture() {";
+        html += "  fetch('/calibrateGesture', { method: 'POST' }).then(() => {";
+        html += "    document.getElementById('gCalStatus').textContent = 'kalibracja...';";
+        html += "    setTimeout(loadCalibration, 32000);";
+        html += "  });";
+        html += "}";
+        html += "function loadCalibration() {";
+        html += "  fetch('/gestureSettings').then(r => r.json()).then(data => {";
+        html += "    const c = data.calibration;";
+        html += "    let text = c.baseline >= 0 ? c.baseline + ' mm' : 'brak celu';";
+        html += "    if (c.last && !c.last.valid) text += ' (ostatnia kalibracja nieudana)';";
+        html += "    if (data.maxDistance < data.userMaxDistance) text += ', okno do ' + data.maxDistance + ' mm';";
+        html += "    document.getElementById('gCalStatus').textContent = text;";
         html += "  });";
         html += "}";
         html += "function toggleGestureControl() {";
@@ -527,8 +1097,10 @@ void setupWebServer() {
         html += "  const data = {";
         html += "    enabled: document.getElementById('autoActivation').checked,";
         html += "    tempThreshold: parseFloat(document.getElementById('tempThreshold').value),";
-        html += "    humThreshold: parseFloat(document.getElementById('humThreshold').value),";
-        html += "    interval: parseInt(document.getElementById('checkInterval').value) * 1000";
+        html += "    ahThreshold: parseFloat(document.getElementById('ahThreshold').value),";
+        html += "    interval: parseInt(document.getElementById('checkInterval').value) * 1000,";
+        html += "    diffTempThreshold: parseFloat(document.getElementById('diffTempThreshold').value),";
+        html += "    diffAhThreshold: parseFloat(document.getElementById('diffAhThreshold').value)";
         html += "  };";
         html += "  fetch('/autoSettings', {";
         html += "    method: 'POST',";
@@ -570,67 +1142,96 @@ void setupWebServer() {
     });
 
     server.on("/state", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /state");
+        RequestTiming timing(ROUTE_STATE);
         String body = String((char *)data).substring(0, len);
         StaticJsonDocument<200> doc;  // Use StaticJsonDocument
         deserializeJson(doc, body);
+        timing.mark(TIMING_PARSE);
         int speed = doc["speed"];
-        addLog("API", currentSpeed, speed);
-        setFanSpeed(speed);
-        currentSpeed = speed;
-        sendWebhookRequest(currentSpeed, "API", currentSpeed);
-        notifyClients();
-        request->send(200);
+        bool valid = speed >= 0 && speed <= 4;
+        timing.mark(TIMING_VALIDATE);
+        if (!valid) {
+            timing.send(request, 400, "application/json", "{\"error\":\"Invalid speed\"}");
+            return;
+        }
+        applySpeedCommand(speed, "API", &timing);
+        timing.send(request, 200);
     });
 
     // Obsługa ustawiania domyślnego biegu
     server.on("/default", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /default");
+        RequestTiming timing(ROUTE_DEFAULT);
         String body = String((char *)data).substring(0, len);
         StaticJsonDocument<200> doc;  // Use StaticJsonDocument
         deserializeJson(doc, body);
+        timing.mark(TIMING_PARSE);
         int speed = doc["default"];
-        if (speed < 0 || speed > 4) {
-            request->send(400, "application/json", "{\"error\":\"Invalid speed\"}");
+        bool valid = speed >= 0 && speed <= 4;
+        timing.mark(TIMING_VALIDATE);
+        if (!valid) {
+            timing.send(request, 400, "application/json", "{\"error\":\"Invalid speed\"}");
             return;
         }
         defaultSpeed = speed;
+        timing.mark(TIMING_APPLY);
         preferences.putInt("defaultSpeed", defaultSpeed); // Zapisanie w pamięci
+        timing.mark(TIMING_PERSIST);
         Serial.printf("Ustawiono domyślny bieg na: %d\n", defaultSpeed);
-        request->send(200);
+        timing.send(request, 200);
     });
 
     server.on("/gesture", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /gesture");
+        RequestTiming timing(ROUTE_GESTURE);
         String body = String((char *)data).substring(0, len);
         StaticJsonDocument<200> doc;  // Use StaticJsonDocument
         deserializeJson(doc, body);
+        timing.mark(TIMING_PARSE);
         gestureControlEnabled = doc["enabled"];
+        timing.mark(TIMING_APPLY);
         preferences.putBool("gestureEnabled", gestureControlEnabled);  // Add this line
+        timing.mark(TIMING_PERSIST);
         notifyClients();  // Add this line
-        request->send(200);
+        timing.mark(TIMING_NOTIFY);
+        timing.send(request, 200);
     });
 
     server.on("/autoSettings", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, 
         [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            TRACE_SCOPE("HTTP POST /autoSettings");
+            RequestTiming timing(ROUTE_AUTO_SETTINGS);
             String body = String((char *)data).substring(0, len);
             StaticJsonDocument<200> doc;  // Use StaticJsonDocument
             deserializeJson(doc, body);
+            timing.mark(TIMING_PARSE);
             
             autoActivationEnabled = doc["enabled"];
             tempRiseThreshold = doc["tempThreshold"];
-            humRiseThreshold = doc["humThreshold"];
+            ahRiseThreshold = doc["ahThreshold"] | ahRiseThreshold;
             monitoringInterval = doc["interval"];
+            diffTempThreshold = doc["diffTempThreshold"] | diffTempThreshold;
+            diffAhThreshold = doc["diffAhThreshold"] | diffAhThreshold;
+            timing.mark(TIMING_APPLY);
 
             preferences.putBool("autoActivation", autoActivationEnabled);
             preferences.putFloat("tempThreshold", tempRiseThreshold);
-            preferences.putFloat("humThreshold", humRiseThreshold);
+            preferences.putFloat("ahThreshold", ahRiseThreshold);
             preferences.putULong("monitorInterval", monitoringInterval);
+            preferences.putFloat("diffTemp", diffTempThreshold);
+            preferences.putFloat("diffAh", diffAhThreshold);
+            timing.mark(TIMING_PERSIST);
 
             notifyClients();
-            request->send(200);
+            timing.mark(TIMING_NOTIFY);
+            timing.send(request, 200);
     });
 
     // Update the network settings endpoint
     server.on("/network", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, 
         [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            TRACE_SCOPE("HTTP POST /network");
             String body = String((char *)data).substring(0, len);
             StaticJsonDocument<200> doc;
             deserializeJson(doc, body);
@@ -677,8 +1278,190 @@ void setupWebServer() {
             ESP.restart();
     });
 
+    // Metryki w formacie Prometheus - odpowiedź generowana w kawałkach
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /metrics");
+        std::shared_ptr<MetricsStream> stream(new MetricsStream(ws.count()));
+        AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain; version=0.0.4",
+            [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return stream->read(buffer, maxLen);
+            });
+        request->send(response);
+    });
+
+    // Diagnostyka: sterta, stosy zadań, CPU, przyczyna resetu i historia migawek (w kawałkach)
+    server.on("/api/diag", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /api/diag");
+        std::shared_ptr<DiagStream> stream(new DiagStream());
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return stream->read(buffer, maxLen);
+            });
+        request->send(response);
+    });
+
+    // Stan magistrali I2C: obciążenie, transakcje i błędy każdego urządzenia
+    server.on("/api/i2c", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /api/i2c");
+        StaticJsonDocument<1024> doc;
+        fillI2cBusStatus(doc.to<JsonObject>());
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Histogramy etapów obsługi żądań API (te same czasy co w nagłówku Server-Timing, w kawałkach)
+    server.on("/api/timing", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /api/timing");
+        std::shared_ptr<TimingStream> stream(new TimingStream());
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return stream->read(buffer, maxLen);
+            });
+        request->send(response);
+    });
+
+    // Percentyle opóźnień gest -> przekaźnik -> WebSocket
+    server.on("/api/latency", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /api/latency");
+        StaticJsonDocument<LATENCY_REPORT_SIZE> doc;
+        fillLatencyReport(doc.to<JsonObject>());
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        serializeJson(doc, *response);
+        request->send(response);
+    });
+
+#if TRACE_ENABLED
+    // Zapis zdarzeń w formacie Chrome trace_event (do otwarcia w Perfetto)
+    server.on("/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+        std::shared_ptr<TraceStream> stream(new TraceStream());
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return stream->read(buffer, maxLen);
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=okap-trace.json");
+        request->send(response);
+    });
+#endif
+
+    // Surowe próbki czujnika odległości do odtwarzania na komputerze (format w capture.h)
+    server.on("/capture", HTTP_GET, [](AsyncWebServerRequest *request) {
+        bool binary = request->hasParam("format") && request->getParam("format")->value() == "bin";
+        std::shared_ptr<CaptureStream> stream(new CaptureStream(binary));
+        AsyncWebServerResponse *response = request->beginChunkedResponse(
+            binary ? "application/octet-stream" : "text/csv",
+            [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return stream->read(buffer, maxLen);
+            });
+        response->addHeader("Content-Disposition", binary ? "attachment; filename=okap-capture.bin"
+                                                          : "attachment; filename=okap-capture.csv");
+        request->send(response);
+    });
+
+    server.on("/api/capture", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /api/capture");
+        StaticJsonDocument<256> doc;
+        fillCaptureStatus(doc.to<JsonObject>());
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // {"mode":"off|continuous|trigger","label":"tap|approach|retreat|negative"}
+    // Start czyści poprzedni zapis; etykieta oznacza nagranie treningowe klasyfikatora.
+    server.on("/api/capture", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /api/capture");
+        String body = String((char *)data).substring(0, len);
+        StaticJsonDocument<96> doc;
+        DeserializationError error = deserializeJson(doc, body);
+
+        if (error) {
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        int mode = captureModeFromString(doc["mode"] | "");
+        if (mode < 0) {
+            request->send(400, "application/json", "{\"error\":\"Invalid mode\"}");
+            return;
+        }
+
+        int label = captureLabelFromString(doc["label"] | "");
+        if (label < 0) {
+            request->send(400, "application/json", "{\"error\":\"Invalid label\"}");
+            return;
+        }
+
+        if (mode == CAPTURE_OFF) {
+            captureStop();
+        } else {
+            captureStart((CaptureMode)mode, label);
+        }
+        request->send(200);
+    });
+
+    // BME280: preset próbkowania i ostatni odczyt
+    server.on("/envSensor", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /envSensor");
+        StaticJsonDocument<768> doc;
+        doc["online"] = i2cDeviceOnline(I2C_DEV_BME280);
+        doc["preset"] = BME_PRESETS[bme.preset()].name;
+        JsonObject room = doc.createNestedObject("room");
+        room["online"] = i2cDeviceOnline(I2C_DEV_BME280_ROOM);
+        if (i2cDeviceOnline(I2C_DEV_BME280_ROOM)) {
+            room["temperature"] = roomTemperature;
+            room["humidity"] = roomHumidity;
+            room["pressure"] = roomPressure;
+            JsonObject differential = doc.createNestedObject("differential");
+            differential["active"] = diffDetector.active();
+            differential["temperature"] = diffDetector.deltaTemperature();
+            differential["absHumidity"] = diffDetector.deltaAbsHumidity();
+            differential["baselineTemperature"] = diffDetector.baselineTemperature();
+            differential["baselineAbsHumidity"] = diffDetector.baselineAbsHumidity();
+            differential["tempThreshold"] = diffTempThreshold;
+            differential["ahThreshold"] = diffAhThreshold;
+        }
+        doc["forced"] = bme.forced();
+        JsonArray presets = doc.createNestedArray("presets");
+        for (uint8_t i = 0; i < BME_PRESET_COUNT; i++) {
+            presets.add(BME_PRESETS[i].name);
+        }
+        doc["temperature"] = temperature;
+        doc["humidity"] = humidity;
+        doc["pressure"] = pressure;
+        doc["absHumidity"] = absHumidity;
+        doc["dewPoint"] = dewPoint;
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // {"preset":"weather|smooth|precise|continuous"}
+    server.on("/envSensor", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /envSensor");
+        String body = String((char *)data).substring(0, len);
+        StaticJsonDocument<96> doc;
+        DeserializationError error = deserializeJson(doc, body);
+
+        if (error) {
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        int preset = bmePresetFromString(doc["preset"] | "");
+        if (preset < 0) {
+            request->send(400, "application/json", "{\"error\":\"Invalid preset\"}");
+            return;
+        }
+
+        preferences.putUChar("bmePreset", preset);
+        pendingBmePreset = preset;
+        request->send(200);
+    });
+
     // Add logs endpoint
     server.on("/logs", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /logs");
         String html = "<!DOCTYPE html><html><head>";
         html += "<meta charset='UTF-8'>";
         html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
@@ -734,26 +1517,499 @@ void setupWebServer() {
 
     // Add clear logs endpoint
     server.on("/clearlogs", HTTP_POST, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP POST /clearlogs");
         speedLogs.clear();
         request->send(200);
     });
 
-    // Modify the webhook endpoint handler
+    // Webhook targets: {"targets":[{"url","causes":[...],"minInterval","template"}],"keepAlive"}
+    // Starszy format {"url": "..."} ustawia pojedynczy cel ze wszystkimi przyczynami.
     server.on("/webhook", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /webhook");
+        if (index + len != total) {
+            return;  // Obsługujemy tylko ciało w jednym kawałku
+        }
+        RequestTiming timing(ROUTE_WEBHOOK);
+        DynamicJsonDocument doc(4096);
+        DeserializationError error = deserializeJson(doc, (const char *)data, len);
+        timing.mark(TIMING_PARSE);
+        
+        if (error) {
+            timing.send(request, 400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        if (doc.containsKey("keepAlive")) {
+            webhookKeepAlive = doc["keepAlive"];
+        }
+
+        if (doc.containsKey("url")) {
+            String url = doc["url"].as<String>();
+            configureWebhookTarget(0, url, CAUSE_MASK_ALL, 0, DEFAULT_WEBHOOK_TEMPLATE);
+            setWebhookTargetCount(url.isEmpty() ? 0 : 1);
+        } else if (doc.containsKey("targets")) {
+            JsonArray targets = doc["targets"];
+            bool valid = targets.size() <= MAX_WEBHOOK_TARGETS;
+            timing.mark(TIMING_VALIDATE);
+            if (!valid) {
+                timing.send(request, 400, "application/json", "{\"error\":\"Too many targets\"}");
+                return;
+            }
+
+            // Najpierw cała lista - błąd w dowolnym celu nie zmienia działającej konfiguracji
+            struct ParsedTarget {
+                String url;
+                uint8_t mask;
+                unsigned long minInterval;
+                String templateSource;
+            };
+            ParsedTarget parsed[MAX_WEBHOOK_TARGETS];
+            int count = 0;
+            for (JsonObject target : targets) {
+                ParsedTarget& entry = parsed[count];
+                entry.mask = 0;
+                if (target.containsKey("causes")) {
+                    for (JsonVariant cause : target["causes"].as<JsonArray>()) {
+                        int causeIndex = webhookCauseFromString(cause.as<String>());
+                        if (causeIndex >= 0) {
+                            entry.mask |= 1 << causeIndex;
+                        }
+                    }
+                } else {
+                    entry.mask = CAUSE_MASK_ALL;
+                }
+                entry.url = target["url"] | "";
+                entry.minInterval = target["minInterval"] | 0UL;
+                entry.templateSource = target["template"] | "";
+
+                if (!validateWebhookTarget(entry.url, entry.templateSource)) {
+                    timing.send(request, 400, "application/json", "{\"error\":\"Invalid URL or template\"}");
+                    return;
+                }
+                count++;
+            }
+
+            for (int i = 0; i < count; i++) {
+                configureWebhookTarget(i, parsed[i].url, parsed[i].mask, parsed[i].minInterval, parsed[i].templateSource);
+            }
+            setWebhookTargetCount(count);
+        }
+
+        timing.mark(TIMING_APPLY);
+
+        saveWebhookTargets();
+        if (doc.containsKey("keepAlive")) {
+            preferences.putBool("webhookReuse", webhookKeepAlive);
+        }
+        timing.mark(TIMING_PERSIST);
+        Serial.printf("Zapisano webhooki: %d\n", webhookTargetCount);
+        timing.send(request, 200);
+    });
+
+    // Konfiguracja i statystyki celów webhooka (opóźnienia połączeń nowych i keep-alive)
+    server.on("/webhook", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /webhook");
+        DynamicJsonDocument doc(4096);
+        doc["keepAlive"] = webhookKeepAlive;
+        JsonArray targets = doc.createNestedArray("targets");
+
+        for (int i = 0; i < webhookTargetCount; i++) {
+            WebhookTarget& target = webhookTargets[i];
+            JsonObject entry = targets.createNestedObject();
+            entry["url"] = target.url;
+            JsonArray causes = entry.createNestedArray("causes");
+            for (int c = 0; c < CAUSE_COUNT; c++) {
+                if (target.causeMask & (1 << c)) {
+                    causes.add(webhookCauseName(c));
+                }
+            }
+            entry["minInterval"] = target.minInterval;
+            entry["template"] = target.payloadTemplate.source();
+            entry["queued"] = target.queue ? uxQueueMessagesWaiting(target.queue) : 0;
+            entry["delivered"] = target.delivered;
+            entry["failed"] = target.failed;
+            entry["dropped"] = target.dropped;
+            entry["throttled"] = target.throttled;
+            entry["outboxRecords"] = target.outbox.count();
+            entry["outboxBytes"] = target.outbox.pendingBytes();
+            entry["outboxOverflow"] = target.outbox.droppedOverflow;
+            entry["outboxCorrupted"] = target.outbox.corrupted;
+            entry["outboxOversize"] = target.outbox.rejectedOversize;
+            entry["dnsLookups"] = target.connection.dnsLookups;
+            entry["reconnects"] = target.connection.reconnects;
+
+            JsonObject reused = entry.createNestedObject("reused");
+            reused["count"] = target.connection.reusedStats.count;
+            reused["avgMs"] = target.connection.reusedStats.averageMs();
+            reused["maxMs"] = target.connection.reusedStats.maxMs;
+            reused["lastMs"] = target.connection.reusedStats.lastMs;
+
+            JsonObject fresh = entry.createNestedObject("fresh");
+            fresh["count"] = target.connection.freshStats.count;
+            fresh["avgMs"] = target.connection.freshStats.averageMs();
+            fresh["maxMs"] = target.connection.freshStats.maxMs;
+            fresh["lastMs"] = target.connection.freshStats.lastMs;
+        }
+
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/mqtt", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /mqtt");
+        StaticJsonDocument<256> doc;
+        doc["enabled"] = mqttEnabled;
+        doc["host"] = mqttHost;
+        doc["port"] = mqttPort;
+        doc["user"] = mqttUser;
+        doc["baseTopic"] = mqttBaseTopic;
+        doc["connected"] = mqttConnected();
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Progi silnika gestów
+    server.on("/gestureSettings", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /gestureSettings");
+        StaticJsonDocument<768> doc;
+        doc["minDistance"] = gestureConfig.minDistance;
+        doc["maxDistance"] = gestureConfig.maxDistance;
+        doc["userMaxDistance"] = userMaxDistance;
+        doc["tapMaxMs"] = gestureConfig.tapMaxMs;
+        doc["doubleTapWindowMs"] = gestureConfig.doubleTapWindowMs;
+        doc["swipeMaxMs"] = gestureConfig.swipeMaxMs;
+        doc["swipeMinTravel"] = gestureConfig.swipeMinTravel;
+        doc["sliderHoldMs"] = gestureConfig.sliderHoldMs;
+        doc["sliderStillMm"] = gestureConfig.sliderStillMm;
+        doc["sliderHysteresisMm"] = gestureConfig.sliderHysteresisMm;
+        doc["classifierEnabled"] = gestureConfig.classifierEnabled;
+        doc["minConfidence"] = gestureConfig.minConfidence;
+        doc["lateralGapMs"] = gestureConfig.lateralGapMs;
+        doc["lateralMinGapMs"] = gestureConfig.lateralMinGapMs;
+        doc["lateralWaitMs"] = gestureConfig.lateralWaitMs;
+        doc["autoCalibration"] = autoCalibration;
+
+        JsonObject calibration = doc.createNestedObject("calibration");
+        calibration["active"] = calibrationActive();
+        calibration["elapsedMs"] = calibrationElapsed();
+        calibration["baseline"] = calibrationBaseline;
+        const CalibrationResult& result = lastCalibrationResult();
+        if (result.samples) {
+            JsonObject last = calibration.createNestedObject("last");
+            last["valid"] = result.valid;
+            last["stable"] = result.stable;
+            last["baseline"] = result.baseline;
+            last["median"] = result.median;
+            last["samples"] = result.samples;
+            last["maxDistance"] = min(result.maxDistance, userMaxDistance);
+        }
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Pola jak w GET; pominięte pozostają bez zmian
+    server.on("/gestureSettings", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /gestureSettings");
+        String body = String((char *)data).substring(0, len);
+        StaticJsonDocument<768> doc;
+        DeserializationError error = deserializeJson(doc, body);
+
+        if (error) {
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        GestureConfig config = gestureConfig;
+        config.minDistance = doc["minDistance"] | config.minDistance;
+        config.maxDistance = doc["maxDistance"] | config.maxDistance;
+        config.tapMaxMs = doc["tapMaxMs"] | config.tapMaxMs;
+        config.doubleTapWindowMs = doc["doubleTapWindowMs"] | config.doubleTapWindowMs;
+        config.swipeMaxMs = doc["swipeMaxMs"] | config.swipeMaxMs;
+        config.swipeMinTravel = doc["swipeMinTravel"] | config.swipeMinTravel;
+        config.sliderHoldMs = doc["sliderHoldMs"] | config.sliderHoldMs;
+        config.sliderStillMm = doc["sliderStillMm"] | config.sliderStillMm;
+        config.sliderHysteresisMm = doc["sliderHysteresisMm"] | config.sliderHysteresisMm;
+        config.classifierEnabled = doc["classifierEnabled"] | config.classifierEnabled;
+        config.minConfidence = doc["minConfidence"] | config.minConfidence;
+        config.lateralGapMs = doc["lateralGapMs"] | config.lateralGapMs;
+        config.lateralMinGapMs = doc["lateralMinGapMs"] | config.lateralMinGapMs;
+        config.lateralWaitMs = doc["lateralWaitMs"] | config.lateralWaitMs;
+
+        // Okno musi mieć co najmniej 4 pasma po kilka mm dla trybu proporcjonalnego
+        if (config.minDistance < 20 || config.maxDistance < config.minDistance + GESTURE_MIN_WINDOW ||
+            config.tapMaxMs == 0 || config.swipeMaxMs == 0 || config.sliderHoldMs <= config.tapMaxMs ||
+            config.lateralMinGapMs >= config.lateralGapMs) {
+            request->send(400, "application/json", "{\"error\":\"Invalid thresholds\"}");
+            return;
+        }
+
+        if (doc.containsKey("maxDistance")) {
+            userMaxDistance = config.maxDistance;
+            config.maxDistance = calibratedMaxDistance(userMaxDistance);
+        }
+        gestureConfig = config;
+        requestGestureConfig();
+        saveGestureConfig();
+
+        autoCalibration = doc["autoCalibration"] | autoCalibration;
+        preferences.putBool("gCalAuto", autoCalibration);
+        request->send(200);
+    });
+
+    // Klasyfikator gestów: czas inferencji (us) i pewność ostatniego wyniku
+    server.on("/api/classifier", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /api/classifier");
+        StaticJsonDocument<384> doc;
+        const ClassifierStats& stats = gestureClassifierStats();
+        doc["enabled"] = gestureConfig.classifierEnabled;
+        doc["minConfidence"] = gestureConfig.minConfidence;
+        doc["modelNodes"] = sizeof(GESTURE_MODEL) / sizeof(GESTURE_MODEL[0]);
+        doc["modelSamples"] = GESTURE_MODEL_SAMPLES;
+        doc["inferences"] = stats.inferences;
+        doc["rejected"] = stats.rejected;
+
+        JsonObject time = doc.createNestedObject("timeUs");
+        time["last"] = stats.lastUs;
+        time["max"] = stats.maxUs;
+        time["mean"] = stats.inferences ? (float)stats.totalUs / stats.inferences : 0;
+
+        if (stats.inferences) {
+            JsonObject last = doc.createNestedObject("last");
+            last["gesture"] = gestureTypeName((GestureType)stats.last.type);
+            last["confidence"] = stats.last.confidence / 255.0f;
+        }
+
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Kalibracja okna na żądanie - przez CalibrationConfig::durationMs nic nie powinno być pod okapem
+    server.on("/calibrateGesture", HTTP_POST, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP POST /calibrateGesture");
+        requestCalibration();
+        request->send(200);
+    });
+
+    // Profil pomiaru VL53L0X, limity jakości oraz osiągnięte próbkowanie i szum
+    server.on("/sensor", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /sensor");
+        StaticJsonDocument<768> doc;
+        doc["profile"] = RANGING_PROFILES[rangingProfile].name;
+        doc["budgetUs"] = RANGING_PROFILES[rangingProfile].budgetUs;
+        doc["signalRate"] = signalRateLimit;
+        doc["sigma"] = sigmaLimit;
+        doc["sampleRate"] = rangingSampleRate();
+        doc["adaptive"] = adaptiveSampling;
+        doc["burst"] = rangingBurst();
+        doc["online"] = i2cDeviceOnline(I2C_DEV_VL53L0X);
+        doc["dual"] = dualSensors;
+
+        float mean, stddev;
+        uint8_t samples;
+        if (rangingNoise(mean, stddev, samples)) {
+            JsonObject noise = doc.createNestedObject("noise");
+            noise["mean"] = mean;
+            noise["stddev"] = stddev;
+            noise["samples"] = samples;
+        }
+
+        JsonObject filter = doc.createNestedObject("filter");
+        filter["median"] = rangeFilterConfig.medianEnabled;
+        filter["kalman"] = rangeFilterConfig.kalmanEnabled;
+        filter["minSignal"] = rangeFilterConfig.minSignalRate;
+        filter["maxAmbient"] = rangeFilterConfig.maxAmbientRate;
+        filter["kalmanQ"] = rangeFilterConfig.kalmanQ;
+        filter["kalmanR"] = rangeFilterConfig.kalmanR;
+
+        const RangeFilterStats& stats = rangeFilterStats();
+        JsonObject filterStats = filter.createNestedObject("stats");
+        filterStats["samples"] = stats.samples;
+        filterStats["gatedSignal"] = stats.gatedSignal;
+        filterStats["gatedAmbient"] = stats.gatedAmbient;
+        filterStats["spikes"] = stats.suppressed;
+
+        uint32_t rawGestures, filteredGestures;
+        rangeFilterGestureCounts(rawGestures, filteredGestures);
+        JsonObject gestures = filter.createNestedObject("gestures");
+        gestures["raw"] = rawGestures;
+        gestures["filtered"] = filteredGestures;
+
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // {"profile":"highSpeed|balanced|highAccuracy","signalRate":0.25,"sigma":18,"adaptive":true,
+    //  "filter":{"median":true,"kalman":false,"minSignal":0.5,"maxAmbient":4,"kalmanQ":4,"kalmanR":25}}
+    // Zmiana profilu bez limitów przywraca domyślne limity profilu.
+    server.on("/sensor", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /sensor");
         String body = String((char *)data).substring(0, len);
         StaticJsonDocument<512> doc;
         DeserializationError error = deserializeJson(doc, body);
-        
+
         if (error) {
             request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
 
-        String newWebhookUrl = doc["url"].as<String>();
-        webhookUrl = newWebhookUrl;  // Update the global variable
-        preferences.putString("webhook", webhookUrl);  // Save to preferences
-        
-        Serial.println("New webhook URL saved: " + webhookUrl);
+        int profile = rangingProfile;
+        if (doc.containsKey("profile")) {
+            profile = rangingProfileFromString(doc["profile"].as<String>());
+            if (profile < 0) {
+                request->send(400, "application/json", "{\"error\":\"Invalid profile\"}");
+                return;
+            }
+        }
+        bool profileChanged = profile != rangingProfile;
+        float signalRate = doc["signalRate"] | (profileChanged ? RANGING_PROFILES[profile].signalRate : signalRateLimit);
+        float sigma = doc["sigma"] | (profileChanged ? RANGING_PROFILES[profile].sigma : sigmaLimit);
+        if (signalRate < 0.01f || signalRate > 10.0f || sigma < 1.0f || sigma > 100.0f) {
+            request->send(400, "application/json", "{\"error\":\"Invalid limits\"}");
+            return;
+        }
+
+        RangeFilterConfig filter = rangeFilterConfig;
+        JsonObject filterJson = doc["filter"];
+        if (!filterJson.isNull()) {
+            filter.medianEnabled = filterJson["median"] | filter.medianEnabled;
+            filter.kalmanEnabled = filterJson["kalman"] | filter.kalmanEnabled;
+            filter.minSignalRate = filterJson["minSignal"] | filter.minSignalRate;
+            filter.maxAmbientRate = filterJson["maxAmbient"] | filter.maxAmbientRate;
+            filter.kalmanQ = filterJson["kalmanQ"] | filter.kalmanQ;
+            filter.kalmanR = filterJson["kalmanR"] | filter.kalmanR;
+            if (filter.minSignalRate < 0.0f || filter.minSignalRate > 50.0f ||
+                filter.maxAmbientRate < 0.1f || filter.maxAmbientRate > 100.0f ||
+                filter.kalmanQ <= 0.0f || filter.kalmanR <= 0.0f) {
+                request->send(400, "application/json", "{\"error\":\"Invalid filter\"}");
+                return;
+            }
+        }
+
+        rangeFilterConfig = filter;
+        requestRangeFilterConfig();
+        saveRangeFilterConfig();
+
+        rangingProfile = profile;
+        signalRateLimit = signalRate;
+        sigmaLimit = sigma;
+        adaptiveSampling = doc["adaptive"] | adaptiveSampling;
+        requestRangingConfig();
+
+        preferences.putUChar("rngProfile", rangingProfile);
+        preferences.putFloat("rngSignal", signalRateLimit);
+        preferences.putFloat("rngSigma", sigmaLimit);
+        preferences.putBool("rngAdaptive", adaptiveSampling);
+        request->send(200);
+    });
+
+    server.on("/mqtt", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /mqtt");
+        String body = String((char *)data).substring(0, len);
+        StaticJsonDocument<384> doc;
+        DeserializationError error = deserializeJson(doc, body);
+
+        if (error) {
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        String baseTopic = doc["baseTopic"] | mqttBaseTopic.c_str();
+        if (baseTopic.isEmpty() || baseTopic.indexOf('#') >= 0 || baseTopic.indexOf('+') >= 0) {
+            request->send(400, "application/json", "{\"error\":\"Invalid base topic\"}");
+            return;
+        }
+
+        mqttEnabled = doc["enabled"] | mqttEnabled;
+        mqttHost = doc["host"] | mqttHost.c_str();
+        mqttPort = doc["port"] | mqttPort;
+        mqttUser = doc["user"] | mqttUser.c_str();
+        if (doc.containsKey("password")) {
+            mqttPassword = doc["password"].as<String>();
+        }
+        mqttBaseTopic = baseTopic;
+
+        preferences.putBool("mqttEnabled", mqttEnabled);
+        preferences.putString("mqttHost", mqttHost);
+        preferences.putUShort("mqttPort", mqttPort);
+        preferences.putString("mqttUser", mqttUser);
+        preferences.putString("mqttPass", mqttPassword);
+        preferences.putString("mqttBase", mqttBaseTopic);
+
+        restartMqtt();
+        request->send(200);
+    });
+
+    server.on("/telemetry", HTTP_GET, [](AsyncWebServerRequest *request) {
+        TRACE_SCOPE("HTTP GET /telemetry");
+        StaticJsonDocument<256> doc;
+        doc["enabled"] = telemetryBatchEnabled;
+        doc["sampleInterval"] = telemetrySampleInterval;
+        doc["batchSize"] = telemetryBatchSize;
+        doc["maxAge"] = telemetryBatchMaxAge;
+        doc["format"] = telemetryNdjson ? "ndjson" : "json";
+        doc["pending"] = telemetryPendingCount();
+        doc["heartbeatInterval"] = heartbeatInterval;
+        doc["tempDeadband"] = tempDeadband;
+        doc["humDeadband"] = humDeadband;
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    server.on("/telemetry", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        TRACE_SCOPE("HTTP POST /telemetry");
+        String body = String((char *)data).substring(0, len);
+        StaticJsonDocument<256> doc;
+        DeserializationError error = deserializeJson(doc, body);
+
+        if (error) {
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        unsigned long sampleInterval = doc["sampleInterval"] | telemetrySampleInterval;
+        int batchSize = doc["batchSize"] | telemetryBatchSize;
+        unsigned long maxAge = doc["maxAge"] | telemetryBatchMaxAge;
+        unsigned long heartbeat = doc["heartbeatInterval"] | heartbeatInterval;
+        float tempBand = doc["tempDeadband"] | tempDeadband;
+        float humBand = doc["humDeadband"] | humDeadband;
+        if (sampleInterval < 1000 || batchSize < 1 || batchSize > MAX_TELEMETRY_BATCH || maxAge < sampleInterval ||
+            heartbeat < PERIODIC_CHECK_INTERVAL || tempBand < 0 || humBand < 0) {
+            request->send(400, "application/json", "{\"error\":\"Invalid telemetry settings\"}");
+            return;
+        }
+
+        // Przy wyłączaniu nie zostawiaj próbek w buforze
+        bool enabled = doc["enabled"] | telemetryBatchEnabled;
+        if (telemetryBatchEnabled && !enabled) {
+            flushTelemetryBatch();
+        }
+
+        telemetryBatchEnabled = enabled;
+        telemetrySampleInterval = sampleInterval;
+        telemetryBatchSize = batchSize;
+        telemetryBatchMaxAge = maxAge;
+        heartbeatInterval = heartbeat;
+        tempDeadband = tempBand;
+        humDeadband = humBand;
+        if (doc.containsKey("format")) {
+            telemetryNdjson = doc["format"] == "ndjson";
+        }
+
+        preferences.putBool("tlmBatch", telemetryBatchEnabled);
+        preferences.putULong("tlmSample", telemetrySampleInterval);
+        preferences.putInt("tlmSize", telemetryBatchSize);
+        preferences.putULong("tlmAge", telemetryBatchMaxAge);
+        preferences.putBool("tlmNdjson", telemetryNdjson);
+        preferences.putULong("hbInterval", heartbeatInterval);
+        preferences.putFloat("tempDeadband", tempDeadband);
+        preferences.putFloat("humDeadband", humDeadband);
+
         request->send(200);
     });
 
@@ -0,0 +1,126 @@
+#include <unity.h>
+#include "dual_gesture_engine.h"
+
+// Dwa czujniki próbkowane co SAMPLE_MS; dłoń pod czujnikiem w [from, to) ms przebiegu.
+
+static const uint32_t SAMPLE_MS = 20;
+static const int AWAY = -1;
+static const int HAND = 120;
+
+struct Span {
+    uint32_t from;
+    uint32_t to;
+    bool covers(uint32_t t) const { return t >= from && t < to; }
+};
+
+static const Span NONE = { 0, 0 };
+
+struct DualTrace {
+    DualGestureEngine engine;
+    GestureResult results[8];
+    uint32_t times[8];
+    uint8_t count = 0;
+
+    DualTrace() { engine.setDual(true); }
+
+    void collect(const GestureResult& result, uint32_t now) {
+        if (result.type != GESTURE_NONE && count < 8) {
+            results[count] = result;
+            times[count] = now;
+            count++;
+        }
+    }
+
+    void run(uint32_t duration, Span left, Span right) {
+        for (uint32_t now = 0; now < duration; now += SAMPLE_MS) {
+            collect(engine.update(now, left.covers(now) ? HAND : AWAY), now);
+            collect(engine.updateSecondary(now, right.covers(now) ? HAND : AWAY), now);
+        }
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void test_swipe_right() {
+    DualTrace trace;
+    trace.run(1500, { 100, 300 }, { 200, 400 });
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_SWIPE_RIGHT, trace.results[0].type);
+}
+
+static void test_swipe_left() {
+    DualTrace trace;
+    trace.run(1500, { 200, 400 }, { 100, 300 });
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_SWIPE_LEFT, trace.results[0].type);
+}
+
+static void test_vertical_drop_is_not_swipe() {
+    // Dłoń opuszczona pionowo wchodzi pod oba czujniki prawie naraz (< lateralMinGapMs)
+    DualTrace trace;
+    trace.run(1500, { 100, 300 }, { 120, 320 });
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+}
+
+static void test_slow_pass_is_not_swipe() {
+    DualTrace trace;
+    trace.run(2500, { 100, 900 }, { 300, 1100 });
+    for (uint8_t i = 0; i < trace.count; i++) {
+        TEST_ASSERT_TRUE(trace.results[i].type != GESTURE_SWIPE_LEFT);
+        TEST_ASSERT_TRUE(trace.results[i].type != GESTURE_SWIPE_RIGHT);
+    }
+}
+
+static void test_held_tap_released_after_wait() {
+    GestureConfig config;
+    config.doubleTapWindowMs = 0;
+    DualTrace trace;
+    trace.engine.setConfig(config);
+    trace.run(1000, { 100, 300 }, NONE);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+    // Pierwsza próbka po lateralWaitMs od wyjścia dłoni (300 ms)
+    uint32_t release = 300 + config.lateralWaitMs;
+    TEST_ASSERT_TRUE(trace.times[0] >= release);
+    TEST_ASSERT_TRUE(trace.times[0] < release + SAMPLE_MS);
+}
+
+static void test_tap_then_swipe_on_left_sensor() {
+    // Swipe kończący drugą obecność po tapie - wstrzymany tap wychodzi przed nim
+    DualTrace trace;
+    trace.run(400, { 100, 300 }, NONE);
+    for (uint32_t now = 400; now < 2000; now += SAMPLE_MS) {
+        int distance = (now >= 400 && now < 700) ? 190 - (int)(now - 400) * 120 / 280 : AWAY;
+        trace.collect(trace.engine.update(now, distance), now);
+        trace.collect(trace.engine.updateSecondary(now, AWAY), now);
+    }
+    TEST_ASSERT_EQUAL(2, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+    TEST_ASSERT_EQUAL(GESTURE_APPROACH, trace.results[1].type);
+}
+
+static void test_single_sensor_passes_through() {
+    GestureConfig config;
+    config.doubleTapWindowMs = 0;
+    DualTrace trace;
+    trace.engine.setConfig(config);
+    trace.engine.setDual(false);
+    trace.run(1000, { 100, 300 }, { 200, 400 });
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+    TEST_ASSERT_EQUAL(300, trace.times[0]);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_swipe_right);
+    RUN_TEST(test_swipe_left);
+    RUN_TEST(test_vertical_drop_is_not_swipe);
+    RUN_TEST(test_slow_pass_is_not_swipe);
+    RUN_TEST(test_held_tap_released_after_wait);
+    RUN_TEST(test_tap_then_swipe_on_left_sensor);
+    RUN_TEST(test_single_sensor_passes_through);
+    return UNITY_END();
+}
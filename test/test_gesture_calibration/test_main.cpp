@@ -0,0 +1,69 @@
+#include <unity.h>
+#include "gesture_calibration.h"
+
+// Tło zbierane przez 30 s z próbką co SAMPLE_MS; okno gestów od MIN_DISTANCE,
+// co najmniej MIN_WINDOW mm szerokości (jak GESTURE_MIN_WINDOW).
+
+static const uint32_t SAMPLE_MS = 20;
+static const uint16_t MIN_DISTANCE = 50;
+static const uint16_t MIN_WINDOW = 40;
+static const int AWAY = -1;
+
+static CalibrationResult calibrate(int distance, const CalibrationConfig& config = CalibrationConfig()) {
+    GestureCalibrator calibrator(config);
+    calibrator.start(0);
+    for (uint32_t now = 0; ; now += SAMPLE_MS) {
+        if (calibrator.update(now, distance, MIN_DISTANCE, MIN_WINDOW)) {
+            return calibrator.result();
+        }
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_no_target_does_not_narrow_window() {
+    // Okno użytkownika 300 mm nie może zostać przycięte do domyślnych 200 mm
+    CalibrationResult result = calibrate(AWAY);
+    TEST_ASSERT_TRUE(result.valid);
+    TEST_ASSERT_TRUE(result.stable);
+    TEST_ASSERT_EQUAL(-1, result.baseline);
+    TEST_ASSERT_EQUAL(UINT16_MAX, result.maxDistance);
+}
+
+static void test_far_background_beyond_default_window() {
+    // Tło 405 mm: zapas 20% = 81 mm, okno do 324 mm - ponad domyślne 200
+    CalibrationResult result = calibrate(400);
+    TEST_ASSERT_TRUE(result.valid);
+    TEST_ASSERT_EQUAL(405, result.baseline);
+    TEST_ASSERT_EQUAL(324, result.maxDistance);
+}
+
+static void test_near_background_narrows_window() {
+    // Tło 155 mm: zapas minimalny 60 mm
+    CalibrationResult result = calibrate(150);
+    TEST_ASSERT_TRUE(result.valid);
+    TEST_ASSERT_EQUAL(95, result.maxDistance);
+}
+
+static void test_background_too_close_is_invalid() {
+    CalibrationResult result = calibrate(120);
+    TEST_ASSERT_FALSE(result.valid);
+}
+
+static void test_window_limit_caps_result() {
+    CalibrationConfig config;
+    config.windowLimit = 250;
+    TEST_ASSERT_EQUAL(250, calibrate(AWAY, config).maxDistance);
+    TEST_ASSERT_EQUAL(250, calibrate(400, config).maxDistance);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_target_does_not_narrow_window);
+    RUN_TEST(test_far_background_beyond_default_window);
+    RUN_TEST(test_near_background_narrows_window);
+    RUN_TEST(test_background_too_close_is_invalid);
+    RUN_TEST(test_window_limit_caps_result);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+#include <unity.h>
+#include "gesture_engine.h"
+
+// Przebiegi jak z czujnika: próbka co SAMPLE_MS, -1 = brak celu. Domyślne progi
+// GestureConfig: okno 50-200 mm, tap do 800 ms, drugi tap w 400 ms, swipe do 600 ms i 60 mm.
+
+static const uint32_t SAMPLE_MS = 20;
+static const int AWAY = -1;
+
+struct Trace {
+    GestureEngine engine;
+    uint32_t now = 0;
+    GestureResult results[16];
+    uint32_t times[16];
+    uint8_t count = 0;
+
+    // Odległość zmieniana liniowo od from do to przez duration ms
+    void feed(uint32_t duration, int from, int to) {
+        uint32_t steps = duration / SAMPLE_MS;
+        for (uint32_t i = 0; i < steps; i++) {
+            int distance = from;
+            if (from >= 0 && to >= 0 && steps > 1) {
+                distance = from + (to - from) * (int)i / (int)(steps - 1);
+            }
+            GestureResult result = engine.update(now, distance);
+            if (result.type != GESTURE_NONE && count < 16) {
+                results[count] = result;
+                times[count] = now;
+                count++;
+            }
+            now += SAMPLE_MS;
+        }
+    }
+
+    void hold(uint32_t duration, int distance) { feed(duration, distance, distance); }
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void test_tap_after_double_tap_window() {
+    Trace trace;
+    trace.hold(200, AWAY);
+    trace.hold(300, 120);
+    uint32_t leave = trace.now;
+    trace.hold(200, AWAY);
+    TEST_ASSERT_EQUAL(0, trace.count);      // Jeszcze może przyjść drugi tap
+
+    trace.hold(600, AWAY);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+    TEST_ASSERT_TRUE(trace.times[0] > leave + trace.engine.config().doubleTapWindowMs);
+}
+
+static void test_tap_immediate_without_double_tap() {
+    GestureConfig config;
+    config.doubleTapWindowMs = 0;
+    Trace trace;
+    trace.engine.setConfig(config);
+    trace.hold(300, 120);
+    uint32_t leave = trace.now;
+    trace.hold(100, AWAY);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+    TEST_ASSERT_EQUAL(leave, trace.times[0]);
+}
+
+static void test_double_tap() {
+    Trace trace;
+    trace.hold(200, 120);
+    trace.hold(150, AWAY);
+    trace.hold(200, 130);
+    trace.hold(800, AWAY);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_DOUBLE_TAP, trace.results[0].type);
+}
+
+static void test_tap_then_swipe() {
+    // Druga obecność w oknie podwójnego tapu okazuje się swipe'em - tap nie może przepaść
+    Trace trace;
+    trace.hold(200, AWAY);
+    trace.hold(300, 120);
+    trace.hold(150, AWAY);
+    trace.feed(300, 190, 70);
+    trace.hold(800, AWAY);
+    TEST_ASSERT_EQUAL(2, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+    TEST_ASSERT_EQUAL(GESTURE_APPROACH, trace.results[1].type);
+    TEST_ASSERT_TRUE(trace.times[1] > trace.times[0]);
+}
+
+static void test_long_presence_is_not_tap() {
+    Trace trace;
+    trace.feed(1000, 180, 100);     // Ciągły ruch - ani tap, ani tryb proporcjonalny
+    trace.hold(800, AWAY);
+    TEST_ASSERT_EQUAL(0, trace.count);
+}
+
+static void test_approach_swipe() {
+    Trace trace;
+    trace.feed(300, 190, 70);
+    trace.hold(100, AWAY);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_APPROACH, trace.results[0].type);
+}
+
+static void test_retreat_swipe() {
+    Trace trace;
+    trace.feed(300, 70, 190);
+    trace.hold(100, AWAY);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_RETREAT, trace.results[0].type);
+}
+
+static void test_short_travel_is_tap_not_swipe() {
+    Trace trace;
+    trace.feed(300, 150, 110);      // 40 mm < swipeMinTravel
+    trace.hold(800, AWAY);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_TAP, trace.results[0].type);
+}
+
+static void test_slider_levels_with_hysteresis() {
+    Trace trace;
+    trace.hold(1600, 180);
+    TEST_ASSERT_EQUAL(1, trace.count);
+    TEST_ASSERT_EQUAL(GESTURE_SLIDER, trace.results[0].type);
+    TEST_ASSERT_EQUAL(1, trace.results[0].level);
+    TEST_ASSERT_TRUE(trace.engine.sliderActive());
+
+    // Granica biegów 1/2 wypada przy 162 mm - tuż za nią bieg się nie zmienia
+    trace.hold(200, 160);
+    TEST_ASSERT_EQUAL(1, trace.count);
+
+    trace.hold(200, 150);
+    TEST_ASSERT_EQUAL(2, trace.count);
+    TEST_ASSERT_EQUAL(2, trace.results[1].level);
+
+    // Powrót tuż za granicę - nadal 2, dopiero dalej o histerezę spada do 1
+    trace.hold(200, 165);
+    TEST_ASSERT_EQUAL(2, trace.count);
+    trace.hold(200, 175);
+    TEST_ASSERT_EQUAL(3, trace.count);
+    TEST_ASSERT_EQUAL(1, trace.results[2].level);
+
+    trace.hold(200, 60);
+    TEST_ASSERT_EQUAL(4, trace.count);
+    TEST_ASSERT_EQUAL(4, trace.results[3].level);
+
+    // Wyjście z okna kończy tryb bez dodatkowego gestu
+    trace.hold(800, AWAY);
+    TEST_ASSERT_EQUAL(4, trace.count);
+    TEST_ASSERT_FALSE(trace.engine.busy());
+}
+
+static void test_invalid_samples_outside_window() {
+    Trace trace;
+    trace.hold(300, 40);            // Za blisko (poniżej minDistance)
+    trace.hold(300, 400);           // Za daleko
+    trace.hold(300, AWAY);
+    TEST_ASSERT_EQUAL(0, trace.count);
+    TEST_ASSERT_FALSE(trace.engine.busy());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_tap_after_double_tap_window);
+    RUN_TEST(test_tap_immediate_without_double_tap);
+    RUN_TEST(test_double_tap);
+    RUN_TEST(test_tap_then_swipe);
+    RUN_TEST(test_long_presence_is_not_tap);
+    RUN_TEST(test_approach_swipe);
+    RUN_TEST(test_retreat_swipe);
+    RUN_TEST(test_short_travel_is_tap_not_swipe);
+    RUN_TEST(test_slider_levels_with_hysteresis);
+    RUN_TEST(test_invalid_samples_outside_window);
+    return UNITY_END();
+}
@@ -0,0 +1,79 @@
+#include <unity.h>
+#include "gesture_engine.h"
+#include "range_filter.h"
+
+// Przebieg odtwarzany jak w tools/replay_capture.cpp: surowe odczyty do jednego
+// silnika, po RangeFilter do drugiego.
+
+static const uint32_t SAMPLE_MS = 20;
+static const int AWAY = -1;
+
+struct Replay {
+    GestureEngine rawEngine;
+    GestureEngine filteredEngine;
+    RangeFilter filter;
+    uint32_t now = 0;
+    uint32_t raw = 0;
+    uint32_t filtered = 0;
+
+    void sample(int distance, float signalRate = 2.0f, float ambientRate = 0.5f) {
+        int value = filter.update(distance, signalRate, ambientRate);
+        if (rawEngine.update(now, distance).type != GESTURE_NONE) {
+            raw++;
+        }
+        if (filteredEngine.update(now, value).type != GESTURE_NONE) {
+            filtered++;
+        }
+        now += SAMPLE_MS;
+    }
+
+    void hold(uint32_t duration, int distance) {
+        for (uint32_t t = 0; t < duration; t += SAMPLE_MS) {
+            sample(distance);
+        }
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void test_single_sample_spikes_suppressed() {
+    Replay replay;
+    replay.hold(200, AWAY);
+    for (int i = 0; i < 10; i++) {
+        replay.sample(120);         // Pojedynczy odblask garnka
+        replay.hold(800, AWAY);
+    }
+    TEST_ASSERT_EQUAL(10, replay.raw);
+    TEST_ASSERT_EQUAL(0, replay.filtered);
+    TEST_ASSERT_EQUAL(10, replay.filter.stats().suppressed);
+}
+
+static void test_real_tap_passes_filter() {
+    Replay replay;
+    replay.hold(200, AWAY);
+    replay.hold(300, 120);
+    replay.hold(800, AWAY);
+    TEST_ASSERT_EQUAL(1, replay.raw);
+    TEST_ASSERT_EQUAL(1, replay.filtered);
+}
+
+static void test_weak_signal_gated() {
+    Replay replay;
+    replay.hold(200, AWAY);
+    for (uint32_t t = 0; t < 300; t += SAMPLE_MS) {
+        replay.sample(120, 0.2f, 0.5f);     // Para - odbicie o słabym sygnale
+    }
+    replay.hold(800, AWAY);
+    TEST_ASSERT_EQUAL(1, replay.raw);
+    TEST_ASSERT_EQUAL(0, replay.filtered);
+    TEST_ASSERT_TRUE(replay.filter.stats().gatedSignal > 0);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_sample_spikes_suppressed);
+    RUN_TEST(test_real_tap_passes_filter);
+    RUN_TEST(test_weak_signal_gated);
+    return UNITY_END();
+}
@@ -0,0 +1,203 @@
+// Odtwarza nagrania z /capture?format=bin przez RangeFilter i GestureEngine na komputerze
+// i porównuje gesty rozpoznane na surowych odczytach z gestami po filtracji - tak jak
+// liczniki rawGestures/filteredGestures w /api/gestures, ale bez czekania przy okapie.
+// Nagrania z etykietą "negative" (garnki, para) nie powinny dać żadnego gestu, więc dla
+// nich wypisywana jest liczba fałszywych wyzwoleń na minutę.
+//
+//     g++ -std=gnu++17 -O2 -Iinclude -o replay_capture tools/replay_capture.cpp
+//         src/gesture_engine.cpp src/gesture_classifier.cpp src/range_filter.cpp
+//     ./replay_capture [--min-distance 50] [--max-distance 200] [--min-signal 0.5]
+//                      [--max-ambient 4.0] [--no-median] [--kalman] nagranie.bin...
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "gesture_engine.h"
+#include "range_filter.h"
+
+// Format z include/capture.h (capture.h wymaga Arduino, więc stałe są powtórzone)
+static const size_t HEADER_SIZE = 16;
+static const size_t SAMPLE_SIZE = 12;
+static const uint8_t FORMAT_VERSION = 1;
+static const uint8_t LABEL_NEGATIVE = 0x80;   // CAPTURE_LABEL_NEGATIVE
+static const uint8_t RANGE_STATUS_NO_TARGET = 4;
+
+struct Sample {
+    uint32_t time;
+    uint16_t range;
+    uint8_t status;
+    float signalRate;
+    float ambientRate;
+};
+
+struct Counts {
+    uint32_t raw[GESTURE_TYPE_COUNT] = {};
+    uint32_t filtered[GESTURE_TYPE_COUNT] = {};
+    uint32_t rawTotal = 0;
+    uint32_t filteredTotal = 0;
+    uint32_t durationMs = 0;
+
+    void add(const Counts& other) {
+        for (int i = 0; i < GESTURE_TYPE_COUNT; i++) {
+            raw[i] += other.raw[i];
+            filtered[i] += other.filtered[i];
+        }
+        rawTotal += other.rawTotal;
+        filteredTotal += other.filteredTotal;
+        durationMs += other.durationMs;
+    }
+};
+
+static uint32_t le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static bool readCapture(const char* path, uint8_t& label, std::vector<Sample>& samples) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "%s: nie można otworzyć\n", path);
+        return false;
+    }
+    uint8_t header[HEADER_SIZE];
+    bool ok = fread(header, 1, HEADER_SIZE, file) == HEADER_SIZE &&
+              memcmp(header, "OKCP", 4) == 0 && header[4] == FORMAT_VERSION &&
+              header[5] == SAMPLE_SIZE;
+    if (!ok) {
+        fprintf(stderr, "%s: nieobsługiwany format nagrania\n", path);
+        fclose(file);
+        return false;
+    }
+    label = header[6];
+    uint32_t count = le32(header + 8);
+
+    samples.clear();
+    uint8_t record[SAMPLE_SIZE];
+    while (samples.size() < count && fread(record, 1, SAMPLE_SIZE, file) == SAMPLE_SIZE) {
+        Sample sample;
+        sample.time = le32(record);
+        sample.range = le16(record + 4);
+        sample.status = record[6];
+        sample.signalRate = le16(record + 8) / 256.0f;
+        sample.ambientRate = le16(record + 10) / 256.0f;
+        samples.push_back(sample);
+    }
+    fclose(file);
+    if (samples.size() < count) {
+        fprintf(stderr, "%s: ucięte nagranie (%zu z %u próbek)\n", path, samples.size(), (unsigned)count);
+    }
+    return true;
+}
+
+// Jak processGesture(): surowa odległość do jednego silnika, po RangeFilter do drugiego
+static Counts replay(const std::vector<Sample>& samples, const GestureConfig& gestureConfig,
+                     const RangeFilterConfig& filterConfig) {
+    Counts counts;
+    GestureEngine rawEngine(gestureConfig);
+    GestureEngine filteredEngine(gestureConfig);
+    RangeFilter filter(filterConfig);
+
+    for (const Sample& sample : samples) {
+        int rawDistance = sample.status != RANGE_STATUS_NO_TARGET ? sample.range : -1;
+        int distance = filter.update(rawDistance, sample.signalRate, sample.ambientRate);
+
+        GestureType raw = rawEngine.update(sample.time, rawDistance).type;
+        if (raw != GESTURE_NONE) {
+            counts.raw[raw]++;
+            counts.rawTotal++;
+        }
+        GestureType filtered = filteredEngine.update(sample.time, distance).type;
+        if (filtered != GESTURE_NONE) {
+            counts.filtered[filtered]++;
+            counts.filteredTotal++;
+        }
+    }
+    if (samples.size() > 1) {
+        counts.durationMs = samples.back().time - samples.front().time;
+    }
+    return counts;
+}
+
+static void printCounts(const char* name, const Counts& counts, bool negative) {
+    printf("%-32s surowe %4u  po filtrze %4u", name, (unsigned)counts.rawTotal, (unsigned)counts.filteredTotal);
+    if (negative && counts.durationMs > 0) {
+        float minutes = counts.durationMs / 60000.0f;
+        printf("  fałszywe/min: surowe %.2f, po filtrze %.2f",
+               counts.rawTotal / minutes, counts.filteredTotal / minutes);
+    }
+    printf("\n");
+    for (int i = 1; i < GESTURE_TYPE_COUNT; i++) {
+        if (counts.raw[i] || counts.filtered[i]) {
+            printf("    %-12s %4u  %4u\n", gestureTypeName((GestureType)i),
+                   (unsigned)counts.raw[i], (unsigned)counts.filtered[i]);
+        }
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Użycie: %s [--min-distance mm] [--max-distance mm] [--min-signal MCPS]\n"
+                    "          [--max-ambient MCPS] [--no-median] [--kalman] nagranie.bin...\n", program);
+}
+
+int main(int argc, char** argv) {
+    GestureConfig gestureConfig;
+    RangeFilterConfig filterConfig;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(arg, "--min-distance") && hasValue) {
+            gestureConfig.minDistance = atoi(argv[++i]);
+        } else if (!strcmp(arg, "--max-distance") && hasValue) {
+            gestureConfig.maxDistance = atoi(argv[++i]);
+        } else if (!strcmp(arg, "--min-signal") && hasValue) {
+            filterConfig.minSignalRate = atof(argv[++i]);
+        } else if (!strcmp(arg, "--max-ambient") && hasValue) {
+            filterConfig.maxAmbientRate = atof(argv[++i]);
+        } else if (!strcmp(arg, "--no-median")) {
+            filterConfig.medianEnabled = false;
+        } else if (!strcmp(arg, "--kalman")) {
+            filterConfig.kalmanEnabled = true;
+        } else if (arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Counts total;
+    Counts negatives;
+    bool failed = false;
+    std::vector<Sample> samples;
+    for (const char* path : paths) {
+        uint8_t label;
+        if (!readCapture(path, label, samples)) {
+            failed = true;
+            continue;
+        }
+        Counts counts = replay(samples, gestureConfig, filterConfig);
+        bool negative = label == LABEL_NEGATIVE;
+        printCounts(path, counts, negative);
+        total.add(counts);
+        if (negative) {
+            negatives.add(counts);
+        }
+    }
+
+    printf("\n");
+    printCounts("Razem", total, false);
+    if (negatives.durationMs > 0) {
+        printCounts("Nagrania negative", negatives, true);
+    }
+    return failed ? 1 : 0;
+}
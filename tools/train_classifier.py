@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""Trenuje klasyfikator gestów na nagraniach z /capture?format=bin i zapisuje
+include/gesture_model.h.
+
+Nagrania z etykietą (POST /api/capture {"mode":"continuous","label":"tap"}) dzielone
+są na obecności dłoni w oknie gestów tak jak w GestureEngine, po przejściu przez ten
+sam filtr co RangeFilter. Cechy każdej obecności liczone są jak w
+SegmentFeatureExtractor (src/gesture_classifier.cpp) - zmiana jednej strony wymaga
+zmiany drugiej.
+
+    python3 tools/train_classifier.py tap*.bin swipe*.bin garnki*.bin
+"""
+
+import argparse
+import struct
+import sys
+from pathlib import Path
+
+# GestureType
+NONE, TAP, DOUBLE_TAP, APPROACH, RETREAT, SLIDER = range(6)
+CLASS_NAMES = {NONE: "none", TAP: "tap", APPROACH: "approach", RETREAT: "retreat"}
+LABEL_NEGATIVE = 0x80
+
+FEATURES = ["FEATURE_DURATION", "FEATURE_TRAVEL", "FEATURE_SPAN", "FEATURE_PATH",
+            "FEATURE_REVERSALS", "FEATURE_MIN_POSITION", "FEATURE_SAMPLES"]
+REVERSAL_MM = 8         # SEGMENT_REVERSAL_MM
+INT16_MAX = 32767
+NO_TARGET = 0x7FFF      # RangeFilter::NO_TARGET
+
+HEADER = struct.Struct("<4sBBBBII")
+SAMPLE = struct.Struct("<IHBBHH")
+
+
+def read_capture(path):
+    data = Path(path).read_bytes()
+    magic, version, sample_size, label, _, count, _ = HEADER.unpack_from(data, 0)
+    if magic != b"OKCP" or version != 1 or sample_size != SAMPLE.size:
+        raise ValueError(f"{path}: nieobsługiwany format nagrania")
+    samples = []
+    for i in range(count):
+        time, distance, status, _, signal, ambient = SAMPLE.unpack_from(data, HEADER.size + i * SAMPLE.size)
+        samples.append((time, distance, status, signal / 256.0, ambient / 256.0))
+    return label, samples
+
+
+class RangeFilter:
+    """Odpowiednik RangeFilter::update() (bramki + mediana z 3, bez Kalmana)."""
+
+    def __init__(self, args):
+        self.args = args
+        self.window = []
+
+    def update(self, distance, signal, ambient):
+        value = NO_TARGET if distance < 0 else distance
+        if value != NO_TARGET and (signal < self.args.min_signal or ambient > self.args.max_ambient):
+            value = NO_TARGET
+        if not self.args.no_median:
+            self.window = (self.window + [value])[-3:]
+            if len(self.window) == 3:
+                value = sorted(self.window)[1]
+        return -1 if value == NO_TARGET else value
+
+
+class Segment:
+    """Odpowiednik SegmentFeatureExtractor."""
+
+    def __init__(self, now, distance):
+        self.start = now
+        self.first = self.last = self.min = self.max = distance
+        self.min_index = 0
+        self.path = 0
+        self.reversals = 0
+        self.direction = 0
+        self.samples = 1
+
+    def add(self, distance):
+        delta = distance - self.last
+        if abs(delta) >= REVERSAL_MM:
+            direction = 1 if delta > 0 else -1
+            if self.direction and direction != self.direction:
+                self.reversals += 1
+            self.direction = direction
+        self.path += abs(delta)
+        self.last = distance
+        if distance < self.min:
+            self.min = distance
+            self.min_index = self.samples
+        self.max = max(self.max, distance)
+        self.samples += 1
+
+    def features(self, now):
+        return [
+            min(now - self.start, INT16_MAX),
+            self.last - self.first,
+            self.max - self.min,
+            min(self.path, INT16_MAX),
+            self.reversals,
+            self.min_index * 100 // (self.samples - 1) if self.samples > 1 else 0,
+            min(self.samples, INT16_MAX),
+        ]
+
+
+def segments(samples, args):
+    """Cechy każdej zakończonej obecności dłoni w oknie."""
+    filt = RangeFilter(args)
+    segment = None
+    for time, distance, status, signal, ambient in samples:
+        value = filt.update(distance if status != 4 else -1, signal, ambient)
+        inside = args.min_distance <= value <= args.max_distance
+        if inside and segment is None:
+            segment = Segment(time, value)
+        elif inside:
+            segment.add(value)
+        elif segment is not None:
+            yield segment.features(time)
+            segment = None
+
+
+def gini(counts):
+    total = sum(counts.values())
+    return 1.0 - sum((c / total) ** 2 for c in counts.values()) if total else 0.0
+
+
+def count(rows):
+    counts = {}
+    for _, label in rows:
+        counts[label] = counts.get(label, 0) + 1
+    return counts
+
+
+def build(rows, depth, args):
+    counts = count(rows)
+    majority = max(counts, key=counts.get)
+    # Pewność z wygładzeniem Laplace'a - małe liście nie dostają 100 %
+    confidence = round(255 * (counts[majority] + 1) / (len(rows) + len(CLASS_NAMES)))
+    leaf = {"leaf": True, "class": majority, "confidence": confidence}
+    if depth >= args.max_depth or len(counts) == 1 or len(rows) < 2 * args.min_leaf:
+        return leaf
+
+    best = None
+    parent = gini(counts)
+    for feature in range(len(FEATURES)):
+        values = sorted({row[feature] for row, _ in rows})
+        for threshold in values[:-1]:
+            left = [r for r in rows if r[0][feature] <= threshold]
+            right = [r for r in rows if r[0][feature] > threshold]
+            if len(left) < args.min_leaf or len(right) < args.min_leaf:
+                continue
+            score = (len(left) * gini(count(left)) + len(right) * gini(count(right))) / len(rows)
+            if score < parent - 1e-9 and (best is None or score < best[0]):
+                best = (score, feature, threshold, left, right)
+
+    if best is None:
+        return leaf
+    _, feature, threshold, left, right = best
+    return {"leaf": False, "feature": feature, "threshold": threshold,
+            "left": build(left, depth + 1, args), "right": build(right, depth + 1, args)}
+
+
+def predict(node, row):
+    while not node["leaf"]:
+        node = node["left"] if row[node["feature"]] <= node["threshold"] else node["right"]
+    return node["class"]
+
+
+def flatten(node, nodes):
+    """Kolejność preorder - dzieci zawsze po rodzicu, jak wymaga classifySegment()."""
+    index = len(nodes)
+    nodes.append(None)
+    if node["leaf"]:
+        nodes[index] = ("TREE_LEAF", 0, node["class"], node["confidence"], CLASS_NAMES[node["class"]])
+    else:
+        left = flatten(node["left"], nodes)
+        right = flatten(node["right"], nodes)
+        nodes[index] = (FEATURES[node["feature"]], node["threshold"], left, right, None)
+    return index
+
+
+def write_header(path, nodes, samples):
+    lines = [
+        "#ifndef GESTURE_MODEL_H",
+        "#define GESTURE_MODEL_H",
+        "",
+        "// Model klasyfikatora gestów. Plik generowany przez tools/train_classifier.py -",
+        "// zmiany ręczne zostaną nadpisane przy następnym treningu.",
+        "",
+        '#include "gesture_classifier.h"',
+        "",
+        f"#define GESTURE_MODEL_SAMPLES {samples:<9} // Przykłady treningowe (0 = model ręczny)",
+        "",
+        "constexpr TreeNode GESTURE_MODEL[] = {",
+    ]
+    for feature, threshold, left, right, comment in nodes:
+        entry = f"    {{ {feature}, {threshold}, {left}, {right} }},"
+        lines.append(f"{entry:<40}// {comment}" if comment else entry)
+    lines += ["};", "", "#endif", ""]
+    Path(path).write_text("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("captures", nargs="+", help="nagrania .bin z /capture?format=bin")
+    parser.add_argument("--out", default=str(Path(__file__).resolve().parent.parent / "include" / "gesture_model.h"))
+    parser.add_argument("--min-distance", type=int, default=50, help="okno gestów jak gWinMin")
+    parser.add_argument("--max-distance", type=int, default=200, help="okno gestów jak gWinMax")
+    parser.add_argument("--min-signal", type=float, default=0.5, help="bramka sygnału jak fltMinSig")
+    parser.add_argument("--max-ambient", type=float, default=4.0, help="bramka otoczenia jak fltMaxAmb")
+    parser.add_argument("--no-median", action="store_true", help="gdy filtr medianowy jest wyłączony")
+    parser.add_argument("--max-depth", type=int, default=5)
+    parser.add_argument("--min-leaf", type=int, default=3)
+    args = parser.parse_args()
+
+    rows = []
+    for path in args.captures:
+        label, samples = read_capture(path)
+        if label == LABEL_NEGATIVE:
+            target = NONE
+        elif label in (TAP, DOUBLE_TAP):
+            target = TAP    # Double-tap to dwa tapy - odstęp rozstrzyga silnik
+        elif label in (APPROACH, RETREAT):
+            target = label
+        else:
+            print(f"{path}: pominięte (etykieta {label})", file=sys.stderr)
+            continue
+        found = [(features, target) for features in segments(samples, args)]
+        print(f"{path}: {CLASS_NAMES[target]}, {len(found)} obecności")
+        rows += found
+
+    if not rows:
+        sys.exit("Brak przykładów treningowych")
+
+    tree = build(rows, 0, args)
+    nodes = []
+    flatten(tree, nodes)
+    if len(nodes) > 255:
+        sys.exit("Model ma ponad 255 węzłów - zmniejsz --max-depth")
+
+    correct = sum(predict(tree, row) == label for row, label in rows)
+    print(f"{len(rows)} przykładów, {len(nodes)} węzłów, trafność treningowa {100.0 * correct / len(rows):.1f} %")
+    for target, name in CLASS_NAMES.items():
+        total = sum(1 for _, label in rows if label == target)
+        if total:
+            hits = sum(1 for row, label in rows if label == target and predict(tree, row) == target)
+            print(f"  {name:<9} {hits}/{total}")
+
+    write_header(args.out, nodes, len(rows))
+    print(f"Zapisano {args.out}")
+
+
+if __name__ == "__main__":
+    main()